@@ -0,0 +1,239 @@
+// Split a packed trie into an uncompressed top and compressed blocks of
+// subtrees
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "block_table.h"
+
+#define HASH_BITS  12
+#define MAX_DISTANCE  0xffff
+
+unsigned int block_table_compress_bound(unsigned int len) {
+  // a sequence of 3 bytes matched after 15 literals takes one byte more
+  return len + len / 16 + 16;
+}
+
+static unsigned int hash3(const uint8_t *p) {
+  return (((p[0] << 16) | (p[1] << 8) | p[2]) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Write the part of a length above 15 as bytes of 255 and a last byte below it
+static uint8_t *write_length(uint8_t *out, unsigned int length) {
+  length -= 15;
+  while (length >= 255) {
+    *out++ = 255;
+    length -= 255;
+  }
+  *out++ = length;
+  return out;
+}
+
+static uint8_t *write_sequence(uint8_t *out, const uint8_t *literals, unsigned int literal_len,
+    unsigned int distance, unsigned int match_len) {
+  uint8_t *token = out++;
+  unsigned int match_code = match_len ? match_len - BLOCK_TRIE_MIN_MATCH : 0;
+  *token = ((literal_len < 15 ? literal_len : 15) << 4) | (match_code < 15 ? match_code : 15);
+  if (literal_len >= 15) {
+    out = write_length(out, literal_len);
+  }
+  memcpy(out, literals, literal_len);
+  out += literal_len;
+  if (match_len) {
+    *out++ = distance >> 8;
+    *out++ = distance & 0xff;
+    if (match_code >= 15) {
+      out = write_length(out, match_code);
+    }
+  }
+  return out;
+}
+
+// Greedy LZ77 with the last position of each 3-byte prefix
+unsigned int block_table_compress(const uint8_t *src, unsigned int len, uint8_t *dest) {
+  int last_pos[1 << HASH_BITS];
+  uint8_t *out = dest;
+  unsigned int literal_start = 0;
+  unsigned int pos = 0;
+  memset(last_pos, 0xff, sizeof(last_pos));
+  while (pos + BLOCK_TRIE_MIN_MATCH <= len) {
+    unsigned int hash = hash3(src + pos);
+    int candidate = last_pos[hash];
+    unsigned int match_len = 0;
+    last_pos[hash] = pos;
+    if (candidate >= 0 && pos - candidate <= MAX_DISTANCE) {
+      while (pos + match_len < len && src[candidate + match_len] == src[pos + match_len]) {
+        match_len++;
+      }
+    }
+    if (match_len < BLOCK_TRIE_MIN_MATCH) {
+      pos++;
+      continue;
+    }
+    out = write_sequence(out, src + literal_start, pos - literal_start, pos - candidate,
+        match_len);
+    pos += match_len;
+    literal_start = pos;
+  }
+  // the last sequence holds the rest as literals, and may be empty
+  if (literal_start < len || out == dest) {
+    out = write_sequence(out, src + literal_start, len - literal_start, 0, 0);
+  }
+  return out - dest;
+}
+
+static void store_u16(uint8_t *p, unsigned int value) {
+  p[0] = value >> 8;
+  p[1] = value & 0xff;
+}
+
+static void store_u32(uint8_t *p, uint32_t value) {
+  store_u16(p, value >> 16);
+  store_u16(p + 2, value & 0xffff);
+}
+
+static void store_descendants(uint8_t *p, unsigned int num_descendants) {
+#if USE_TERMINAL_FLAG
+  p[0] = (p[0] & 0xf8) | (num_descendants >> 8);
+#else
+  p[0] = (p[0] & 0xf0) | (num_descendants >> 8);
+#endif
+  p[1] = num_descendants & 0xff;
+}
+
+typedef struct builder {
+  const uint8_t *packed;
+  unsigned int block_size;
+  uint8_t *top;
+  unsigned int top_len;
+  uint8_t *stubs;
+  unsigned int num_stubs;
+  unsigned int *block_lens;
+  unsigned int num_blocks;
+  uint8_t *block_data;         // uncompressed blocks, one after another
+  unsigned int block_data_len;
+} builder;
+
+// Append the subtree at pos to the current block, or to a new block if it
+// does not fit, and record its stub
+static void add_to_block(builder *b, unsigned int pos, unsigned int subtree_len) {
+  if (b->num_blocks == 0 || b->block_lens[b->num_blocks - 1] + subtree_len > b->block_size) {
+    b->block_lens[b->num_blocks++] = 0;
+  }
+  unsigned int *block_len = &b->block_lens[b->num_blocks - 1];
+  uint8_t *stub = b->stubs + b->num_stubs * BLOCK_TRIE_STUB_SIZE;
+  store_u16(stub, b->top_len);
+  store_u16(stub + 2, b->num_blocks - 1);
+  store_u16(stub + 4, *block_len);
+  b->num_stubs++;
+  memcpy(b->block_data + b->block_data_len, b->packed + pos, subtree_len);
+  b->block_data_len += subtree_len;
+  *block_len += subtree_len;
+}
+
+// Copy the node at pos to the top, and its children, or only the node if
+// its subtree goes into a block
+static void split_node(builder *b, unsigned int pos, int depth) {
+  const uint8_t *packed = b->packed;
+  unsigned int node_size = NODE_SIZE(packed, pos);
+  unsigned int subtree_len = (NODE_DESCENDANTS(packed, pos) + 1) * BYTES_PER_NODE;
+  unsigned int top_pos = b->top_len;
+  memcpy(b->top + top_pos, packed + pos, node_size);
+  if (depth > 0 && subtree_len > node_size && subtree_len <= b->block_size) {
+    add_to_block(b, pos, subtree_len);
+    b->top_len += node_size;
+    store_descendants(b->top + top_pos, node_size / BYTES_PER_NODE - 1);
+    return;
+  }
+  b->top_len += node_size;
+  unsigned int child_pos;
+  for (child_pos = pos + node_size; child_pos < pos + subtree_len;
+      child_pos += (NODE_DESCENDANTS(packed, child_pos) + 1) * BYTES_PER_NODE) {
+    split_node(b, child_pos, depth + 1);
+  }
+  store_descendants(b->top + top_pos, (b->top_len - top_pos) / BYTES_PER_NODE - 1);
+}
+
+int block_table_build(const uint8_t *packed, int packed_len, unsigned int block_size,
+    uint8_t **out) {
+  builder b;
+  unsigned int max_slots = packed_len / BYTES_PER_NODE + 1;
+  unsigned int max_block_len = 0;
+  unsigned int compressed_len = 0;
+  unsigned int block_start = 0;
+  unsigned int i;
+  int data_len = -1;
+  uint8_t *data = NULL;
+  uint8_t *check = NULL;
+  if (block_size < BLOCK_TABLE_MIN_SIZE || block_size > BLOCK_TABLE_MAX_SIZE) {
+    fprintf(stderr, "error: block size must be %d to %d\n", BLOCK_TABLE_MIN_SIZE,
+        BLOCK_TABLE_MAX_SIZE);
+    return -1;
+  }
+  memset(&b, 0, sizeof(b));
+  b.packed = packed;
+  b.block_size = block_size;
+  b.top = malloc(packed_len);
+  b.stubs = malloc(max_slots * BLOCK_TRIE_STUB_SIZE);
+  b.block_lens = malloc(sizeof(unsigned int) * max_slots);
+  b.block_data = malloc(packed_len);
+  if (!b.top || !b.stubs || !b.block_lens || !b.block_data) {
+    fprintf(stderr, "malloc error for blocks\n");
+    goto done;
+  }
+  split_node(&b, 0, 0);
+
+  for (i = 0; i < b.num_blocks; i++) {
+    compressed_len += block_table_compress_bound(b.block_lens[i]);
+    if (b.block_lens[i] > max_block_len) {
+      max_block_len = b.block_lens[i];
+    }
+  }
+  unsigned int header_len = BLOCK_TRIE_HEADER_SIZE + b.top_len +
+    b.num_stubs * BLOCK_TRIE_STUB_SIZE + b.num_blocks * BLOCK_TRIE_ENTRY_SIZE;
+  data = malloc(header_len + compressed_len);
+  check = malloc(max_block_len + 1);
+  if (!data || !check) {
+    fprintf(stderr, "malloc error for blocks\n");
+    goto done;
+  }
+  store_u16(data, b.top_len);
+  store_u16(data + 2, b.num_stubs);
+  store_u16(data + 4, b.num_blocks);
+  store_u16(data + 6, max_block_len);
+  memcpy(data + BLOCK_TRIE_HEADER_SIZE, b.top, b.top_len);
+  memcpy(data + BLOCK_TRIE_HEADER_SIZE + b.top_len, b.stubs,
+      b.num_stubs * BLOCK_TRIE_STUB_SIZE);
+
+  // compress each block on its own, and check that it comes back
+  uint8_t *entries = data + header_len - b.num_blocks * BLOCK_TRIE_ENTRY_SIZE;
+  compressed_len = 0;
+  for (i = 0; i < b.num_blocks; i++) {
+    const uint8_t *block = b.block_data + block_start;
+    uint8_t *compressed = data + header_len + compressed_len;
+    unsigned int len = block_table_compress(block, b.block_lens[i], compressed);
+    if (block_trie_decompress(compressed, len, check, max_block_len) != (int)b.block_lens[i] ||
+        memcmp(check, block, b.block_lens[i]) != 0) {
+      fprintf(stderr, "error: block %u does not decompress to itself\n", i);
+      goto done;
+    }
+    store_u32(entries + i * BLOCK_TRIE_ENTRY_SIZE, compressed_len);
+    store_u16(entries + i * BLOCK_TRIE_ENTRY_SIZE + 4, len);
+    store_u16(entries + i * BLOCK_TRIE_ENTRY_SIZE + 6, b.block_lens[i]);
+    compressed_len += len;
+    block_start += b.block_lens[i];
+  }
+  *out = data;
+  data = NULL;
+  data_len = header_len + compressed_len;
+
+done:
+  free(b.top);
+  free(b.stubs);
+  free(b.block_lens);
+  free(b.block_data);
+  free(data);
+  free(check);
+  return data_len;
+}
@@ -0,0 +1,28 @@
+// Split a packed trie into an uncompressed top and compressed blocks of
+// subtrees, read by block_trie.c
+
+#ifndef BLOCK_TABLE_H
+#define BLOCK_TABLE_H
+
+#include "block_trie.h"
+
+#define BLOCK_TABLE_MIN_SIZE  64
+#define BLOCK_TABLE_MAX_SIZE  0xffff
+
+// Build the data from the packed trie, with blocks of up to block_size
+// bytes before compression. Every subtree below the root that fits in a
+// block and has children goes into a block, with the subtrees that follow
+// it in preorder while they fit.
+// Return the length of *out, or -1 if error
+int block_table_build(const uint8_t *packed, int packed_len, unsigned int block_size,
+    uint8_t **out);
+
+// Compress len bytes of src into dest, which must hold
+// block_table_compress_bound(len) bytes
+// Return the compressed length
+unsigned int block_table_compress(const uint8_t *src, unsigned int len, uint8_t *dest);
+
+// Largest compressed length of len bytes
+unsigned int block_table_compress_bound(unsigned int len);
+
+#endif // BLOCK_TABLE_H
@@ -0,0 +1,215 @@
+// Library for looking up a result in a packed trie whose lower subtrees are
+// compressed in blocks
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "block_trie.h"
+
+static unsigned int load_u16(const uint8_t *p) {
+  return (p[0] << 8) | p[1];
+}
+
+static uint32_t load_u32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+int block_trie_open(block_trie_t *bt, const uint8_t *data, unsigned int len,
+    unsigned int num_cached) {
+  unsigned int i;
+  bt->cache = NULL;
+  bt->cached_blocks = NULL;
+  bt->last_used = NULL;
+  bt->top.data = data + BLOCK_TRIE_HEADER_SIZE;
+  bt->top.len = load_u16(data);
+  bt->num_stubs = load_u16(data + 2);
+  bt->num_blocks = load_u16(data + 4);
+  bt->max_block_len = load_u16(data + 6);
+  bt->stubs = bt->top.data + bt->top.len;
+  bt->entries = bt->stubs + bt->num_stubs * BLOCK_TRIE_STUB_SIZE;
+  bt->blocks = bt->entries + bt->num_blocks * BLOCK_TRIE_ENTRY_SIZE;
+  if (len < BLOCK_TRIE_HEADER_SIZE || bt->blocks > data + len) {
+    fprintf(stderr, "error: block trie data is too short (%u bytes)\n", len);
+    return -1;
+  }
+  bt->num_cached = num_cached > 0 ? num_cached : 1;
+  bt->cache = malloc((size_t)bt->num_cached * bt->max_block_len + 1);
+  bt->cached_blocks = malloc(sizeof(int) * bt->num_cached);
+  bt->last_used = malloc(sizeof(unsigned long) * bt->num_cached);
+  if (!bt->cache || !bt->cached_blocks || !bt->last_used) {
+    fprintf(stderr, "malloc error for block cache\n");
+    block_trie_close(bt);
+    return -1;
+  }
+  for (i = 0; i < bt->num_cached; i++) {
+    bt->cached_blocks[i] = -1;
+    bt->last_used[i] = 0;
+  }
+  bt->clock = 0;
+  bt->hits = 0;
+  bt->misses = 0;
+  return 0;
+}
+
+void block_trie_close(block_trie_t *bt) {
+  free(bt->cache);
+  free(bt->cached_blocks);
+  free(bt->last_used);
+  bt->cache = NULL;
+  bt->cached_blocks = NULL;
+  bt->last_used = NULL;
+}
+
+unsigned int block_trie_resident_size(const block_trie_t *bt) {
+  unsigned int compressed_len = 0;
+  unsigned int i;
+  for (i = 0; i < bt->num_blocks; i++) {
+    compressed_len += load_u16(bt->entries + i * BLOCK_TRIE_ENTRY_SIZE + 4);
+  }
+  return (bt->blocks - bt->top.data) + BLOCK_TRIE_HEADER_SIZE + compressed_len +
+    bt->num_cached * bt->max_block_len;
+}
+
+// Read a length continued by bytes while they are 255
+// Return 0 if success, -1 if the input ends
+static int read_length(const uint8_t **src, const uint8_t *end, unsigned int *length) {
+  uint8_t byte;
+  do {
+    if (*src >= end) {
+      return -1;
+    }
+    byte = *(*src)++;
+    *length += byte;
+  } while (byte == 255);
+  return 0;
+}
+
+int block_trie_decompress(const uint8_t *src, unsigned int src_len, uint8_t *dest,
+    unsigned int dest_len) {
+  const uint8_t *end = src + src_len;
+  unsigned int out = 0;
+  while (src < end) {
+    uint8_t token = *src++;
+    unsigned int literal_len = token >> 4;
+    unsigned int match_len = token & 0xf;
+    unsigned int distance;
+    if (literal_len == 15 && read_length(&src, end, &literal_len) != 0) {
+      return -1;
+    }
+    if (literal_len > (unsigned int)(end - src) || literal_len > dest_len - out) {
+      return -1;
+    }
+    while (literal_len-- > 0) {
+      dest[out++] = *src++;
+    }
+    if (src == end) {
+      break;  // the last sequence
+    }
+    if (end - src < 2) {
+      return -1;
+    }
+    distance = load_u16(src);
+    src += 2;
+    if (match_len == 15 && read_length(&src, end, &match_len) != 0) {
+      return -1;
+    }
+    match_len += BLOCK_TRIE_MIN_MATCH;
+    if (distance == 0 || distance > out || match_len > dest_len - out) {
+      return -1;
+    }
+    // byte by byte, since a match may overlap its own output
+    while (match_len-- > 0) {
+      dest[out] = dest[out - distance];
+      out++;
+    }
+  }
+  return out;
+}
+
+// Find the stub of the top node at pos
+// Return its index, or -1 if the node is not a stub
+static int find_stub(const block_trie_t *bt, unsigned int pos) {
+  unsigned int low = 0;
+  unsigned int high = bt->num_stubs;
+  while (low < high) {
+    unsigned int mid = (low + high) / 2;
+    unsigned int stub_pos = load_u16(bt->stubs + mid * BLOCK_TRIE_STUB_SIZE);
+    if (stub_pos == pos) {
+      return mid;
+    } else if (stub_pos < pos) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return -1;
+}
+
+// Get the block from the cache, decompressing it into the least recently
+// used buffer if it is not there
+// Return the block, or NULL if it is damaged
+static const uint8_t *load_block(block_trie_t *bt, unsigned int block, unsigned int *len) {
+  const uint8_t *entry = bt->entries + block * BLOCK_TRIE_ENTRY_SIZE;
+  unsigned int oldest = 0;
+  unsigned int i;
+  bt->clock++;
+  *len = load_u16(entry + 6);
+  for (i = 0; i < bt->num_cached; i++) {
+    if (bt->cached_blocks[i] == (int)block) {
+      bt->last_used[i] = bt->clock;
+      bt->hits++;
+      return bt->cache + i * bt->max_block_len;
+    }
+    if (bt->last_used[i] < bt->last_used[oldest]) {
+      oldest = i;
+    }
+  }
+  uint8_t *buf = bt->cache + oldest * bt->max_block_len;
+  bt->misses++;
+  if (block_trie_decompress(bt->blocks + load_u32(entry), load_u16(entry + 4), buf,
+        bt->max_block_len) != (int)*len) {
+    bt->cached_blocks[oldest] = -1;
+    return NULL;
+  }
+  bt->cached_blocks[oldest] = block;
+  bt->last_used[oldest] = bt->clock;
+  return buf;
+}
+
+// Move the cursor from a stub in the top to the root of its subtree
+// Return 1 if success, 0 if the node is not a stub or its block is damaged
+static int8_t enter_block(block_trie_t *bt, trie_cursor_t *cursor) {
+  int stub = find_stub(bt, cursor->pos);
+  const uint8_t *block;
+  unsigned int len;
+  if (stub < 0) {
+    return 0;
+  }
+  block = load_block(bt, load_u16(bt->stubs + stub * BLOCK_TRIE_STUB_SIZE + 2), &len);
+  if (!block) {
+    return 0;
+  }
+  cursor->trie.data = block;
+  cursor->trie.len = len;
+  cursor->pos = load_u16(bt->stubs + stub * BLOCK_TRIE_STUB_SIZE + 4);
+  return 1;
+}
+
+uint8_t block_trie_lookup(block_trie_t *bt, const uint8_t *digits, unsigned int len) {
+  trie_cursor_t cursor;
+  int8_t is_in_top = 1;
+  unsigned int i;
+  trie_cursor_start(&cursor, &bt->top);
+  for (i = 0; i < len; i++) {
+    if (trie_cursor_forward(&cursor, digits[i]) == 1) {
+      continue;
+    }
+    // the children of a stub are in its block
+    if (!is_in_top || !enter_block(bt, &cursor) ||
+        trie_cursor_forward(&cursor, digits[i]) != 1) {
+      return '\0';
+    }
+    is_in_top = 0;
+  }
+  return trie_cursor_result(&cursor);
+}
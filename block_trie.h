@@ -0,0 +1,78 @@
+// Library for looking up a result in a packed trie whose lower subtrees are
+// compressed in blocks (build_trie --blocks)
+//
+// The top of the trie is a packed trie kept as it is. Each subtree below it
+// that fits in a block is replaced in the top by its root node alone, and a
+// stub records where the whole subtree is in the blocks. A lookup that goes
+// below such a node decompresses its block into a small LRU cache of blocks,
+// unless the block is already there.
+//
+// Layout of the data (integers are big-endian):
+//
+//   uint16  length of the top in bytes, uint16 number of stubs,
+//   uint16  number of blocks, uint16 length of the largest block
+//   top     packed trie
+//   {uint16 offset of the node in the top, uint16 block,
+//    uint16 offset of the subtree in the block} for each stub, by offset
+//   {uint32 offset of the compressed block after this table,
+//    uint16 compressed length, uint16 length} for each block
+//   compressed blocks
+//
+// A compressed block is a sequence of a token byte, with the number of
+// literals in its upper 4 bits and the match length minus
+// BLOCK_TRIE_MIN_MATCH in its lower 4 bits (15 in either is continued by
+// bytes added to it until a byte below 255), the literals, and a uint16
+// distance back to the match. The last sequence has no match.
+
+#ifndef BLOCK_TRIE_H
+#define BLOCK_TRIE_H
+
+#include "minimal_trie.h"
+
+#define BLOCK_TRIE_HEADER_SIZE  8
+#define BLOCK_TRIE_STUB_SIZE  6
+#define BLOCK_TRIE_ENTRY_SIZE  8
+#define BLOCK_TRIE_MIN_MATCH  3
+
+// Trie data and the cache of blocks of one reader
+typedef struct block_trie_t {
+  trie_t top;
+  const uint8_t *stubs;
+  unsigned int num_stubs;
+  const uint8_t *entries;
+  const uint8_t *blocks;
+  unsigned int num_blocks;
+  unsigned int max_block_len;
+  uint8_t *cache;              // num_cached buffers of max_block_len bytes
+  int *cached_blocks;          // block in each buffer, -1 if none
+  unsigned long *last_used;    // clock when each buffer was last used
+  unsigned int num_cached;
+  unsigned long clock;
+  unsigned long hits;          // blocks found in the cache
+  unsigned long misses;        // blocks decompressed
+} block_trie_t;
+
+// Open the data with a cache of num_cached blocks (at least 1)
+// block_trie_close() may be called even if it fails
+// A block_trie_t is used by one thread at a time; open one per thread
+// Return 0 if success, -1 if error
+int block_trie_open(block_trie_t *bt, const uint8_t *data, unsigned int len,
+    unsigned int num_cached);
+
+// Free the cache
+void block_trie_close(block_trie_t *bt);
+
+// Look up the whole number digits[0..len) from the root of the trie
+// Return its result, or '\0' if it has none
+uint8_t block_trie_lookup(block_trie_t *bt, const uint8_t *digits, unsigned int len);
+
+// Bytes the reader keeps in memory: the data, with the blocks compressed,
+// and the cache
+unsigned int block_trie_resident_size(const block_trie_t *bt);
+
+// Decompress a block of src_len bytes into dest, which holds dest_len bytes
+// Return the length of the block, or -1 if it is damaged or too long
+int block_trie_decompress(const uint8_t *src, unsigned int src_len, uint8_t *dest,
+    unsigned int dest_len);
+
+#endif // BLOCK_TRIE_H
@@ -3,115 +3,751 @@
 #include <string.h>
 #include <getopt.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 #include "tiny_regex.h"
+#include "trie_encode.h"
+#include "stream_pack.h"
+#include "multi_table.h"
+#include "pattern_file.h"
+#include "trie_emit.h"
+#include "jump_table.h"
+#include "trie_patch.h"
+#include "mph_table.h"
+#include "block_table.h"
+#include "shard_table.h"
+#include "trie_merge.h"
+#include "summary_table.h"
 
 void print_usage() {
   printf("Usage: build_trie [options] <pattern_file>\n");
+  printf("       build_trie --multi [options] <pattern_file>...\n");
+  printf("       build_trie --diff [options] <old_trie> <new_trie>\n");
+  printf("       build_trie --apply=PATCH [options] <old_trie>\n");
+  printf("       build_trie --union|--intersect|--difference [options] <trie_a> <trie_b>\n");
   printf("\n");
   printf("Options:\n");
-  printf("  -s, --showtrie   show the result trie\n");
+  printf("  -s, --showtrie       show the result trie\n");
+  printf("  -f, --format=FORMAT  output format: packed (default), terminal, louds,\n");
+  printf("                       stride\n");
+  printf("      --stats          print the size of each format to stderr\n");
+  printf("      --sorted         build the packed trie directly from sorted literal\n");
+  printf("                       patterns without building the whole trie in memory\n");
+  printf("  -m, --multi          build one table per pattern file into a single blob\n");
+  printf("  -e, --emit=TYPE      output type: c (default), binary, asm, object\n");
+  printf("  -n, --name=NAME      symbol name for c, asm and object (default: trie_data)\n");
+  printf("  -j, --jump=K         put a table of the nodes of all K-digit prefixes (1-%d)\n",
+      TRIE_JUMP_MAX_DEPTH);
+  printf("                       in front of the packed trie\n");
+  printf("      --mph            put plain numbers of up to %d digits into a minimal\n",
+      TRIE_MPH_MAX_DIGITS);
+  printf("                       perfect hash table in front of the packed trie\n");
+  printf("      --blocks=SIZE    compress the subtrees of up to SIZE bytes (%d-%d) in\n",
+      BLOCK_TABLE_MIN_SIZE, BLOCK_TABLE_MAX_SIZE);
+  printf("                       blocks below an uncompressed top of the packed trie\n");
+  printf("      --summaries      append the results, digits still needed and number of\n");
+  printf("                       results below each node of the packed trie\n");
+  printf("      --shards=K       write an index of the first K digits (1-%d) and a packed\n",
+      SHARD_TABLE_MAX_DEPTH);
+  printf("                       trie for each K-digit prefix as files in --output\n");
+  printf("  -o, --output=DIR     directory for --shards, created if needed\n");
+  printf("      --profile=FILE   put the most used children first, as counted by a\n");
+  printf("                       telemetry build of minimal_trie.c\n");
+  printf("      --diff           print a patch from one packed trie file (--emit=binary)\n");
+  printf("                       to another\n");
+  printf("      --apply=PATCH    print the trie built by applying the patch to a trie file\n");
+  printf("      --union          print the trie of the numbers in either packed trie file\n");
+  printf("      --intersect      print the trie of the numbers with the same result in both\n");
+  printf("      --difference     print the trie of the numbers of trie_a whose result is\n");
+  printf("                       not the same in trie_b\n");
+  printf("      --conflict=WHICH result of a number with different results for --union:\n");
+  printf("                       left (default), right, error\n");
+}
+
+// Read the node counts written by trie_telemetry_export() and reorder the trie
+// Return 0 if success, -1 if error
+static int apply_profile(char *filename) {
+  char line[256];
+  char path[64];
+  unsigned long hits;
+  unsigned int num_nodes = 0;
+  unsigned int num_missing = 0;
+  FILE *fp = fopen(filename, "r");
+  if (!fp) {
+    fprintf(stderr, "Error opening %s: %s\n", filename, strerror(errno));
+    return -1;
+  }
+  if (!fgets(line, sizeof(line), fp) || strcmp(line, "trie-telemetry 1\n") != 0) {
+    fprintf(stderr, "%s is not a profile written by trie_telemetry_export()\n", filename);
+    fclose(fp);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), fp)) {
+    if (strncmp(line, "node ", 5) != 0) {
+      continue;  // counters of lookups, depths and results
+    }
+    if (sscanf(line, "node %63s %lu", path, &hits) != 2) {
+      fprintf(stderr, "syntax error in %s: %s", filename, line);
+      fclose(fp);
+      return -1;
+    }
+    num_nodes++;
+    if (!tinreg_add_hits(path, strlen(path), hits)) {
+      num_missing++;
+    }
+  }
+  fclose(fp);
+  // patterns may have changed since the profile was taken
+  if (num_missing > 0) {
+    fprintf(stderr, "warning: %u of %u nodes in %s are not in the trie\n",
+        num_missing, num_nodes, filename);
+  }
+  tinreg_sort_by_hits();
+  return 0;
+}
+
+// Encode the trie in one of the formats built from the flattened trie
+static int encode_flattened(char *format, uint8_t **data) {
+  tinreg_flat_node *nodes;
+  int data_len;
+  int num_nodes = tinreg_flatten(&nodes);
+  if (num_nodes < 0) {
+    return -1;
+  }
+  if (strcmp(format, "louds") == 0) {
+    data_len = trie_encode_louds(nodes, num_nodes, data);
+  } else if (strcmp(format, "stride") == 0) {
+    data_len = trie_encode_stride(nodes, num_nodes, data);
+  } else {
+    data_len = trie_encode_terminal(nodes, num_nodes, data);
+  }
+  free(nodes);
+  return data_len;
+}
+
+// Split the trie into shards and write them with their index into dir
+// Return 0 if success, -1 if error
+static int build_shards(int depth, const char *dir, int print_sizes) {
+  tinreg_flat_node *nodes;
+  shard_table table;
+  unsigned int total_len = 0;
+  unsigned int max_len = 0;
+  unsigned int n;
+  int status;
+  int num_nodes = tinreg_flatten(&nodes);
+  if (num_nodes < 0) {
+    return -1;
+  }
+  status = shard_table_build(nodes, num_nodes, depth, &table);
+  free(nodes);
+  if (status != 0) {
+    return -1;
+  }
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "Error creating %s: %s\n", dir, strerror(errno));
+    shard_table_free(&table);
+    return -1;
+  }
+  status = shard_table_write(&table, dir);
+  if (status == 0 && print_sizes) {
+    for (n = 0; n < table.num_shards; n++) {
+      total_len += table.shard_lens[n];
+      if (table.shard_lens[n] > max_len) {
+        max_len = table.shard_lens[n];
+      }
+    }
+    fprintf(stderr, "shards:   index of %u bytes, %u shards of up to %u bytes (%u in all)\n",
+        table.index_len, table.num_shards, max_len, total_len);
+  }
+  shard_table_free(&table);
+  return status;
+}
+
+// Print the size of the jump table for each depth and how many of its
+// prefixes exist in the trie
+static void print_jump_stats() {
+  uint8_t *packed;
+  int packed_len = tinreg_pack(&packed);
+  int depth;
+  if (packed_len < 0) {
+    return;
+  }
+  for (depth = 1; depth <= TRIE_JUMP_MAX_DEPTH; depth++) {
+    uint8_t *data;
+    int data_len = jump_table_build(packed, packed_len, depth, &data);
+    unsigned int table_size = jump_table_size(depth);
+    unsigned int num_entries = (table_size - TRIE_JUMP_HEADER_SIZE) / 2;
+    unsigned int num_found = 0;
+    unsigned int i;
+    if (data_len < 0) {
+      break;
+    }
+    for (i = 0; i < num_entries; i++) {
+      uint8_t *entry = data + TRIE_JUMP_HEADER_SIZE + i * 2;
+      if (((entry[0] << 8) | entry[1]) != TRIE_JUMP_MISS) {
+        num_found++;
+      }
+    }
+    fprintf(stderr, "jump %d:   +%u bytes (%u of %u prefixes in the trie)\n",
+        depth, table_size, num_found, num_entries);
+    free(data);
+  }
+  free(packed);
+}
+
+static void print_stats() {
+  tinreg_flat_node *nodes;
+  uint8_t *data;
+  int num_terminals = 0;
+  int num_sets = 0;
+  int packed_len;
+  int terminal_len;
+  int louds_len;
+  int stride_len;
+  int i;
+  int num_nodes = tinreg_flatten(&nodes);
+  if (num_nodes < 0) {
+    return;
+  }
+  for (i = 0; i < num_nodes; i++) {
+    if (nodes[i].result != '\0') {
+      num_terminals++;
+    }
+    if (nodes[i].digit == TINREG_DIGIT_SET) {
+      num_sets++;
+    }
+  }
+  // each set of digits takes one more node for its mask
+  packed_len = (num_nodes + num_sets) * 3;
+  fprintf(stderr, "nodes:    %d (%d with a result, %d sets of digits)\n",
+      num_nodes, num_terminals, num_sets);
+  fprintf(stderr, "packed:   %d bytes\n", packed_len);
+  terminal_len = trie_encode_terminal(nodes, num_nodes, &data);
+  if (terminal_len >= 0) {
+    free(data);
+    fprintf(stderr, "terminal: %d bytes (%d bytes saved)\n",
+        terminal_len, packed_len - terminal_len);
+  }
+  louds_len = trie_encode_louds(nodes, num_nodes, &data);
+  if (louds_len >= 0) {
+    free(data);
+    fprintf(stderr, "louds:    %d bytes (%d bytes saved)\n",
+        louds_len, packed_len - louds_len);
+  }
+  stride_len = trie_encode_stride(nodes, num_nodes, &data);
+  if (stride_len >= 0) {
+    free(data);
+    fprintf(stderr, "stride:   %d bytes\n", stride_len);
+  }
+  free(nodes);
+  // tinreg_pack() fails on tries too large for the packed format
+  if (packed_len <= (0xfff + 1) * 3) {
+    print_jump_stats();
+  }
+}
+
+static char *emit_format = "c";
+static char *symbol_name = "trie_data";
+
+// Print the data in the output type given by --emit
+// Return 0 if success, -1 if error
+static int print_data(uint8_t *data, int len) {
+  int i;
+  if (strcmp(emit_format, "binary") == 0) {
+    fwrite(data, 1, len, stdout);
+    return 0;
+  } else if (strcmp(emit_format, "asm") == 0) {
+    trie_emit_asm(stdout, symbol_name, data, len);
+    return 0;
+  } else if (strcmp(emit_format, "object") == 0) {
+    return trie_emit_object(stdout, symbol_name, data, len);
+  }
+  printf("static uint8_t %s[] = {\n", symbol_name);
+  for (i = 0; i < len; i++) {
+    if (i % 8 == 0) {
+      if (i != 0) {
+        printf("\n");
+      }
+      printf("  ");
+    } else {
+      printf(" ");
+    }
+    printf("0x%02x,", data[i]);
+  }
+  printf("\n};  // %d bytes\n", len);
+  return 0;
+}
+
+// Read the whole file into newly allocated memory
+static uint8_t *read_file(const char *filename, unsigned int *len) {
+  uint8_t *data = NULL;
+  long size;
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    fprintf(stderr, "Error opening %s: %s\n", filename, strerror(errno));
+    return NULL;
+  }
+  if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+    data = malloc(size);
+    if (data && fread(data, 1, size, fp) != (size_t)size) {
+      free(data);
+      data = NULL;
+    }
+    *len = size;
+  }
+  if (!data) {
+    fprintf(stderr, "Error reading %s\n", filename);
+  }
+  fclose(fp);
+  return data;
+}
+
+// Print a patch from the old trie file to the new one
+static int diff_tries(char *old_filename, char *new_filename) {
+  unsigned int old_len, new_len;
+  uint8_t *old_data = read_file(old_filename, &old_len);
+  uint8_t *new_data = old_data ? read_file(new_filename, &new_len) : NULL;
+  uint8_t *patch;
+  int patch_len = -1;
+  if (new_data) {
+    patch_len = trie_patch_diff(old_data, old_len, new_data, new_len, &patch);
+  }
+  if (patch_len >= 0) {
+    fprintf(stderr, "patch: %d bytes for a trie of %u bytes\n", patch_len, new_len);
+    print_data(patch, patch_len);
+    free(patch);
+  }
+  free(old_data);
+  free(new_data);
+  return patch_len >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Print the trie of a op b, read from packed trie files
+static int merge_tries(char *filename_a, char *filename_b, int op, int conflict) {
+  trie_t a, b;
+  unsigned int len_a, len_b;
+  uint8_t *data_a = read_file(filename_a, &len_a);
+  uint8_t *data_b = data_a ? read_file(filename_b, &len_b) : NULL;
+  uint8_t *data;
+  int data_len = -1;
+  if (data_b) {
+    a.data = data_a;
+    a.len = len_a;
+    b.data = data_b;
+    b.len = len_b;
+    data_len = trie_merge(&a, &b, op, conflict, &data);
+  }
+  if (data_len >= 0) {
+    print_data(data, data_len);
+    free(data);
+  }
+  free(data_a);
+  free(data_b);
+  return data_len >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Print the trie built by applying the patch file to the old trie file
+static int apply_patch(char *patch_filename, char *old_filename) {
+  unsigned int patch_len, old_len, new_len;
+  uint8_t *patch = read_file(patch_filename, &patch_len);
+  uint8_t *old_data = patch ? read_file(old_filename, &old_len) : NULL;
+  uint8_t *new_data = NULL;
+  int status = TRIE_PATCH_ERROR_FORMAT;
+  if (old_data) {
+    new_len = trie_patch_new_len(patch, patch_len);
+    new_data = malloc(new_len > 0 ? new_len : 1);
+    if (!new_data) {
+      fprintf(stderr, "malloc error for the new trie\n");
+    } else {
+      status = trie_apply_patch(old_data, old_len, patch, patch_len, new_data, new_len);
+    }
+  }
+  if (status >= 0) {
+    print_data(new_data, status);
+  } else if (status == TRIE_PATCH_ERROR_OLD) {
+    fprintf(stderr, "error: %s is not the trie that %s was made for\n", old_filename,
+        patch_filename);
+  } else if (status == TRIE_PATCH_ERROR_NEW) {
+    fprintf(stderr, "error: checksum mismatch after applying %s\n", patch_filename);
+  } else if (old_data && new_data) {
+    fprintf(stderr, "error: %s is not a valid patch\n", patch_filename);
+  }
+  free(patch);
+  free(old_data);
+  free(new_data);
+  return status >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Build one packed trie per pattern file and print them as a multi-table blob
+static int build_multi(char **filenames, int num_tables, int sorted) {
+  uint8_t **tables = malloc(sizeof(uint8_t *) * num_tables);
+  int *table_lens = malloc(sizeof(int) * num_tables);
+  char **names = malloc(sizeof(char *) * num_tables);
+  uint8_t *blob;
+  int blob_len;
+  int i;
+  if (!tables || !table_lens || !names) {
+    fprintf(stderr, "malloc error for tables\n");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < num_tables; i++) {
+    stream_packer packer;
+    char *name = strrchr(filenames[i], '/');
+    name = strdup(name ? name + 1 : filenames[i]);
+    if (strchr(name, '.')) {
+      *strchr(name, '.') = '\0';
+    }
+    names[i] = name;
+    if (sorted) {
+      if (stream_pack_init(&packer) != 0 ||
+          pattern_file_read(filenames[i], &packer, NULL) != 0) {
+        return EXIT_FAILURE;
+      }
+      table_lens[i] = stream_pack_finish(&packer, &tables[i]);
+    } else {
+      if (pattern_file_read(filenames[i], NULL, NULL) != 0) {
+        return EXIT_FAILURE;
+      }
+      table_lens[i] = tinreg_pack(&tables[i]);
+      tinreg_clear_patterns();
+    }
+    if (table_lens[i] < 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  blob_len = multi_table_build(tables, table_lens, names, num_tables, &blob);
+  if (blob_len < 0) {
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < num_tables; i++) {
+    if (strcmp(emit_format, "c") == 0) {
+      printf("// table %d: %s\n", i, names[i]);
+    }
+    free(tables[i]);
+    free(names[i]);
+  }
+  int status = print_data(blob, blob_len);
+  free(blob);
+  free(tables);
+  free(table_lens);
+  free(names);
+  return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 int main(int argc, char **argv) {
-  FILE *fp;
-  char buf[1024];
   int opt_showtrie = 0;
+  int opt_stats = 0;
+  int opt_sorted = 0;
+  int opt_multi = 0;
+  int opt_jump = 0;
+  int opt_mph = 0;
+  int opt_blocks = 0;
+  int opt_summaries = 0;
+  int opt_shards = 0;
+  char *opt_output = NULL;
+  char *opt_profile = NULL;
+  int opt_diff = 0;
+  char *opt_apply = NULL;
+  int opt_merge = -1;
+  int opt_conflict = TRIE_MERGE_LEFT;
+  stream_packer packer;
+  mph_keys literals;
+  char *opt_format = "packed";
 
   static struct option long_options[] = {
     { "showtrie", no_argument, NULL, 's' },
+    { "format", required_argument, NULL, 'f' },
+    { "stats", no_argument, NULL, 'S' },
+    { "sorted", no_argument, NULL, 'O' },
+    { "multi", no_argument, NULL, 'm' },
+    { "emit", required_argument, NULL, 'e' },
+    { "name", required_argument, NULL, 'n' },
+    { "jump", required_argument, NULL, 'j' },
+    { "mph", no_argument, NULL, 'H' },
+    { "blocks", required_argument, NULL, 'B' },
+    { "summaries", no_argument, NULL, 'R' },
+    { "shards", required_argument, NULL, 'K' },
+    { "output", required_argument, NULL, 'o' },
+    { "profile", required_argument, NULL, 'P' },
+    { "diff", no_argument, NULL, 'D' },
+    { "apply", required_argument, NULL, 'A' },
+    { "union", no_argument, NULL, 'U' },
+    { "intersect", no_argument, NULL, 'I' },
+    { "difference", no_argument, NULL, 'X' },
+    { "conflict", required_argument, NULL, 'C' },
     { 0, 0, 0, 0 },
   };
   int option_index = 0;
   int opt;
-  while ((opt = getopt_long(argc, argv, "s", long_options, &option_index)) != -1) {
+  while ((opt = getopt_long(argc, argv, "sf:me:n:j:o:", long_options, &option_index)) != -1) {
     switch (opt) {
       case 's':
         opt_showtrie = 1;
         break;
+      case 'f':
+        opt_format = optarg;
+        break;
+      case 'S':
+        opt_stats = 1;
+        break;
+      case 'O':
+        opt_sorted = 1;
+        break;
+      case 'm':
+        opt_multi = 1;
+        break;
+      case 'e':
+        emit_format = optarg;
+        break;
+      case 'n':
+        symbol_name = optarg;
+        break;
+      case 'j':
+        opt_jump = atoi(optarg);
+        if (opt_jump < 1 || opt_jump > TRIE_JUMP_MAX_DEPTH) {
+          fprintf(stderr, "--jump must be 1 to %d\n", TRIE_JUMP_MAX_DEPTH);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'H':
+        opt_mph = 1;
+        break;
+      case 'B':
+        opt_blocks = atoi(optarg);
+        if (opt_blocks < BLOCK_TABLE_MIN_SIZE || opt_blocks > BLOCK_TABLE_MAX_SIZE) {
+          fprintf(stderr, "--blocks must be %d to %d\n", BLOCK_TABLE_MIN_SIZE,
+              BLOCK_TABLE_MAX_SIZE);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'R':
+        opt_summaries = 1;
+        break;
+      case 'K':
+        opt_shards = atoi(optarg);
+        if (opt_shards < 1 || opt_shards > SHARD_TABLE_MAX_DEPTH) {
+          fprintf(stderr, "--shards must be 1 to %d\n", SHARD_TABLE_MAX_DEPTH);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'o':
+        opt_output = optarg;
+        break;
+      case 'P':
+        opt_profile = optarg;
+        break;
+      case 'D':
+        opt_diff = 1;
+        break;
+      case 'A':
+        opt_apply = optarg;
+        break;
+      case 'U':
+        opt_merge = TRIE_MERGE_UNION;
+        break;
+      case 'I':
+        opt_merge = TRIE_MERGE_INTERSECT;
+        break;
+      case 'X':
+        opt_merge = TRIE_MERGE_DIFFERENCE;
+        break;
+      case 'C':
+        if (strcmp(optarg, "left") == 0) {
+          opt_conflict = TRIE_MERGE_LEFT;
+        } else if (strcmp(optarg, "right") == 0) {
+          opt_conflict = TRIE_MERGE_RIGHT;
+        } else if (strcmp(optarg, "error") == 0) {
+          opt_conflict = TRIE_MERGE_ERROR;
+        } else {
+          fprintf(stderr, "--conflict must be left, right or error\n");
+          return EXIT_FAILURE;
+        }
+        break;
       default:
         print_usage();
         return EXIT_FAILURE;
     }
   }
 
-  if (argc < optind + 1) {
+  if (strcmp(opt_format, "packed") != 0 && strcmp(opt_format, "terminal") != 0 &&
+      strcmp(opt_format, "louds") != 0 && strcmp(opt_format, "stride") != 0) {
+    fprintf(stderr, "unknown format: %s\n", opt_format);
     print_usage();
     return EXIT_FAILURE;
   }
 
-  fp = fopen(argv[optind], "r");
-  if (!fp) {
-    fprintf(stderr, "Error opening %s: %s", argv[optind], strerror(errno));
+  if (strcmp(emit_format, "c") != 0 && strcmp(emit_format, "binary") != 0 &&
+      strcmp(emit_format, "asm") != 0 && strcmp(emit_format, "object") != 0) {
+    fprintf(stderr, "unknown output type: %s\n", emit_format);
+    print_usage();
     return EXIT_FAILURE;
   }
 
-  int line_count = 0;
-  while (fgets(buf, 1024, fp)) {
-    line_count++;
-    int pattern_len = 0;
-    int is_space_found = 0;
-    char result = '\0';
-    int i;
-    for (i = 0; i < strlen(buf); i++) {
-      if (buf[i] == '\n') {
-        break;
-      }
-      if (buf[i] == ' ' || buf[i] == '\t') {
-        if (!is_space_found) {
-          is_space_found = 1;
-        }
-      } else {
-        if (is_space_found) {
-          if (result == '\0') {
-            result = buf[i];
-          } else {
-            fprintf(stderr, "syntax error at line %d (result must be single char): %s",
-                line_count, buf);
-            return EXIT_FAILURE;
-          }
-        }
-      }
-      if (!is_space_found) {
-        pattern_len++;
-      }
+  if (opt_sorted && (opt_showtrie || opt_stats || strcmp(opt_format, "packed") != 0)) {
+    fprintf(stderr, "--sorted supports only the packed format\n");
+    return EXIT_FAILURE;
+  }
+
+  if (opt_jump && (opt_multi || strcmp(opt_format, "packed") != 0)) {
+    fprintf(stderr, "--jump supports only the packed format\n");
+    return EXIT_FAILURE;
+  }
+
+  if (opt_mph && (opt_sorted || opt_multi || opt_jump || strcmp(opt_format, "packed") != 0)) {
+    fprintf(stderr, "--mph supports only the packed format without --sorted or --jump\n");
+    return EXIT_FAILURE;
+  }
+
+  if (opt_blocks && (opt_sorted || opt_multi || opt_jump || opt_mph ||
+        strcmp(opt_format, "packed") != 0)) {
+    fprintf(stderr, "--blocks supports only the packed format without --sorted, --jump or --mph\n");
+    return EXIT_FAILURE;
+  }
+
+  if (opt_summaries && (opt_sorted || opt_multi || opt_jump || opt_mph || opt_blocks ||
+        strcmp(opt_format, "packed") != 0)) {
+    fprintf(stderr, "--summaries supports only the packed format without --sorted, --jump, "
+        "--mph or --blocks\n");
+    return EXIT_FAILURE;
+  }
+
+  if (opt_shards && (opt_showtrie || opt_sorted || opt_multi || opt_jump || opt_mph ||
+        opt_blocks || opt_summaries || strcmp(opt_format, "packed") != 0)) {
+    fprintf(stderr, "--shards supports only the packed format without --sorted, --jump, "
+        "--mph, --blocks or --summaries\n");
+    return EXIT_FAILURE;
+  }
+
+  if (opt_shards && !opt_output) {
+    fprintf(stderr, "--shards needs --output=DIR\n");
+    return EXIT_FAILURE;
+  }
+
+  if (opt_profile && (opt_sorted || opt_multi)) {
+    fprintf(stderr, "--profile cannot be used with --sorted or --multi\n");
+    return EXIT_FAILURE;
+  }
+
+  if (argc < optind + 1) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+
+  if (opt_diff) {
+    if (argc != optind + 2) {
+      print_usage();
+      return EXIT_FAILURE;
     }
-    if (pattern_len == 0 && result == '\0') { // empty line
-      continue;
-    } else if (pattern_len == 0 || result == '\0' || !is_space_found) { // syntax error
-      fprintf(stderr, "syntax error at line %d: %s", line_count, buf);
-      fprintf(stderr, "correct format is \"<regex_pattern> <result>\"\n");
+    return diff_tries(argv[optind], argv[optind + 1]);
+  }
+
+  if (opt_merge >= 0) {
+    if (argc != optind + 2) {
+      print_usage();
       return EXIT_FAILURE;
     }
-    if (tinreg_add_pattern(buf, pattern_len, result) != 0) {
+    return merge_tries(argv[optind], argv[optind + 1], opt_merge, opt_conflict);
+  }
+
+  if (opt_apply) {
+    return apply_patch(opt_apply, argv[optind]);
+  }
+
+  if (opt_multi) {
+    if (opt_showtrie || opt_stats || strcmp(opt_format, "packed") != 0) {
+      fprintf(stderr, "--multi supports only the packed format\n");
       return EXIT_FAILURE;
     }
+    return build_multi(argv + optind, argc - optind, opt_sorted);
+  }
+
+  if (opt_sorted && stream_pack_init(&packer) != 0) {
+    return EXIT_FAILURE;
   }
 
-  if (opt_showtrie) {
+  mph_keys_init(&literals);
+  if (pattern_file_read(argv[optind], opt_sorted ? &packer : NULL,
+        opt_mph ? &literals : NULL) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (opt_profile && apply_profile(opt_profile) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (opt_shards) {
+    if (build_shards(opt_shards, opt_output, opt_stats) != 0) {
+      return EXIT_FAILURE;
+    }
+  } else if (opt_showtrie) {
     tinreg_display_trie();
   } else {
-    uint8_t *packed_data;
-    int packed_data_len;
-    int i;
-    packed_data_len = tinreg_pack(&packed_data);
-    printf("static uint8_t trie_data[] = {\n");
-    for (i = 0; i < packed_data_len; i++) {
-      if (i % 8 == 0) {
-        if (i != 0) {
-          printf("\n");
+    uint8_t *data;
+    int data_len;
+    if (opt_sorted) {
+      data_len = stream_pack_finish(&packer, &data);
+    } else if (strcmp(opt_format, "packed") == 0) {
+      data_len = tinreg_pack(&data);
+    } else {
+      data_len = encode_flattened(opt_format, &data);
+    }
+    if (data_len >= 0 && opt_jump) {
+      uint8_t *packed = data;
+      data_len = jump_table_build(packed, data_len, opt_jump, &data);
+      free(packed);
+    }
+    if (data_len >= 0 && opt_mph) {
+      uint8_t *packed = data;
+      int packed_len = data_len;
+      data_len = mph_table_build(&literals, packed, packed_len, &data);
+      free(packed);
+      if (data_len >= 0 && opt_stats) {
+        trie_mph_t mph = trie_mph_open(data, data_len);
+        fprintf(stderr, "mph:      %u numbers, %d bytes in front of the trie\n",
+            (unsigned int)mph.num_keys, data_len - packed_len);
+      }
+    }
+    if (data_len >= 0 && opt_blocks) {
+      uint8_t *packed = data;
+      int packed_len = data_len;
+      data_len = block_table_build(packed, packed_len, opt_blocks, &data);
+      free(packed);
+      if (data_len >= 0 && opt_stats) {
+        block_trie_t bt;
+        if (block_trie_open(&bt, data, data_len, 1) == 0) {
+          fprintf(stderr, "blocks:   %u blocks of up to %u bytes below a top of %u bytes, "
+              "%d bytes in all (%d before)\n", bt.num_blocks, bt.max_block_len, bt.top.len,
+              data_len, packed_len);
+          block_trie_close(&bt);
         }
-        printf("  ");
-      } else {
-        printf(" ");
       }
-      printf("0x%02x,", packed_data[i]);
     }
-    printf("\n};  // %d bytes\n", packed_data_len);
-    free(packed_data);
+    if (data_len >= 0 && opt_summaries) {
+      uint8_t *packed = data;
+      int packed_len = data_len;
+      data_len = summary_table_build(packed, packed_len, &data);
+      free(packed);
+      if (data_len >= 0 && opt_stats) {
+        trie_t trie = { data, data_len };
+        trie_cursor_t cursor;
+        trie_summary_t summary;
+        trie_cursor_start(&cursor, &trie);
+        trie_cursor_summary(&cursor, &summary);
+        fprintf(stderr, "summaries: %u results, %u-%u digits, %d bytes after the trie\n",
+            data[packed_len], summary.min_digits, summary.max_digits, data_len - packed_len);
+      }
+    }
+    if (data_len < 0 || print_data(data, data_len) != 0) {
+      return EXIT_FAILURE;
+    }
+    free(data);
   }
 
-  fclose(fp);
+  if (opt_stats) {
+    print_stats();
+  }
+  mph_keys_free(&literals);
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,62 @@
+// Put a table of the nodes of all k-digit prefixes in front of a packed trie
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jump_table.h"
+
+unsigned int jump_table_size(int depth) {
+  unsigned int size = 2;
+  int i;
+  for (i = 0; i < depth; i++) {
+    size *= 10;
+  }
+  return TRIE_JUMP_HEADER_SIZE + size;
+}
+
+// Store the node of every prefix below the cursor that has the given number
+// of digits left
+static void fill_table(uint8_t *table, const trie_cursor_t *cursor, unsigned int index,
+    int digits_left) {
+  uint8_t digit;
+  if (digits_left == 0) {
+    table[index * 2] = cursor->pos >> 8;
+    table[index * 2 + 1] = cursor->pos & 0xff;
+    return;
+  }
+  for (digit = 0; digit < 10; digit++) {
+    trie_cursor_t child = *cursor;
+    if (trie_cursor_forward(&child, digit) == 1) {
+      fill_table(table, &child, index * 10 + digit, digits_left - 1);
+    }
+  }
+}
+
+int jump_table_build(const uint8_t *packed, int packed_len, int depth, uint8_t **out) {
+  trie_t trie = { packed, packed_len };
+  trie_cursor_t cursor;
+  if (depth < 1 || depth > TRIE_JUMP_MAX_DEPTH) {
+    fprintf(stderr, "error: jump table depth must be 1 to %d\n", TRIE_JUMP_MAX_DEPTH);
+    return -1;
+  }
+  if (packed_len >= TRIE_JUMP_MISS) {
+    fprintf(stderr, "error: trie is too large for a jump table (%d bytes)\n", packed_len);
+    return -1;
+  }
+  unsigned int table_size = jump_table_size(depth);
+  uint8_t *data = malloc(table_size + packed_len);
+  if (!data) {
+    fprintf(stderr, "malloc error for jump table\n");
+    return -1;
+  }
+  data[0] = depth;
+  data[1] = 0;
+  // every entry starts as TRIE_JUMP_MISS
+  memset(data + TRIE_JUMP_HEADER_SIZE, 0xff, table_size - TRIE_JUMP_HEADER_SIZE);
+  trie_cursor_start(&cursor, &trie);
+  fill_table(data + TRIE_JUMP_HEADER_SIZE, &cursor, 0, depth);
+  memcpy(data + table_size, packed, packed_len);
+  *out = data;
+  return table_size + packed_len;
+}
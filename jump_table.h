@@ -0,0 +1,16 @@
+// Put a table of the nodes of all k-digit prefixes in front of a packed trie,
+// read by trie_jump_open()
+
+#ifndef JUMP_TABLE_H
+#define JUMP_TABLE_H
+
+#include "minimal_trie.h"
+
+// Number of bytes the table adds for the given depth
+unsigned int jump_table_size(int depth);
+
+// Build the data from the packed trie with a table for the first depth digits
+// Return the length of *out, or -1 if error
+int jump_table_build(const uint8_t *packed, int packed_len, int depth, uint8_t **out);
+
+#endif // JUMP_TABLE_H
@@ -0,0 +1,151 @@
+// Library for looking up a result in a LOUDS-encoded (succinct) trie
+
+#include "louds_trie.h"
+
+#if defined(__GNUC__)
+#define POPCOUNT64(x)  __builtin_popcountll(x)
+#define CTZ64(x)  __builtin_ctzll(x)
+#else
+static unsigned int POPCOUNT64(uint64_t x) {
+  unsigned int count = 0;
+  while (x) {
+    x &= x - 1;
+    count++;
+  }
+  return count;
+}
+static unsigned int CTZ64(uint64_t x) {
+  unsigned int count = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    count++;
+  }
+  return count;
+}
+#endif
+
+static const uint8_t *louds_words;
+static const uint8_t *rank_dir;
+static const uint8_t *select_dir;
+static const uint8_t *terminal_words;
+static const uint8_t *terminal_rank_dir;
+static const uint8_t *labels;
+static const uint8_t *results;
+static unsigned int num_nodes;
+static unsigned int lookup_node = 0;
+
+static uint32_t load_u32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t load_word(const uint8_t *words, unsigned int index) {
+  const uint8_t *p = words + index * 8;
+  return load_u32(p) | ((uint64_t)load_u32(p + 4) << 32);
+}
+
+static unsigned int align8(unsigned int n) {
+  return (n + 7) & ~7u;
+}
+
+// Number of 1s before the bit position pos
+static unsigned int rank1(const uint8_t *words, const uint8_t *dir, unsigned int pos) {
+  unsigned int word_index = pos >> 6;
+  unsigned int block_index = word_index / LOUDS_RANK_BLOCK_WORDS;
+  unsigned int count = load_u32(dir + block_index * 4);
+  unsigned int i;
+  for (i = block_index * LOUDS_RANK_BLOCK_WORDS; i < word_index; i++) {
+    count += POPCOUNT64(load_word(words, i));
+  }
+  if (pos & 63) {
+    count += POPCOUNT64(load_word(words, word_index) & ((1ULL << (pos & 63)) - 1));
+  }
+  return count;
+}
+
+// Position of the nth 0 (counting from 0)
+static unsigned int select0(unsigned int nth) {
+  unsigned int pos = load_u32(select_dir + (nth / LOUDS_SELECT_SAMPLE) * 4);
+  unsigned int remaining = nth % LOUDS_SELECT_SAMPLE;
+  unsigned int word_index = pos >> 6;
+  uint64_t zeros = ~load_word(louds_words, word_index) & (~0ULL << (pos & 63));
+  while (1) {
+    unsigned int count = POPCOUNT64(zeros);
+    if (remaining < count) {
+      while (remaining--) {
+        zeros &= zeros - 1;
+      }
+      return (word_index << 6) + CTZ64(zeros);
+    }
+    remaining -= count;
+    word_index++;
+    zeros = ~load_word(louds_words, word_index);
+  }
+}
+
+// Set trie data
+void louds_set_data(const uint8_t *data, unsigned int len) {
+  unsigned int num_terminals;
+  unsigned int num_words;
+  unsigned int num_terminal_words;
+  const uint8_t *p = data;
+  num_nodes = load_u32(p);
+  num_terminals = load_u32(p + 4);
+  num_words = (2 * num_nodes - 1 + 63) / 64;
+  num_terminal_words = (num_nodes + 63) / 64;
+  p += 8;
+  louds_words = p;
+  p += num_words * 8;
+  rank_dir = p;
+  p += align8((num_words / LOUDS_RANK_BLOCK_WORDS + 1) * 4);
+  select_dir = p;
+  p += align8(((num_nodes - 1) / LOUDS_SELECT_SAMPLE + 1) * 4);
+  terminal_words = p;
+  p += num_terminal_words * 8;
+  terminal_rank_dir = p;
+  p += align8((num_terminal_words / LOUDS_RANK_BLOCK_WORDS + 1) * 4);
+  labels = p;
+  p += align8((num_nodes + 1) / 2);
+  results = p;
+  (void)num_terminals;
+  (void)len;
+}
+
+// Start the search (set root as the current node)
+void louds_start() {
+  lookup_node = 0;
+}
+
+// Go down one node
+int8_t louds_forward(uint8_t next_char) {
+  // The degree of node i is written in unary after the (i-1)th 0
+  unsigned int pos = lookup_node == 0 ? 0 : select0(lookup_node - 1) + 1;
+  // The kth 1 in the bit vector is the node k+1
+  unsigned int child = rank1(louds_words, rank_dir, pos) + 1;
+  unsigned int end;
+  uint64_t bits = load_word(louds_words, pos >> 6) >> (pos & 63);
+  unsigned int degree = CTZ64(~bits);
+  if (degree == 64 - (pos & 63)) {
+    // the run of 1s continues into the next word
+    degree += CTZ64(~load_word(louds_words, (pos >> 6) + 1));
+  }
+  for (end = child + degree; child < end; child++) {
+    uint8_t label = (labels[child >> 1] >> ((child & 1) * 4)) & 0xf;
+    if (label == next_char) {
+      lookup_node = child;
+      return 1;
+    }
+    if (label > next_char) {
+      // children are sorted by digit
+      return 0;
+    }
+  }
+  return 0;
+}
+
+// Get the result for the current node
+uint8_t louds_get_result() {
+  if (!((load_word(terminal_words, lookup_node >> 6) >> (lookup_node & 63)) & 1)) {
+    return '\0';
+  }
+  return results[rank1(terminal_words, terminal_rank_dir, lookup_node)];
+}
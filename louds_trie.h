@@ -0,0 +1,45 @@
+// Library for looking up a result in a LOUDS-encoded (succinct) trie
+//
+// Layout of the data (integers are little-endian, sections are 8-byte aligned):
+//
+//   uint32  number of nodes (n)
+//   uint32  number of terminal nodes (t)
+//   uint64  LOUDS bits[(2n-1+63)/64]   children of each node in BFS order
+//                                      as unary degree (1...10)
+//   uint32  rank[words/8+1]            number of 1s before every 512 bits
+//   uint32  select[(n-1)/256+1]        position of every 256th 0
+//   uint64  terminal bits[(n+63)/64]   1 if the node has a result
+//   uint32  terminal rank[words/8+1]   number of 1s before every 512 bits
+//   uint8   labels[(n+1)/2]            digit of each node, 4 bits per node
+//   uint8   results[t]                 result of each terminal node
+
+#ifndef LOUDS_TRIE_H
+#define LOUDS_TRIE_H
+
+#define LOUDS_RANK_BLOCK_WORDS  8
+#define LOUDS_SELECT_SAMPLE  256
+#define USE_STDINT  1
+
+#if USE_STDINT
+#include <stdint.h>
+#else
+typedef unsigned char uint8_t;
+typedef signed char int8_t;
+typedef unsigned int uint32_t;
+typedef unsigned long long uint64_t;
+#endif
+
+// Set trie data
+void louds_set_data(const uint8_t *data, unsigned int len);
+
+// Initialize the search (set root as the current node)
+void louds_start();
+
+// Go down one node
+// Only 4 bit values (0-15) are allowed as a next_char
+int8_t louds_forward(uint8_t next_char);
+
+// Get the result for the current node
+uint8_t louds_get_result();
+
+#endif // LOUDS_TRIE_H
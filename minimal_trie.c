@@ -2,55 +2,449 @@
 
 #include "minimal_trie.h"
 
-static unsigned int lookup_pos = 0;
-static uint8_t *trie_data;
-static unsigned int trie_data_len;
+#if USE_TELEMETRY
+#include "trie_telemetry.h"
+
+// Counters of the calling thread, NULL if they cannot be allocated
+static inline trie_telemetry_t *local_telemetry() {
+  trie_telemetry_t *telemetry = trie_telemetry_local;
+  return telemetry ? telemetry : trie_telemetry_register();
+}
+
+// Add n to a counter of the calling thread. Only this thread writes it, so a
+// relaxed load and store are enough for trie_telemetry_snapshot() to read it.
+#define TELEMETRY_ADD(telemetry, field, n)  \
+  __atomic_store_n(&(telemetry)->field, \
+      __atomic_load_n(&(telemetry)->field, __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+#define TELEMETRY_DEPTH(cursor)  \
+  ((cursor)->depth < TRIE_TELEMETRY_MAX_DEPTH ? (cursor)->depth : TRIE_TELEMETRY_MAX_DEPTH - 1)
+
+// Count the start of a lookup and decide whether to count its steps
+static void count_lookup(trie_cursor_t *cursor) {
+  trie_telemetry_t *telemetry = local_telemetry();
+  cursor->sampled = 0;
+  if (!telemetry) {
+    return;
+  }
+  TELEMETRY_ADD(telemetry, lookups, 1);
+  if (--telemetry->countdown == 0) {
+    telemetry->countdown = trie_telemetry_period;
+    TELEMETRY_ADD(telemetry, sampled, 1);
+    cursor->sampled = 1;
+  }
+}
+#endif
+
+static trie_cursor_t lookup_cursor;
+static unsigned int data_generation;
 
 // Set trie data
-void trie_set_data(uint8_t *data, unsigned int len) {
-  trie_data = data;
-  trie_data_len = len;
+void trie_set_data(const uint8_t *data, unsigned int len) {
+  lookup_cursor.trie.data = data;
+  lookup_cursor.trie.len = len;
+  trie_data_changed();
+}
+
+void trie_data_changed() {
+#if defined(__GNUC__)
+  __atomic_add_fetch(&data_generation, 1, __ATOMIC_RELEASE);
+#else
+  data_generation++;
+#endif
+}
+
+unsigned int trie_data_generation() {
+#if defined(__GNUC__)
+  return __atomic_load_n(&data_generation, __ATOMIC_ACQUIRE);
+#else
+  return data_generation;
+#endif
+}
+
+static uint32_t load_u32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// Get the table with the given ID from a multi-table blob
+trie_t trie_table_open(const uint8_t *blob, unsigned int id) {
+  trie_t table = { 0, 0 };
+  unsigned int num_tables = (blob[0] << 8) | blob[1];
+  if (id < num_tables) {
+    const uint8_t *entry = blob + MULTI_TABLE_HEADER_SIZE + id * MULTI_TABLE_ENTRY_SIZE;
+    table.data = blob + load_u32(entry);
+    table.len = load_u32(entry + 4);
+  }
+  return table;
+}
+
+// Find the ID of the table with the given name
+int trie_table_find(const uint8_t *blob, const char *name) {
+  unsigned int num_tables = (blob[0] << 8) | blob[1];
+  unsigned int id;
+  for (id = 0; id < num_tables; id++) {
+    const uint8_t *entry = blob + MULTI_TABLE_HEADER_SIZE + id * MULTI_TABLE_ENTRY_SIZE;
+    const char *table_name = (const char *)blob + load_u32(entry + 8);
+    const char *p = name;
+    while (*p && *p == *table_name) {
+      p++;
+      table_name++;
+    }
+    if (*p == *table_name) {
+      return id;
+    }
+  }
+  return -1;
+}
+
+// Open data built with build_trie --jump
+trie_jump_t trie_jump_open(const uint8_t *data, unsigned int len) {
+  trie_jump_t jump;
+  unsigned int table_len = 2;  // bytes per entry
+  uint8_t i;
+  jump.depth = data[0];
+  for (i = 0; i < jump.depth; i++) {
+    table_len *= 10;
+  }
+  jump.table = data + TRIE_JUMP_HEADER_SIZE;
+  jump.trie.data = jump.table + table_len;
+  jump.trie.len = len - TRIE_JUMP_HEADER_SIZE - table_len;
+  return jump;
+}
+
+// Open data built with build_trie --mph
+trie_mph_t trie_mph_open(const uint8_t *data, unsigned int len) {
+  trie_mph_t mph;
+  mph.num_keys = load_u32(data);
+  mph.num_buckets = load_u32(data + 4);
+  mph.seed = load_u32(data + 8);
+  mph.pilots = data + TRIE_MPH_HEADER_SIZE;
+  mph.entries = mph.pilots + mph.num_buckets * 4;
+  mph.trie.data = mph.entries + mph.num_keys * TRIE_MPH_ENTRY_SIZE;
+  mph.trie.len = len - (mph.trie.data - data);
+  return mph;
+}
+
+// Pack the number into the key as two big-endian words
+static inline int8_t pack_key(const uint8_t *digits, unsigned int len, uint32_t *words) {
+  unsigned int i;
+  if (len > TRIE_MPH_MAX_DIGITS) {
+    return 0;
+  }
+  words[0] = (uint32_t)len << 28;
+  words[1] = 0;
+  for (i = 0; i < len; i++) {
+    // digit i is in nibble i + 1
+    unsigned int nibble = i + 1;
+    if (digits[i] > 9) {
+      return 0;
+    }
+    words[nibble / 8] |= (uint32_t)digits[i] << (28 - (nibble % 8) * 4);
+  }
+  return 1;
+}
+
+static inline uint32_t mix32(uint32_t h) {
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+static inline uint32_t hash_words(const uint32_t *words, uint32_t seed) {
+  return mix32(mix32(words[0] ^ seed) ^ words[1]);
+}
+
+int8_t trie_mph_key(const uint8_t *digits, unsigned int len, uint8_t *key) {
+  uint32_t words[2];
+  unsigned int i;
+  if (!pack_key(digits, len, words)) {
+    return 0;
+  }
+  for (i = 0; i < TRIE_MPH_KEY_SIZE; i++) {
+    key[i] = words[i / 4] >> (24 - (i % 4) * 8);
+  }
+  return 1;
+}
+
+uint32_t trie_mph_hash(const uint8_t *key, uint32_t seed) {
+  uint32_t words[2];
+  words[0] = load_u32(key);
+  words[1] = load_u32(key + 4);
+  return hash_words(words, seed);
+}
+
+// Look up the number in the hash table first, which takes two loads
+uint8_t trie_mph_lookup(const trie_mph_t *mph, const uint8_t *digits, unsigned int len) {
+  uint32_t words[2];
+  if (mph->num_keys > 0 && pack_key(digits, len, words)) {
+    uint32_t bucket = hash_words(words, mph->seed) & (mph->num_buckets - 1);
+    uint32_t pilot = load_u32(mph->pilots + bucket * 4);
+    uint32_t slot = hash_words(words, mph->seed + TRIE_MPH_PILOT_STEP * (pilot + 1)) %
+      mph->num_keys;
+    const uint8_t *entry = mph->entries + slot * TRIE_MPH_ENTRY_SIZE;
+    if (load_u32(entry) == words[0] && load_u32(entry + 4) == words[1]) {
+      return entry[TRIE_MPH_KEY_SIZE];
+    }
+  }
+  return trie_lookup(&mph->trie, digits, len);
 }
 
 // Start the search (set root as the current node)
 void trie_start() {
-  lookup_pos = 0;
+  lookup_cursor.pos = 0;
+#if USE_TELEMETRY
+  lookup_cursor.depth = 0;
+  count_lookup(&lookup_cursor);
+#endif
 }
 
 // Go down one node
 int8_t trie_forward(uint8_t next_char) {
-  unsigned int total_descendants;
-  total_descendants = ((trie_data[lookup_pos] & 0xf) << 8) |
-    trie_data[lookup_pos+1];
-  unsigned int skipped_descendants = 0;
-  if (total_descendants == 0) {
-    // no descendants
-    return 0;
+  return trie_cursor_forward(&lookup_cursor, next_char);
+}
+
+// Get the result for the current node
+uint8_t trie_get_result() {
+  return trie_cursor_result(&lookup_cursor);
+}
+
+// Get the chars that trie_forward() would accept next
+uint16_t trie_next_mask() {
+  return trie_cursor_next_mask(&lookup_cursor);
+}
+
+// Return 1 if the current node has a result and no children
+int8_t trie_is_complete() {
+  return trie_cursor_is_complete(&lookup_cursor);
+}
+
+// Set root of the trie as the current node of the cursor
+void trie_cursor_start(trie_cursor_t *cursor, const trie_t *trie) {
+  cursor->trie = *trie;
+  cursor->pos = 0;
+#if USE_TELEMETRY
+  cursor->depth = 0;
+  count_lookup(cursor);
+#endif
+}
+
+#if USE_TELEMETRY
+// Count a step of a sampled lookup from the node of the cursor to the node
+// at pos, or a failed step if pos is end. The skipped siblings are counted
+// here, so that lookups which are not sampled do not count them.
+static void count_step(trie_cursor_t *cursor, unsigned int pos, unsigned int end) {
+  trie_telemetry_t *telemetry = local_telemetry();
+  const uint8_t *trie_data = cursor->trie.data;
+  unsigned int depth = TELEMETRY_DEPTH(cursor);
+  unsigned int skipped = 0;
+  unsigned int sibling_pos;
+  if (!telemetry) {
+    return;
+  }
+  for (sibling_pos = cursor->pos + NODE_SIZE(trie_data, cursor->pos); sibling_pos < pos;
+      sibling_pos += (NODE_DESCENDANTS(trie_data, sibling_pos) + 1) * BYTES_PER_NODE) {
+    skipped++;
   }
-  while (1) {
-    if (((trie_data[lookup_pos+BYTES_PER_NODE] & 0xf0) >> 4) == next_char) {
-      lookup_pos += BYTES_PER_NODE;
+  TELEMETRY_ADD(telemetry, steps[depth], 1);
+  TELEMETRY_ADD(telemetry, skipped[depth], skipped);
+  if (pos >= end) {
+    TELEMETRY_ADD(telemetry, misses[depth], 1);
+  } else {
+    if (pos / BYTES_PER_NODE < TRIE_TELEMETRY_MAX_NODES) {
+      TELEMETRY_ADD(telemetry, nodes[pos / BYTES_PER_NODE], 1);
+    }
+    if (cursor->depth < 255) {
+      cursor->depth++;
+    }
+  }
+}
+#endif
+
+// Go down one node from the current node of the cursor
+int8_t trie_cursor_forward(trie_cursor_t *cursor, uint8_t next_char) {
+  const uint8_t *trie_data = cursor->trie.data;
+  unsigned int lookup_pos = cursor->pos;
+  unsigned int end = lookup_pos + (NODE_DESCENDANTS(trie_data, lookup_pos) + 1) * BYTES_PER_NODE;
+  if (end > cursor->trie.len) {
+    end = cursor->trie.len;
+  }
+  lookup_pos += NODE_SIZE(trie_data, lookup_pos);
+  // visit each child once, skipping its subtree
+  while (lookup_pos < end) {
+    uint8_t node_char = NODE_CHAR(trie_data, lookup_pos);
+    if ((node_char == next_char && node_char != NODE_CHAR_SET) ||
+        (node_char == NODE_CHAR_SET && next_char < 10 &&
+         ((NODE_SET_MASK(trie_data, lookup_pos) >> next_char) & 1))) {
+#if USE_TELEMETRY
+      if (cursor->sampled) {
+        count_step(cursor, lookup_pos, end);
+      }
+#endif
+      cursor->pos = lookup_pos;
       return 1;
+    }
+    lookup_pos += (NODE_DESCENDANTS(trie_data, lookup_pos) + 1) * BYTES_PER_NODE;
+  }
+#if USE_TELEMETRY
+  if (cursor->sampled) {
+    count_step(cursor, end, end);
+  }
+#endif
+  return 0;
+}
+
+// Set the cursor to the node of the first digits with one table load
+int8_t trie_cursor_jump(trie_cursor_t *cursor, const trie_jump_t *jump, const uint8_t *digits) {
+  unsigned int index = 0;
+  unsigned int pos;
+  uint8_t i;
+  for (i = 0; i < jump->depth; i++) {
+    if (digits[i] > 9) {
+      return 0;
+    }
+    index = index * 10 + digits[i];
+  }
+  pos = (jump->table[index * 2] << 8) | jump->table[index * 2 + 1];
+  if (pos == TRIE_JUMP_MISS) {
+    return 0;
+  }
+  cursor->trie = jump->trie;
+  cursor->pos = pos;
+#if USE_TELEMETRY
+  cursor->depth = jump->depth;
+  count_lookup(cursor);
+#endif
+  return 1;
+}
+
+// Get the result for the node at the cursor
+static uint8_t node_result(const trie_cursor_t *cursor) {
+  const uint8_t *trie_data = cursor->trie.data;
+#if USE_TERMINAL_FLAG
+  // The nodes are followed by the rank directory and the results
+  unsigned int num_nodes = NODE_DESCENDANTS(trie_data, 0) + 1;
+  const uint8_t *terminal_rank_dir = trie_data + num_nodes * BYTES_PER_NODE;
+  const uint8_t *terminal_results = terminal_rank_dir +
+    ((num_nodes + TERMINAL_RANK_BLOCK - 1) / TERMINAL_RANK_BLOCK) * 2;
+  unsigned int node_index = cursor->pos / BYTES_PER_NODE;
+  unsigned int block_index = node_index / TERMINAL_RANK_BLOCK;
+  unsigned int rank;
+  unsigned int pos;
+  if (!NODE_IS_TERMINAL(trie_data, cursor->pos)) {
+    return '\0';
+  }
+  // The directory holds the number of terminals before each block
+  rank = (terminal_rank_dir[block_index * 2] << 8) | terminal_rank_dir[block_index * 2 + 1];
+  for (pos = block_index * TERMINAL_RANK_BLOCK * BYTES_PER_NODE; pos < cursor->pos;
+      pos += BYTES_PER_NODE) {
+    if (NODE_IS_TERMINAL(trie_data, pos)) {
+      rank++;
+    }
+  }
+  return terminal_results[rank];
+#else
+  return trie_data[cursor->pos + BYTES_PER_NODE - 1];
+#endif
+}
+
+// Get the result for the current node of the cursor
+uint8_t trie_cursor_result(const trie_cursor_t *cursor) {
+#if USE_TELEMETRY
+  uint8_t result = node_result(cursor);
+  trie_telemetry_t *telemetry;
+  if (cursor->sampled && (telemetry = local_telemetry()) != NULL) {
+    if (result != '\0') {
+      TELEMETRY_ADD(telemetry, hits[TELEMETRY_DEPTH(cursor)], 1);
+      TELEMETRY_ADD(telemetry, results[result], 1);
     } else {
-      unsigned int num_descendants;
-      num_descendants = ((trie_data[lookup_pos+BYTES_PER_NODE] & 0xf) << 8) |
-        trie_data[lookup_pos+BYTES_PER_NODE+1];
-      if (skipped_descendants + num_descendants + 1 >= total_descendants) {
-        // all descendants have been traversed
-        return 0;
-      }
-      if (lookup_pos + BYTES_PER_NODE * (num_descendants+2) >= trie_data_len) {
-        // not found
-        return 0;
-      }
-      lookup_pos += BYTES_PER_NODE * (num_descendants+1);
-      // skip nodes
-      skipped_descendants += num_descendants + 1;
+      TELEMETRY_ADD(telemetry, misses[TELEMETRY_DEPTH(cursor)], 1);
     }
   }
+  return result;
+#else
+  return node_result(cursor);
+#endif
 }
 
-// Get the result for the current node
-uint8_t trie_get_result() {
-  return trie_data[lookup_pos + BYTES_PER_NODE - 1];
+// Look up the whole number digits[0..len) from the root of the trie
+uint8_t trie_lookup(const trie_t *trie, const uint8_t *digits, unsigned int len) {
+  trie_cursor_t cursor;
+  unsigned int i;
+  trie_cursor_start(&cursor, trie);
+  for (i = 0; i < len; i++) {
+    if (trie_cursor_forward(&cursor, digits[i]) != 1) {
+      return '\0';
+    }
+  }
+  return trie_cursor_result(&cursor);
+}
+
+// Get the chars that trie_cursor_forward() would accept next
+uint16_t trie_cursor_next_mask(const trie_cursor_t *cursor) {
+  const uint8_t *trie_data = cursor->trie.data;
+  unsigned int end = cursor->pos + (NODE_DESCENDANTS(trie_data, cursor->pos) + 1) * BYTES_PER_NODE;
+  unsigned int pos = cursor->pos + NODE_SIZE(trie_data, cursor->pos);
+  uint16_t mask = 0;
+  // visit each child once, skipping its subtree
+  while (pos < end && pos < cursor->trie.len) {
+    if (NODE_CHAR(trie_data, pos) == NODE_CHAR_SET) {
+      mask |= NODE_SET_MASK(trie_data, pos);
+    } else {
+      mask |= 1u << NODE_CHAR(trie_data, pos);
+    }
+    pos += (NODE_DESCENDANTS(trie_data, pos) + 1) * BYTES_PER_NODE;
+  }
+  return mask;
+}
+
+// Return 1 if the current node of the cursor has a result and no children
+int8_t trie_cursor_is_complete(const trie_cursor_t *cursor) {
+  const uint8_t *trie_data = cursor->trie.data;
+  // a node without children has only its own slots in its subtree
+  return (NODE_DESCENDANTS(trie_data, cursor->pos) + 1) * BYTES_PER_NODE ==
+    NODE_SIZE(trie_data, cursor->pos) && node_result(cursor) != '\0';
+}
+
+// Offset of the results of the summaries, after the packed trie, or 0 if
+// the trie has none
+static unsigned int summary_offset(const trie_t *trie) {
+#if USE_TERMINAL_FLAG
+  // the terminal-flag format has its own tables after the nodes
+  (void)trie;
+  return 0;
+#else
+  unsigned int offset = (NODE_DESCENDANTS(trie->data, 0) + 1) * BYTES_PER_NODE;
+  if (trie->len <= offset ||
+      trie->len != offset + 1 + trie->data[offset] + (offset / BYTES_PER_NODE) *
+      TRIE_SUMMARY_ENTRY_SIZE) {
+    return 0;
+  }
+  return offset;
+#endif
+}
+
+int8_t trie_cursor_summary(const trie_cursor_t *cursor, trie_summary_t *summary) {
+  unsigned int offset = summary_offset(&cursor->trie);
+  const uint8_t *entry;
+  if (offset == 0) {
+    return 0;
+  }
+  entry = cursor->trie.data + offset + 1 + cursor->trie.data[offset] +
+    (cursor->pos / BYTES_PER_NODE) * TRIE_SUMMARY_ENTRY_SIZE;
+  summary->results = ((uint32_t)entry[0] << 24) | ((uint32_t)entry[1] << 16) |
+    (entry[2] << 8) | entry[3];
+  summary->min_digits = entry[4];
+  summary->max_digits = entry[5];
+  summary->num_terminals = (entry[6] << 8) | entry[7];
+  return 1;
+}
+
+uint8_t trie_summary_result(const trie_t *trie, unsigned int n) {
+  unsigned int offset = summary_offset(trie);
+  if (offset == 0 || n >= trie->data[offset]) {
+    return '\0';
+  }
+  return trie->data[offset + 1 + n];
 }
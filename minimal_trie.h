@@ -1,7 +1,25 @@
 #ifndef MINIMAL_TRIE_H
 #define MINIMAL_TRIE_H
 
+// Store a terminal flag in each node instead of the result byte, and keep
+// the results in a separate array (build the data with build_trie -f terminal)
+#ifndef USE_TERMINAL_FLAG
+#define USE_TERMINAL_FLAG  0
+#endif
+
+// Count lookups per thread for trie_telemetry.h (link trie_telemetry.o)
+#ifndef USE_TELEMETRY
+#define USE_TELEMETRY  0
+#endif
+
+// Number of nodes per entry in the terminal rank directory
+#define TERMINAL_RANK_BLOCK  16
+
+#if USE_TERMINAL_FLAG
+#define BYTES_PER_NODE  2
+#else
 #define BYTES_PER_NODE  3
+#endif
 #define USE_STDINT  1
 
 #if USE_STDINT
@@ -9,19 +27,206 @@
 #else
 typedef unsigned char uint8_t;
 typedef signed char int8_t;
+typedef unsigned short uint16_t;
+typedef unsigned long uint32_t;
 #endif
 
+// Layout of a multi-table blob (integers are big-endian):
+//   uint16  number of tables
+//   {uint32 offset, uint32 length, uint32 name offset} for each table ID
+//   table names (NUL-terminated) and table data
+#define MULTI_TABLE_HEADER_SIZE  2
+#define MULTI_TABLE_ENTRY_SIZE  12
+
+// Layout of data built with build_trie --jump=k (integers are big-endian):
+//   uint8   k, uint8 0
+//   uint16  offset of the node for each k-digit prefix in the packed trie,
+//           indexed by the prefix read as a decimal number, or TRIE_JUMP_MISS
+//   packed trie
+#define TRIE_JUMP_HEADER_SIZE  2
+#define TRIE_JUMP_MAX_DEPTH  4
+#define TRIE_JUMP_MISS  0xffff
+
+// Layout of data built with build_trie --mph (integers are big-endian):
+//   uint32  number of literal numbers (n), uint32 number of buckets (a power
+//           of two), uint32 seed
+//   uint32  pilot of each bucket
+//   {key, uint8 result} in the slot of each number, where the key holds the
+//           number of digits in its first 4 bits and a digit in each 4 bits
+//           after it, padded with zeros
+//   packed trie of the other patterns
+// A number is in slot trie_mph_hash(key, seed + TRIE_MPH_PILOT_STEP *
+// (pilot + 1)) % n, where pilot is that of bucket trie_mph_hash(key, seed) &
+// (number of buckets - 1).
+#define TRIE_MPH_HEADER_SIZE  12
+#define TRIE_MPH_KEY_SIZE  8
+#define TRIE_MPH_ENTRY_SIZE  (TRIE_MPH_KEY_SIZE + 1)
+#define TRIE_MPH_MAX_DIGITS  15
+#define TRIE_MPH_PILOT_STEP  0x9e3779b9
+
+// Layout of data built with build_trie --summaries (integers are big-endian):
+//   packed trie, which ends where the descendants of the root end
+//   uint8   number of distinct results (up to TRIE_SUMMARY_MAX_RESULTS)
+//   uint8   each result, in the order of the bits of the result sets
+//   {uint32 set of the results in the subtree, uint8 fewest digits to a
+//    result, uint8 most digits to a result, uint16 number of nodes with a
+//    result in the subtree} for each slot of the packed trie
+// The data is still a packed trie; lookups never read past its root.
+#define TRIE_SUMMARY_ENTRY_SIZE  8
+#define TRIE_SUMMARY_MAX_RESULTS  32
+#define TRIE_SUMMARY_MAX_DIGITS  0xfe
+#define TRIE_SUMMARY_NONE  0xff
+
+// Decode the node at the byte offset pos
+#define NODE_CHAR(data, pos)  (((data)[pos] & 0xf0) >> 4)
+#if USE_TERMINAL_FLAG
+#define NODE_IS_TERMINAL(data, pos)  ((data)[pos] & 0x8)
+#define NODE_DESCENDANTS(data, pos)  ((((data)[pos] & 0x7) << 8) | (data)[(pos)+1])
+#else
+#define NODE_DESCENDANTS(data, pos)  ((((data)[pos] & 0xf) << 8) | (data)[(pos)+1])
+#endif
+
+// A node with the char NODE_CHAR_SET matches a set of digits, built from a
+// class such as [2-9] or x. The next slot holds the set as a 10-bit mask
+// (bit n for digit n) and is counted as a descendant of the node.
+#define NODE_CHAR_SET  0xf
+#define NODE_SET_MASK(data, pos)  \
+  ((((data)[(pos)+BYTES_PER_NODE] & 0x3) << 8) | (data)[(pos)+BYTES_PER_NODE+1])
+// Bytes taken by the node itself, so its first child is at pos + NODE_SIZE
+#define NODE_SIZE(data, pos)  \
+  (NODE_CHAR(data, pos) == NODE_CHAR_SET ? 2 * BYTES_PER_NODE : BYTES_PER_NODE)
+
+// Trie data and its length
+typedef struct trie_t {
+  const uint8_t *data;
+  unsigned int len;
+} trie_t;
+
 // Set trie data
-void trie_set_data(uint8_t *data, unsigned int len);
+void trie_set_data(const uint8_t *data, unsigned int len);
+
+// Tell caches of results (trie_cache.h) that trie data has changed, e.g.
+// after a trie file is mapped again at the same address. trie_set_data()
+// calls it.
+void trie_data_changed();
+
+// Number of trie_data_changed() calls so far
+unsigned int trie_data_generation();
+
+// Get the table with the given ID from a blob built with build_trie --multi
+// The returned data is NULL if the ID does not exist
+trie_t trie_table_open(const uint8_t *blob, unsigned int id);
+
+// Find the ID of the table with the given name
+// Return -1 if not found
+int trie_table_find(const uint8_t *blob, const char *name);
 
 // Initialize the search (set root as the current node)
 void trie_start();
 
 // Go down one node
-// Only 4 bit values (0-15) are allowed as a next_char
+// Only 4 bit values (0-15) are allowed as a next_char, and a node for a set
+// of digits is followed for any digit in the set
 int8_t trie_forward(uint8_t next_char);
 
 // Get the result for the current node
 uint8_t trie_get_result();
 
+// Get the chars that trie_forward() would accept next, as a bitmask with
+// bit n set for char n
+uint16_t trie_next_mask();
+
+// Return 1 if the current node has a result and no children, so no longer
+// input can match, otherwise 0
+int8_t trie_is_complete();
+
+// Position in a trie, for searching several tries or from several threads
+// at the same time
+typedef struct trie_cursor_t {
+  trie_t trie;
+  unsigned int pos;
+#if USE_TELEMETRY
+  uint8_t depth;    // digits consumed so far by a sampled lookup
+  uint8_t sampled;  // 1 if the steps of this lookup are counted
+#endif
+} trie_cursor_t;
+
+// Set root of the trie as the current node of the cursor
+void trie_cursor_start(trie_cursor_t *cursor, const trie_t *trie);
+
+// Go down one node from the current node of the cursor
+int8_t trie_cursor_forward(trie_cursor_t *cursor, uint8_t next_char);
+
+// Get the result for the current node of the cursor
+uint8_t trie_cursor_result(const trie_cursor_t *cursor);
+
+// Look up the whole number digits[0..len) from the root of the trie
+// Return its result, or '\0' if it has none
+uint8_t trie_lookup(const trie_t *trie, const uint8_t *digits, unsigned int len);
+
+// Get the chars that trie_cursor_forward() would accept next
+uint16_t trie_cursor_next_mask(const trie_cursor_t *cursor);
+
+// Return 1 if the current node of the cursor has a result and no children
+int8_t trie_cursor_is_complete(const trie_cursor_t *cursor);
+
+// What can still follow the current node of a cursor
+typedef struct trie_summary_t {
+  uint32_t results;         // bit n for trie_summary_result(trie, n)
+  uint8_t min_digits;       // fewest digits to a result, 0 if the node has one,
+                            // TRIE_SUMMARY_NONE if there is none
+  uint8_t max_digits;       // most digits to a result (at most
+                            // TRIE_SUMMARY_MAX_DIGITS), or TRIE_SUMMARY_NONE
+  uint16_t num_terminals;   // nodes with a result in the subtree
+} trie_summary_t;
+
+// Get the summary of the subtree of the current node, from data built with
+// build_trie --summaries, in constant time
+// Return 1 if success, 0 if the trie has no summaries
+int8_t trie_cursor_summary(const trie_cursor_t *cursor, trie_summary_t *summary);
+
+// Get the result of bit n of the result sets of the trie
+// Return '\0' if the trie has no such result
+uint8_t trie_summary_result(const trie_t *trie, unsigned int n);
+
+// Packed trie with a table that resolves its first digits in one load
+typedef struct trie_jump_t {
+  trie_t trie;           // the packed trie after the table
+  const uint8_t *table;
+  uint8_t depth;         // number of digits resolved by the table
+} trie_jump_t;
+
+// Open data built with build_trie --jump
+trie_jump_t trie_jump_open(const uint8_t *data, unsigned int len);
+
+// Set the cursor to the node of digits[0..jump->depth), skipping the top
+// levels of the trie, and continue with trie_cursor_forward()
+// Return 1 if the node exists, 0 if not
+int8_t trie_cursor_jump(trie_cursor_t *cursor, const trie_jump_t *jump, const uint8_t *digits);
+
+// Packed trie behind a hash table of literal numbers
+typedef struct trie_mph_t {
+  trie_t trie;           // the packed trie after the table
+  const uint8_t *pilots;
+  const uint8_t *entries;
+  uint32_t num_keys;
+  uint32_t num_buckets;
+  uint32_t seed;
+} trie_mph_t;
+
+// Open data built with build_trie --mph
+trie_mph_t trie_mph_open(const uint8_t *data, unsigned int len);
+
+// Look up the whole number digits[0..len) in the hash table, and in the trie
+// if it is not there
+// Return its result, or '\0' if it has none
+uint8_t trie_mph_lookup(const trie_mph_t *mph, const uint8_t *digits, unsigned int len);
+
+// Write the key of the number digits[0..len) for the hash table
+// Return 1 if success, 0 if the number is too long for a key
+int8_t trie_mph_key(const uint8_t *digits, unsigned int len, uint8_t *key);
+
+// Hash of a key
+uint32_t trie_mph_hash(const uint8_t *key, uint32_t seed);
+
 #endif // MINIMAL_TRIE_H
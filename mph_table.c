@@ -0,0 +1,301 @@
+// Put a minimal perfect hash table of literal numbers in front of a packed
+// trie
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mph_table.h"
+
+// Seeds tried before giving up, each with its own buckets
+#define MAX_SEEDS  16
+
+void mph_keys_init(mph_keys *keys) {
+  keys->entries = NULL;
+  keys->num_keys = 0;
+  keys->capacity = 0;
+}
+
+int8_t mph_keys_add(mph_keys *keys, const char *pat, unsigned int pat_len, char result) {
+  uint8_t digits[TRIE_MPH_MAX_DIGITS];
+  unsigned int i;
+  if (pat_len == 0 || pat_len > TRIE_MPH_MAX_DIGITS) {
+    return 0;
+  }
+  for (i = 0; i < pat_len; i++) {
+    if (pat[i] < '0' || pat[i] > '9') {
+      return 0;
+    }
+    digits[i] = pat[i] - '0';
+  }
+  if (keys->num_keys == keys->capacity) {
+    unsigned int capacity = keys->capacity ? keys->capacity * 2 : 1024;
+    uint8_t *entries = realloc(keys->entries, capacity * TRIE_MPH_ENTRY_SIZE);
+    if (!entries) {
+      fprintf(stderr, "malloc error for literal numbers\n");
+      return -1;
+    }
+    keys->entries = entries;
+    keys->capacity = capacity;
+  }
+  uint8_t *entry = keys->entries + keys->num_keys * TRIE_MPH_ENTRY_SIZE;
+  trie_mph_key(digits, pat_len, entry);
+  entry[TRIE_MPH_KEY_SIZE] = result;
+  keys->num_keys++;
+  return 1;
+}
+
+void mph_keys_free(mph_keys *keys) {
+  free(keys->entries);
+  mph_keys_init(keys);
+}
+
+// Write the digits of the key as a string
+static void key_string(const uint8_t *key, char *str) {
+  unsigned int len = key[0] >> 4;
+  unsigned int i;
+  for (i = 0; i < len; i++) {
+    str[i] = '0' + ((i % 2 == 0) ? key[(i + 1) / 2] & 0xf : key[(i + 1) / 2] >> 4);
+  }
+  str[len] = '\0';
+}
+
+void mph_keys_number(const mph_keys *keys, unsigned int i, char *str) {
+  key_string(keys->entries + i * TRIE_MPH_ENTRY_SIZE, str);
+}
+
+typedef struct sort_entry {
+  uint8_t entry[TRIE_MPH_ENTRY_SIZE];
+  unsigned int order;
+} sort_entry;
+
+static int compare_entries(const void *a, const void *b) {
+  const sort_entry *entry_a = a;
+  const sort_entry *entry_b = b;
+  int diff = memcmp(entry_a->entry, entry_b->entry, TRIE_MPH_KEY_SIZE);
+  if (diff != 0) {
+    return diff;
+  }
+  return entry_a->order < entry_b->order ? -1 : 1;
+}
+
+// Sort the numbers and keep the last result of each one
+// Return the number of unique numbers, or -1 if error
+static int unique_entries(const mph_keys *keys, uint8_t **unique) {
+  sort_entry *sorted = malloc(sizeof(sort_entry) * (keys->num_keys + 1));
+  uint8_t *entries = malloc(TRIE_MPH_ENTRY_SIZE * (keys->num_keys + 1));
+  unsigned int num_unique = 0;
+  unsigned int i;
+  if (!sorted || !entries) {
+    fprintf(stderr, "malloc error for literal numbers\n");
+    free(sorted);
+    free(entries);
+    return -1;
+  }
+  for (i = 0; i < keys->num_keys; i++) {
+    memcpy(sorted[i].entry, keys->entries + i * TRIE_MPH_ENTRY_SIZE, TRIE_MPH_ENTRY_SIZE);
+    sorted[i].order = i;
+  }
+  qsort(sorted, keys->num_keys, sizeof(sort_entry), compare_entries);
+  for (i = 0; i < keys->num_keys; i++) {
+    uint8_t *last = entries + (num_unique - 1) * TRIE_MPH_ENTRY_SIZE;
+    if (num_unique > 0 && memcmp(last, sorted[i].entry, TRIE_MPH_KEY_SIZE) == 0) {
+      char str[TRIE_MPH_MAX_DIGITS + 1];
+      key_string(last, str);
+      if (last[TRIE_MPH_KEY_SIZE] == sorted[i].entry[TRIE_MPH_KEY_SIZE]) {
+        fprintf(stderr, "duplicate result: %c for pattern %s\n", last[TRIE_MPH_KEY_SIZE], str);
+      } else {
+        fprintf(stderr, "warning: overwriting result: %c with %c for pattern %s\n",
+            last[TRIE_MPH_KEY_SIZE], sorted[i].entry[TRIE_MPH_KEY_SIZE], str);
+      }
+      last[TRIE_MPH_KEY_SIZE] = sorted[i].entry[TRIE_MPH_KEY_SIZE];
+    } else {
+      memcpy(entries + num_unique * TRIE_MPH_ENTRY_SIZE, sorted[i].entry, TRIE_MPH_ENTRY_SIZE);
+      num_unique++;
+    }
+  }
+  free(sorted);
+  *unique = entries;
+  return num_unique;
+}
+
+static uint32_t slot_of(const uint8_t *key, uint32_t seed, uint32_t pilot, uint32_t num_keys) {
+  return trie_mph_hash(key, seed + TRIE_MPH_PILOT_STEP * (pilot + 1)) % num_keys;
+}
+
+// Find a pilot for every bucket with the seed, and store the numbers in
+// their slots of table
+// Return 0 if success, 1 if a bucket has no pilot, -1 if error
+static int place_entries(const uint8_t *entries, uint32_t num_keys, uint32_t num_buckets,
+    uint32_t seed, uint32_t *pilots, uint8_t *table) {
+  unsigned int *bucket_start = calloc(num_buckets + 2, sizeof(unsigned int));
+  unsigned int *members = malloc(sizeof(unsigned int) * num_keys);
+  unsigned int *buckets = malloc(sizeof(unsigned int) * num_buckets);
+  uint32_t *slots = malloc(sizeof(uint32_t) * num_keys);
+  uint8_t *is_taken = calloc(num_keys, 1);
+  // the last buckets take about num_keys tries to find the last free slots
+  uint32_t max_pilot = num_keys < 0x3ffffff ? num_keys * 64 + 1024 : 0xfffffffe;
+  unsigned int max_size = 0;
+  unsigned int i;
+  int status = 0;
+  if (!bucket_start || !members || !buckets || !slots || !is_taken) {
+    fprintf(stderr, "malloc error for hash table\n");
+    status = -1;
+    goto done;
+  }
+
+  // members of bucket b are members[bucket_start[b]..bucket_start[b + 1])
+  for (i = 0; i < num_keys; i++) {
+    uint32_t bucket = trie_mph_hash(entries + i * TRIE_MPH_ENTRY_SIZE, seed) &
+      (num_buckets - 1);
+    bucket_start[bucket + 2]++;
+  }
+  for (i = 0; i < num_buckets; i++) {
+    unsigned int size = bucket_start[i + 2];
+    if (size > max_size) {
+      max_size = size;
+    }
+    bucket_start[i + 2] += bucket_start[i + 1];
+  }
+  for (i = 0; i < num_keys; i++) {
+    uint32_t bucket = trie_mph_hash(entries + i * TRIE_MPH_ENTRY_SIZE, seed) &
+      (num_buckets - 1);
+    members[bucket_start[bucket + 1]++] = i;
+  }
+
+  // largest buckets first, while most slots are free
+  unsigned int num_sorted = 0;
+  unsigned int size;
+  for (size = max_size; size > 0; size--) {
+    for (i = 0; i < num_buckets; i++) {
+      if (bucket_start[i + 1] - bucket_start[i] == size) {
+        buckets[num_sorted++] = i;
+      }
+    }
+  }
+  memset(pilots, 0, sizeof(uint32_t) * num_buckets);
+
+  for (i = 0; i < num_sorted; i++) {
+    unsigned int bucket = buckets[i];
+    unsigned int first = bucket_start[bucket];
+    unsigned int bucket_size = bucket_start[bucket + 1] - first;
+    uint32_t pilot;
+    for (pilot = 0; pilot < max_pilot; pilot++) {
+      unsigned int j;
+      for (j = 0; j < bucket_size; j++) {
+        unsigned int k;
+        slots[j] = slot_of(entries + members[first + j] * TRIE_MPH_ENTRY_SIZE,
+            seed, pilot, num_keys);
+        if (is_taken[slots[j]]) {
+          break;
+        }
+        for (k = 0; k < j && slots[k] != slots[j]; k++) {
+        }
+        if (k < j) {
+          break;
+        }
+      }
+      if (j == bucket_size) {
+        break;
+      }
+    }
+    if (pilot == max_pilot) {
+      status = 1;
+      goto done;
+    }
+    pilots[bucket] = pilot;
+    unsigned int j;
+    for (j = 0; j < bucket_size; j++) {
+      is_taken[slots[j]] = 1;
+      memcpy(table + slots[j] * TRIE_MPH_ENTRY_SIZE,
+          entries + members[first + j] * TRIE_MPH_ENTRY_SIZE, TRIE_MPH_ENTRY_SIZE);
+    }
+  }
+
+done:
+  free(bucket_start);
+  free(members);
+  free(buckets);
+  free(slots);
+  free(is_taken);
+  return status;
+}
+
+static void store_u32(uint8_t *p, uint32_t value) {
+  p[0] = value >> 24;
+  p[1] = (value >> 16) & 0xff;
+  p[2] = (value >> 8) & 0xff;
+  p[3] = value & 0xff;
+}
+
+int mph_table_build(mph_keys *keys, const uint8_t *packed, int packed_len, uint8_t **out) {
+  uint8_t *entries;
+  int num_keys = unique_entries(keys, &entries);
+  if (num_keys < 0) {
+    return -1;
+  }
+  uint32_t num_buckets = 1;
+  while (num_buckets * MPH_TABLE_BUCKET_SIZE < (uint32_t)num_keys) {
+    num_buckets <<= 1;
+  }
+  unsigned int table_len = TRIE_MPH_HEADER_SIZE + num_buckets * 4 +
+    num_keys * TRIE_MPH_ENTRY_SIZE;
+  uint32_t *pilots = malloc(sizeof(uint32_t) * (num_buckets + 1));
+  uint8_t *data = malloc(table_len + packed_len);
+  uint32_t seed;
+  int status = 0;
+  unsigned int i;
+  if (!pilots || !data) {
+    fprintf(stderr, "malloc error for hash table\n");
+    free(entries);
+    free(pilots);
+    free(data);
+    return -1;
+  }
+  uint8_t *table = data + TRIE_MPH_HEADER_SIZE + num_buckets * 4;
+  for (seed = 1; num_keys > 0 && seed <= MAX_SEEDS; seed++) {
+    status = place_entries(entries, num_keys, num_buckets, seed, pilots, table);
+    if (status != 1) {
+      break;
+    }
+  }
+  // the table is looked up first; a number whose pattern came after another
+  // pattern matching it keeps its own result, as without the table
+  trie_t trie = { packed, packed_len };
+  for (i = 0; i < (unsigned int)num_keys; i++) {
+    const uint8_t *entry = entries + i * TRIE_MPH_ENTRY_SIZE;
+    char str[TRIE_MPH_MAX_DIGITS + 1];
+    uint8_t digits[TRIE_MPH_MAX_DIGITS];
+    uint8_t result;
+    unsigned int j;
+    key_string(entry, str);
+    for (j = 0; str[j]; j++) {
+      digits[j] = str[j] - '0';
+    }
+    result = trie_lookup(&trie, digits, j);
+    if (result != '\0' && result != entry[TRIE_MPH_KEY_SIZE]) {
+      fprintf(stderr, "warning: %s also matches an earlier pattern with result %c, %c is used\n",
+          str, result, entry[TRIE_MPH_KEY_SIZE]);
+    }
+  }
+  free(entries);
+  if (status != 0) {
+    if (status == 1) {
+      fprintf(stderr, "error: no hash table found for %d numbers\n", num_keys);
+    }
+    free(pilots);
+    free(data);
+    return -1;
+  }
+
+  store_u32(data, num_keys);
+  store_u32(data + 4, num_buckets);
+  store_u32(data + 8, seed);
+  for (i = 0; i < num_buckets; i++) {
+    store_u32(data + TRIE_MPH_HEADER_SIZE + i * 4, pilots[i]);
+  }
+  memcpy(table + num_keys * TRIE_MPH_ENTRY_SIZE, packed, packed_len);
+  free(pilots);
+  *out = data;
+  return table_len + packed_len;
+}
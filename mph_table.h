@@ -0,0 +1,42 @@
+// Put a minimal perfect hash table of literal numbers in front of a packed
+// trie, read by trie_mph_open()
+//
+// The numbers are hashed into a power of two of buckets, holding at most
+// MPH_TABLE_BUCKET_SIZE numbers on average, and the buckets, largest first,
+// each get the first pilot that puts all of their numbers into free slots
+// (hash and displace). The table has exactly one slot per number, which
+// holds its key to reject numbers that are not in the table.
+
+#ifndef MPH_TABLE_H
+#define MPH_TABLE_H
+
+#include "minimal_trie.h"
+
+#define MPH_TABLE_BUCKET_SIZE  4
+
+// Literal numbers and their results, in the order they were added
+typedef struct mph_keys {
+  uint8_t *entries;  // TRIE_MPH_ENTRY_SIZE bytes each: key, result
+  unsigned int num_keys;
+  unsigned int capacity;
+} mph_keys;
+
+// Initialize an empty set of numbers
+void mph_keys_init(mph_keys *keys);
+
+// Add the pattern if it is a plain number of up to TRIE_MPH_MAX_DIGITS digits
+// Return 1 if it was added, 0 if it is not such a number, -1 if error
+int8_t mph_keys_add(mph_keys *keys, const char *pat, unsigned int pat_len, char result);
+
+// Free the numbers
+void mph_keys_free(mph_keys *keys);
+
+// Write number i of the ones added as a string of up to TRIE_MPH_MAX_DIGITS digits
+void mph_keys_number(const mph_keys *keys, unsigned int i, char *str);
+
+// Build the data from the numbers and the packed trie of the other patterns
+// A number added more than once keeps its last result
+// Return the length of *out, or -1 if error
+int mph_table_build(mph_keys *keys, const uint8_t *packed, int packed_len, uint8_t **out);
+
+#endif // MPH_TABLE_H
@@ -0,0 +1,74 @@
+// Combine several packed tries into one blob read by trie_table_open()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "multi_table.h"
+
+static void store_u32(uint8_t *p, uint32_t value) {
+  p[0] = (value >> 24) & 0xff;
+  p[1] = (value >> 16) & 0xff;
+  p[2] = (value >> 8) & 0xff;
+  p[3] = value & 0xff;
+}
+
+// Find a subtree in data[start..end) with the same contents as table,
+// ignoring the digit of the subtree root
+// Return its offset, or -1 if not found
+static int find_subtree(uint8_t *data, int start, int end, uint8_t *table, int table_len) {
+  int pos;
+  for (pos = start; pos + table_len <= end; pos += BYTES_PER_NODE) {
+    if (NODE_DESCENDANTS(data, pos) == NODE_DESCENDANTS(table, 0) &&
+        memcmp(data + pos + 1, table + 1, table_len - 1) == 0) {
+      return pos;
+    }
+  }
+  return -1;
+}
+
+int multi_table_build(uint8_t **tables, int *table_lens, char **names, int num_tables,
+    uint8_t **out) {
+  int len = MULTI_TABLE_HEADER_SIZE + num_tables * MULTI_TABLE_ENTRY_SIZE;
+  int i;
+  if (num_tables > 0xffff) {
+    fprintf(stderr, "error: too many tables (%d > %d)\n", num_tables, 0xffff);
+    return -1;
+  }
+  for (i = 0; i < num_tables; i++) {
+    len += strlen(names[i]) + 1 + table_lens[i];
+  }
+  uint8_t *blob = malloc(len);
+  if (!blob) {
+    fprintf(stderr, "malloc error for multi-table blob\n");
+    return -1;
+  }
+
+  blob[0] = num_tables >> 8;
+  blob[1] = num_tables & 0xff;
+  int offset = MULTI_TABLE_HEADER_SIZE + num_tables * MULTI_TABLE_ENTRY_SIZE;
+  for (i = 0; i < num_tables; i++) {
+    uint8_t *entry = blob + MULTI_TABLE_HEADER_SIZE + i * MULTI_TABLE_ENTRY_SIZE;
+    store_u32(entry + 8, offset);
+    strcpy((char *)blob + offset, names[i]);
+    offset += strlen(names[i]) + 1;
+  }
+
+  int data_start = offset;
+  for (i = 0; i < num_tables; i++) {
+    uint8_t *entry = blob + MULTI_TABLE_HEADER_SIZE + i * MULTI_TABLE_ENTRY_SIZE;
+    int table_offset = find_subtree(blob, data_start, offset, tables[i], table_lens[i]);
+    if (table_offset < 0) {
+      table_offset = offset;
+      memcpy(blob + offset, tables[i], table_lens[i]);
+      offset += table_lens[i];
+    } else {
+      fprintf(stderr, "table %s shares data at offset %d\n", names[i], table_offset);
+    }
+    store_u32(entry, table_offset);
+    store_u32(entry + 4, table_lens[i]);
+  }
+
+  *out = blob;
+  return offset;
+}
@@ -0,0 +1,14 @@
+// Combine several packed tries into one blob read by trie_table_open()
+
+#ifndef MULTI_TABLE_H
+#define MULTI_TABLE_H
+
+#include "minimal_trie.h"
+
+// Build the blob from the packed tables; the ID of each table is its index
+// A table identical to another table or to a subtree of it is stored only once
+// Return the length of *out, or -1 if error
+int multi_table_build(uint8_t **tables, int *table_lens, char **names, int num_tables,
+    uint8_t **out);
+
+#endif // MULTI_TABLE_H
@@ -0,0 +1,337 @@
+// Trie of numbers that changes while it is read, with lock-free readers
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mutable_trie.h"
+
+#define MAX_DESCENDANTS  0xfff
+
+struct mutable_node {
+  mutable_node *children[10];
+  uint8_t result;
+  mutable_node *next_retired;
+  unsigned long retired_epoch;  // global_epoch when the node was unlinked
+};
+
+// Read section of one thread
+typedef struct reader {
+  unsigned long epoch;  // global_epoch when the section began, 0 outside
+  unsigned int depth;   // nested sections, only used by the owner
+  struct reader *next;
+} reader;
+
+static __thread reader *local_reader;
+
+// Readers of all threads, pushed without a lock and never removed
+static reader *registry;
+
+// Advanced by each reclaim, so a reader that began after an unlink has an
+// epoch above that of the nodes it unlinked
+static unsigned long global_epoch = 1;
+
+// Child pointers and results are read while the writer changes them
+#define LOAD(field)  __atomic_load_n(&(field), __ATOMIC_ACQUIRE)
+#define PUBLISH(field, value)  __atomic_store_n(&(field), (value), __ATOMIC_RELEASE)
+
+static reader *register_reader() {
+  reader *r = calloc(1, sizeof(reader));
+  if (!r) {
+    return NULL;
+  }
+  r->next = __atomic_load_n(&registry, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&registry, &r->next, r, 1,
+        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+  }
+  local_reader = r;
+  return r;
+}
+
+int mutable_trie_read_begin() {
+  reader *r = local_reader;
+  if (!r && !(r = register_reader())) {
+    return -1;
+  }
+  if (r->depth++ == 0) {
+    __atomic_store_n(&r->epoch, __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST),
+        __ATOMIC_RELAXED);
+    // the epoch must be visible before any node is read, as the unlinks
+    // must be before the writer reads the epochs in mutable_trie_reclaim()
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  }
+  return 0;
+}
+
+void mutable_trie_read_end() {
+  reader *r = local_reader;
+  if (r && r->depth > 0 && --r->depth == 0) {
+    __atomic_store_n(&r->epoch, 0, __ATOMIC_RELEASE);
+  }
+}
+
+void mutable_cursor_start(mutable_cursor_t *cursor, const mutable_trie_t *trie) {
+  cursor->node = trie->root;
+}
+
+int8_t mutable_cursor_forward(mutable_cursor_t *cursor, uint8_t digit) {
+  const mutable_node *child;
+  if (digit > 9 || !cursor->node) {
+    return 0;
+  }
+  child = LOAD(cursor->node->children[digit]);
+  if (!child) {
+    return 0;
+  }
+  cursor->node = child;
+  return 1;
+}
+
+uint8_t mutable_cursor_result(const mutable_cursor_t *cursor) {
+  return cursor->node ? LOAD(cursor->node->result) : '\0';
+}
+
+uint8_t mutable_trie_lookup(const mutable_trie_t *trie, const uint8_t *digits, unsigned int len) {
+  mutable_cursor_t cursor;
+  uint8_t result = '\0';
+  unsigned int i;
+  if (mutable_trie_read_begin() != 0) {
+    return '\0';
+  }
+  mutable_cursor_start(&cursor, trie);
+  for (i = 0; i < len; i++) {
+    if (mutable_cursor_forward(&cursor, digits[i]) != 1) {
+      break;
+    }
+  }
+  if (i == len) {
+    result = mutable_cursor_result(&cursor);
+  }
+  mutable_trie_read_end();
+  return result;
+}
+
+int mutable_trie_init(mutable_trie_t *trie) {
+  memset(trie, 0, sizeof(*trie));
+  trie->root = calloc(1, sizeof(mutable_node));
+  if (!trie->root) {
+    fprintf(stderr, "malloc error for mutable trie\n");
+    return -1;
+  }
+  trie->num_nodes = 1;
+  return 0;
+}
+
+static void free_node(mutable_node *node) {
+  unsigned int digit;
+  for (digit = 0; digit < 10; digit++) {
+    if (node->children[digit]) {
+      free_node(node->children[digit]);
+    }
+  }
+  free(node);
+}
+
+void mutable_trie_free(mutable_trie_t *trie) {
+  mutable_node *node = trie->retired;
+  while (node) {
+    mutable_node *next = node->next_retired;
+    free(node);
+    node = next;
+  }
+  if (trie->root) {
+    free_node(trie->root);
+  }
+  memset(trie, 0, sizeof(*trie));
+}
+
+int mutable_trie_insert(mutable_trie_t *trie, const uint8_t *digits, unsigned int len,
+    uint8_t result) {
+  mutable_node *node = trie->root;
+  mutable_node *branch = NULL;
+  unsigned int i;
+  if (len > MUTABLE_TRIE_MAX_DIGITS || result == '\0') {
+    fprintf(stderr, "error: cannot insert a number of %u digits with result %d\n", len, result);
+    return -1;
+  }
+  for (i = 0; i < len; i++) {
+    if (digits[i] > 9) {
+      fprintf(stderr, "error: digit %d is not 0-9\n", digits[i]);
+      return -1;
+    }
+  }
+  // follow the nodes that exist
+  for (i = 0; i < len && node->children[digits[i]]; i++) {
+    node = node->children[digits[i]];
+  }
+  if (i == len) {
+    PUBLISH(node->result, result);
+    return 0;
+  }
+
+  // build the rest of the number out of sight of the readers, from the end
+  unsigned int j;
+  for (j = len; j > i; j--) {
+    mutable_node *new_node = calloc(1, sizeof(mutable_node));
+    if (!new_node) {
+      fprintf(stderr, "malloc error for mutable trie\n");
+      if (branch) {
+        free_node(branch);
+      }
+      return -1;
+    }
+    if (branch) {
+      new_node->children[digits[j]] = branch;
+    } else {
+      new_node->result = result;
+    }
+    branch = new_node;
+    trie->num_nodes++;
+  }
+  PUBLISH(node->children[digits[i]], branch);
+  return 0;
+}
+
+// Unlink the child of parent; readers may still be in it, so it is freed
+// later by mutable_trie_reclaim()
+static void retire(mutable_trie_t *trie, mutable_node *parent, uint8_t digit) {
+  mutable_node *node = parent->children[digit];
+  PUBLISH(parent->children[digit], NULL);
+  node->retired_epoch = __atomic_load_n(&global_epoch, __ATOMIC_RELAXED);
+  node->next_retired = trie->retired;
+  trie->retired = node;
+  trie->num_nodes--;
+  trie->num_retired++;
+}
+
+static int has_children(const mutable_node *node) {
+  unsigned int digit;
+  for (digit = 0; digit < 10; digit++) {
+    if (node->children[digit]) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int mutable_trie_delete(mutable_trie_t *trie, const uint8_t *digits, unsigned int len) {
+  mutable_node *path[MUTABLE_TRIE_MAX_DIGITS + 1];
+  mutable_node *node = trie->root;
+  unsigned int i;
+  if (len > MUTABLE_TRIE_MAX_DIGITS) {
+    return 0;
+  }
+  path[0] = node;
+  for (i = 0; i < len; i++) {
+    if (digits[i] > 9 || !(node = node->children[digits[i]])) {
+      return 0;
+    }
+    path[i + 1] = node;
+  }
+  if (node->result == '\0') {
+    return 0;
+  }
+  PUBLISH(node->result, '\0');
+  // unlink the nodes that lead to no result any more, from the bottom
+  for (i = len; i > 0 && path[i]->result == '\0' && !has_children(path[i]); i--) {
+    retire(trie, path[i - 1], digits[i - 1]);
+  }
+  mutable_trie_reclaim(trie);
+  return 1;
+}
+
+unsigned long mutable_trie_reclaim(mutable_trie_t *trie) {
+  mutable_node **link = &trie->retired;
+  unsigned long oldest;
+  unsigned long num_freed = 0;
+  reader *r;
+  if (!trie->retired) {
+    return 0;
+  }
+  // readers that begin from now on cannot reach the unlinked nodes
+  oldest = __atomic_add_fetch(&global_epoch, 1, __ATOMIC_SEQ_CST);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  for (r = __atomic_load_n(&registry, __ATOMIC_ACQUIRE); r; r = r->next) {
+    unsigned long epoch = __atomic_load_n(&r->epoch, __ATOMIC_ACQUIRE);
+    if (epoch != 0 && epoch < oldest) {
+      oldest = epoch;
+    }
+  }
+  // a node unlinked before the oldest section began is out of every reader's reach
+  while (*link) {
+    mutable_node *node = *link;
+    if (node->retired_epoch < oldest) {
+      *link = node->next_retired;
+      free(node);
+      num_freed++;
+    } else {
+      link = &node->next_retired;
+    }
+  }
+  trie->num_retired -= num_freed;
+  return num_freed;
+}
+
+// New packed trie
+typedef struct packer {
+  uint8_t *out;
+  unsigned int len;
+  unsigned int capacity;
+} packer;
+
+// Write the node and its subtree, with the children in order of digits
+// Return the number of slots, or 0 if error
+static unsigned int pack_node(packer *p, const mutable_node *node, uint8_t digit) {
+  unsigned int pos = p->len;
+  unsigned int num_slots = 1;
+  unsigned int child_digit;
+  if (p->len + BYTES_PER_NODE > p->capacity) {
+    unsigned int capacity = p->capacity * 2;
+    uint8_t *out = realloc(p->out, capacity);
+    if (!out) {
+      fprintf(stderr, "malloc error for the packed trie\n");
+      return 0;
+    }
+    p->out = out;
+    p->capacity = capacity;
+  }
+  p->len += BYTES_PER_NODE;
+  for (child_digit = 0; child_digit < 10; child_digit++) {
+    const mutable_node *child = LOAD(node->children[child_digit]);
+    if (child) {
+      unsigned int child_slots = pack_node(p, child, child_digit);
+      if (child_slots == 0) {
+        return 0;
+      }
+      num_slots += child_slots;
+    }
+  }
+  // the descendants may be too many, which is checked with the root
+  p->out[pos] = (digit << 4) | (((num_slots - 1) >> 8) & 0xf);
+  p->out[pos + 1] = (num_slots - 1) & 0xff;
+  p->out[pos + 2] = LOAD(node->result);
+  return num_slots;
+}
+
+int mutable_trie_pack(const mutable_trie_t *trie, uint8_t **out) {
+  packer p;
+  unsigned int num_slots;
+  p.capacity = 64 * BYTES_PER_NODE;
+  p.len = 0;
+  p.out = malloc(p.capacity);
+  if (!p.out) {
+    fprintf(stderr, "malloc error for the packed trie\n");
+    return -1;
+  }
+  num_slots = pack_node(&p, trie->root, 0);
+  if (num_slots == 0 || num_slots - 1 > MAX_DESCENDANTS) {
+    if (num_slots > 0) {
+      fprintf(stderr, "error: trie is too large (number of descendants: %u > %d)\n",
+          num_slots - 1, MAX_DESCENDANTS);
+    }
+    free(p.out);
+    return -1;
+  }
+  *out = p.out;
+  return p.len;
+}
@@ -0,0 +1,83 @@
+// Trie of numbers that changes while it is read, for data such as ported
+// numbers and temporary blocks that changes too often to rebuild a packed
+// trie for every change
+//
+// One writer thread at a time inserts and deletes numbers, while any number
+// of reader threads look them up without locks. The writer builds a new
+// branch where no reader can see it and publishes it with one atomic store
+// of the child pointer, and stores a new result with one atomic store, so a
+// reader sees a number either before or after a change, never half of it.
+// A deleted branch is unlinked with one store and freed once every reader
+// that might still be in it has left (epoch-based reclamation).
+// mutable_trie_pack() writes the trie in the packed format.
+
+#ifndef MUTABLE_TRIE_H
+#define MUTABLE_TRIE_H
+
+#include "minimal_trie.h"
+
+#define MUTABLE_TRIE_MAX_DIGITS  32
+
+typedef struct mutable_node mutable_node;
+
+typedef struct mutable_trie_t {
+  mutable_node *root;
+  mutable_node *retired;       // unlinked nodes not freed yet, newest first
+  unsigned long num_nodes;     // nodes reachable from the root
+  unsigned long num_retired;
+} mutable_trie_t;
+
+// Position of a reader in the trie
+typedef struct mutable_cursor_t {
+  const mutable_node *node;
+} mutable_cursor_t;
+
+// Functions for readers, from any thread
+
+// Enter and leave a read section, in which the nodes reached by a cursor
+// are not freed. Sections may be nested.
+// Return 0 if success, -1 if the thread cannot be registered
+int mutable_trie_read_begin();
+void mutable_trie_read_end();
+
+// Walk the trie digit by digit, inside a read section
+void mutable_cursor_start(mutable_cursor_t *cursor, const mutable_trie_t *trie);
+// Return 1 if the next node exists, 0 if not
+int8_t mutable_cursor_forward(mutable_cursor_t *cursor, uint8_t digit);
+// Return the result of the current node, or '\0' if it has none
+uint8_t mutable_cursor_result(const mutable_cursor_t *cursor);
+
+// Look up the whole number digits[0..len) in a read section of its own
+// Return its result, or '\0' if it has none
+uint8_t mutable_trie_lookup(const mutable_trie_t *trie, const uint8_t *digits, unsigned int len);
+
+// Functions for the writer, from one thread at a time
+
+// Create an empty trie
+// Return 0 if success, -1 if error
+int mutable_trie_init(mutable_trie_t *trie);
+
+// Free the trie, when no reader uses it any more
+void mutable_trie_free(mutable_trie_t *trie);
+
+// Set the result of the number, adding it if needed
+// Return 0 if success, -1 if error
+int mutable_trie_insert(mutable_trie_t *trie, const uint8_t *digits, unsigned int len,
+    uint8_t result);
+
+// Remove the number and the nodes left without a result below them
+// Return 1 if it was in the trie, 0 if not
+int mutable_trie_delete(mutable_trie_t *trie, const uint8_t *digits, unsigned int len);
+
+// Free the unlinked nodes that no reader can be in any more. The writer
+// calls this itself after deleting.
+// Return the number of nodes freed
+unsigned long mutable_trie_reclaim(mutable_trie_t *trie);
+
+// Write the trie in the packed format into newly allocated memory, from the
+// writer thread or inside a read section
+// Return the length of *out, or -1 if error (including a trie too large for
+// the packed format)
+int mutable_trie_pack(const mutable_trie_t *trie, uint8_t **out);
+
+#endif // MUTABLE_TRIE_H
@@ -0,0 +1,218 @@
+// Read a pattern file into the trie builder
+//
+// The file is mapped into memory and split into lines with memchr, and each
+// pattern is passed to the builder as a slice of the mapping without being
+// copied. Files that cannot be mapped, such as pipes, are read into memory.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pattern_file.h"
+
+// A pattern added to the trie while numbers go to the hash table
+typedef struct trie_pattern {
+  const char *pat;
+  unsigned int pat_len;
+  unsigned int num_literals;  // numbers added before it
+} trie_pattern;
+
+typedef struct trie_patterns {
+  trie_pattern *items;
+  unsigned int num_items;
+  unsigned int capacity;
+} trie_patterns;
+
+// Read the whole file into a buffer
+static char *read_all(int fd, size_t *len) {
+  size_t capacity = 65536;
+  char *data = malloc(capacity);
+  *len = 0;
+  while (data) {
+    ssize_t n = read(fd, data + *len, capacity - *len);
+    if (n == -1) {
+      free(data);
+      return NULL;
+    }
+    if (n == 0) {
+      return data;
+    }
+    *len += n;
+    if (*len == capacity) {
+      capacity *= 2;
+      char *new_data = realloc(data, capacity);
+      if (!new_data) {
+        free(data);
+      }
+      data = new_data;
+    }
+  }
+  return NULL;
+}
+
+// Add the pattern on one line (without the newline) to the builder
+// Return 0 if success or an empty line, -1 if error
+static int add_line(const char *line, size_t len, int line_count, stream_packer *packer,
+    mph_keys *literals, trie_patterns *patterns) {
+  const char *end = line + len;
+  const char *p = line;
+  char result = '\0';
+
+  // the pattern ends at the first whitespace, and one result char follows
+  while (p < end && *p != ' ' && *p != '\t') {
+    p++;
+  }
+  unsigned int pattern_len = p - line;
+  int is_space_found = p < end;
+  for (; p < end; p++) {
+    if (*p != ' ' && *p != '\t') {
+      if (result != '\0') {
+        fprintf(stderr, "syntax error at line %d (result must be single char): %.*s\n",
+            line_count, (int)len, line);
+        return -1;
+      }
+      result = *p;
+    }
+  }
+
+  if (pattern_len == 0 && result == '\0') { // empty line
+    return 0;
+  } else if (pattern_len == 0 || result == '\0' || !is_space_found) { // syntax error
+    fprintf(stderr, "syntax error at line %d: %.*s\n", line_count, (int)len, line);
+    fprintf(stderr, "correct format is \"<regex_pattern> <result>\"\n");
+    return -1;
+  }
+  if (literals) {
+    int8_t status = mph_keys_add(literals, line, pattern_len, result);
+    if (status != 0) {
+      return status == 1 ? 0 : -1;
+    }
+    // keep the order of the patterns of the trie for resolve_literals()
+    if (patterns->num_items == patterns->capacity) {
+      unsigned int capacity = patterns->capacity ? patterns->capacity * 2 : 256;
+      trie_pattern *items = realloc(patterns->items, capacity * sizeof(trie_pattern));
+      if (!items) {
+        fprintf(stderr, "malloc error for patterns\n");
+        return -1;
+      }
+      patterns->items = items;
+      patterns->capacity = capacity;
+    }
+    trie_pattern *item = &patterns->items[patterns->num_items++];
+    item->pat = line;
+    item->pat_len = pattern_len;
+    item->num_literals = literals->num_keys;
+  }
+  if (packer) {
+    return stream_pack_add(packer, line, pattern_len, result);
+  }
+  return tinreg_add_pattern(line, pattern_len, result);
+}
+
+// The last pattern matching a number wins, so a number in the hash table
+// gets the result of the trie if a pattern of the trie added after it
+// matches it. The patterns of the trie after each such number are added to
+// a builder of their own, from the last one, to find out.
+// Return 0 if success, -1 if error
+static int resolve_literals(mph_keys *literals, const trie_patterns *patterns) {
+  tinreg_builder_t *later = NULL;
+  unsigned int next = patterns->num_items;
+  unsigned int i;
+  int status = 0;
+  for (i = literals->num_keys; i-- > 0; ) {
+    uint8_t *result = literals->entries + i * TRIE_MPH_ENTRY_SIZE + TRIE_MPH_KEY_SIZE;
+    char str[TRIE_MPH_MAX_DIGITS + 1];
+    char trie_result;
+    mph_keys_number(literals, i, str);
+    trie_result = tinreg_lookup_result(str);
+    if (trie_result == '\0' || trie_result == (char)*result) {
+      continue;
+    }
+    if (!later && !(later = tinreg_builder_new())) {
+      fprintf(stderr, "malloc error for patterns\n");
+      return -1;
+    }
+    for (; next > 0 && patterns->items[next - 1].num_literals > i; next--) {
+      const trie_pattern *item = &patterns->items[next - 1];
+      if (tinreg_builder_add_pattern(later, item->pat, item->pat_len, 'x') != 0) {
+        status = -1;
+        break;
+      }
+    }
+    if (status != 0) {
+      break;
+    }
+    if (tinreg_builder_lookup_result(later, str) != '\0') {
+      *result = trie_result;
+    }
+  }
+  if (later) {
+    tinreg_builder_free(later);
+  }
+  return status;
+}
+
+int pattern_file_read(char *filename, stream_packer *packer, mph_keys *literals) {
+  struct stat st;
+  char *data;
+  size_t len;
+  int is_mapped = 0;
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    fprintf(stderr, "Error opening %s: %s\n", filename, strerror(errno));
+    return -1;
+  }
+  if (fstat(fd, &st) == -1) {
+    fprintf(stderr, "Error reading %s: %s\n", filename, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  if (S_ISREG(st.st_mode) && st.st_size > 0) {
+    len = st.st_size;
+    data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    is_mapped = data != MAP_FAILED;
+    if (is_mapped) {
+      madvise(data, len, MADV_SEQUENTIAL);
+    }
+  }
+  if (!is_mapped) {
+    data = read_all(fd, &len);
+  }
+  close(fd);
+  if (!data) {
+    fprintf(stderr, "Error reading %s: %s\n", filename, strerror(errno));
+    return -1;
+  }
+
+  const char *line = data;
+  const char *end = data + len;
+  int line_count = 0;
+  int status = 0;
+  trie_patterns patterns = { NULL, 0, 0 };
+  while (line < end) {
+    const char *newline = memchr(line, '\n', end - line);
+    const char *line_end = newline ? newline : end;
+    line_count++;
+    if (add_line(line, line_end - line, line_count, packer, literals, &patterns) != 0) {
+      status = -1;
+      break;
+    }
+    line = line_end + 1;
+  }
+  if (status == 0 && literals && resolve_literals(literals, &patterns) != 0) {
+    status = -1;
+  }
+  free(patterns.items);
+
+  if (is_mapped) {
+    munmap(data, len);
+  } else {
+    free(data);
+  }
+  return status;
+}
@@ -0,0 +1,17 @@
+// Read a pattern file into the trie builder
+
+#ifndef PATTERN_FILE_H
+#define PATTERN_FILE_H
+
+#include "tiny_regex.h"
+#include "stream_pack.h"
+#include "mph_table.h"
+
+// Add the patterns in the file to the trie, or to packer if it is not NULL
+// If literals is not NULL, plain numbers of up to TRIE_MPH_MAX_DIGITS digits
+// are added to it instead, with the result of the last pattern of the trie
+// added after them that matches them, if any
+// Return 0 if success, -1 if error
+int pattern_file_read(char *filename, stream_packer *packer, mph_keys *literals);
+
+#endif // PATTERN_FILE_H
@@ -0,0 +1,208 @@
+// Split a trie into an index of its first digits and one packed trie per
+// subtree below them
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "minimal_trie.h"
+#include "shard_trie.h"
+#include "shard_table.h"
+
+#define MAX_DESCENDANTS  0xfff
+
+static void store_u16(uint8_t *p, unsigned int value) {
+  p[0] = value >> 8;
+  p[1] = value & 0xff;
+}
+
+// Index of the node after nodes[i] and its subtree
+#define NEXT_SIBLING(nodes, i)  ((i) + (nodes)[i].num_descendants + 1)
+
+// Packed trie being written, with the stubs of the index
+typedef struct writer {
+  const tinreg_flat_node *nodes;
+  uint8_t *data;
+  unsigned int len;
+  unsigned int cut_depth;      // nodes at this depth are stubs, 0 for none
+  unsigned int *stubs;         // node index of each stub
+  unsigned int *stub_positions;
+  unsigned int num_stubs;
+} writer;
+
+// Write nodes[i] and its subtree as a packed trie, where the node at depth 0
+// is the root
+// Return the number of slots written
+static unsigned int write_node(writer *w, unsigned int i, unsigned int depth) {
+  const tinreg_flat_node *node = &w->nodes[i];
+  unsigned int pos = w->len;
+  unsigned int num_slots = 1;
+  uint8_t digit = depth == 0 ? 0 : node->digit;
+  unsigned int child;
+  w->len += BYTES_PER_NODE;
+  if (digit == TINREG_DIGIT_SET) {
+    uint8_t *mask = w->data + w->len;
+    mask[0] = node->digits >> 8;
+    mask[1] = node->digits & 0xff;
+    mask[2] = 0;
+    w->len += BYTES_PER_NODE;
+    num_slots++;
+  }
+  if (w->cut_depth > 0 && depth == w->cut_depth) {
+    if (node->num_descendants > 0) {
+      w->stubs[w->num_stubs] = i;
+      w->stub_positions[w->num_stubs] = pos;
+      w->num_stubs++;
+    }
+  } else {
+    for (child = i + 1; child < NEXT_SIBLING(w->nodes, i);
+        child = NEXT_SIBLING(w->nodes, child)) {
+      num_slots += write_node(w, child, depth + 1);
+    }
+  }
+  // the descendants may be too many, which is checked with the root
+  w->data[pos] = (digit << 4) | ((num_slots - 1) >> 8 & 0xf);
+  w->data[pos + 1] = (num_slots - 1) & 0xff;
+  w->data[pos + 2] = node->result;
+  return num_slots;
+}
+
+// Write the packed trie of nodes[i] and its subtree into newly allocated
+// memory, cut below cut_depth if it is not 0
+// Return the length, or -1 if error
+static int write_trie(writer *w, unsigned int i, const char *name) {
+  const tinreg_flat_node *nodes = w->nodes;
+  unsigned int num_slots = nodes[i].num_descendants + 1;
+  unsigned int j;
+  for (j = i; j < NEXT_SIBLING(nodes, i); j++) {
+    if (nodes[j].digit == TINREG_DIGIT_SET) {
+      num_slots++;
+    }
+  }
+  w->data = malloc(num_slots * BYTES_PER_NODE);
+  w->len = 0;
+  if (!w->data) {
+    fprintf(stderr, "malloc error for %s\n", name);
+    return -1;
+  }
+  num_slots = write_node(w, i, 0);
+  if (num_slots - 1 > MAX_DESCENDANTS) {
+    fprintf(stderr, "error: %s is too large (number of descendants: %u > %d)\n", name,
+        num_slots - 1, MAX_DESCENDANTS);
+    free(w->data);
+    w->data = NULL;
+    return -1;
+  }
+  return w->len;
+}
+
+int shard_table_build(const tinreg_flat_node *nodes, int num_nodes, unsigned int depth,
+    shard_table *table) {
+  writer w;
+  unsigned int n;
+  int len;
+  if (depth < 1 || depth > SHARD_TABLE_MAX_DEPTH) {
+    fprintf(stderr, "error: shard depth must be 1 to %d\n", SHARD_TABLE_MAX_DEPTH);
+    return -1;
+  }
+  memset(table, 0, sizeof(*table));
+  memset(&w, 0, sizeof(w));
+  w.nodes = nodes;
+  w.cut_depth = depth;
+  w.stubs = malloc(sizeof(unsigned int) * num_nodes);
+  w.stub_positions = malloc(sizeof(unsigned int) * num_nodes);
+  if (!w.stubs || !w.stub_positions) {
+    fprintf(stderr, "malloc error for shards\n");
+    goto error;
+  }
+  len = write_trie(&w, 0, "the index");
+  if (len < 0) {
+    goto error;
+  }
+
+  table->index_len = SHARD_TRIE_HEADER_SIZE + len + w.num_stubs * 2;
+  table->index = malloc(table->index_len);
+  table->shards = calloc(w.num_stubs + 1, sizeof(uint8_t *));
+  table->shard_lens = malloc(sizeof(unsigned int) * (w.num_stubs + 1));
+  if (!table->index || !table->shards || !table->shard_lens) {
+    fprintf(stderr, "malloc error for shards\n");
+    free(w.data);
+    goto error;
+  }
+  store_u16(table->index, len);
+  store_u16(table->index + 2, w.num_stubs);
+  memcpy(table->index + SHARD_TRIE_HEADER_SIZE, w.data, len);
+  for (n = 0; n < w.num_stubs; n++) {
+    store_u16(table->index + SHARD_TRIE_HEADER_SIZE + len + n * 2, w.stub_positions[n]);
+  }
+  free(w.data);
+
+  // each shard is a whole packed trie under the node of its stub
+  table->num_shards = w.num_stubs;
+  w.cut_depth = 0;
+  for (n = 0; n < table->num_shards; n++) {
+    char name[64];
+    snprintf(name, sizeof(name), "shard %u", n);
+    len = write_trie(&w, w.stubs[n], name);
+    if (len < 0) {
+      goto error;
+    }
+    table->shards[n] = w.data;
+    table->shard_lens[n] = len;
+  }
+  free(w.stubs);
+  free(w.stub_positions);
+  return 0;
+
+error:
+  free(w.stubs);
+  free(w.stub_positions);
+  shard_table_free(table);
+  return -1;
+}
+
+// Write data to the file dir/name
+// Return 0 if success, -1 if error
+static int write_file(const char *dir, const char *name, const uint8_t *data, unsigned int len) {
+  char path[4096];
+  FILE *fp;
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  fp = fopen(path, "wb");
+  if (!fp) {
+    fprintf(stderr, "Error opening %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  int failed = fwrite(data, 1, len, fp) != len;
+  if (fclose(fp) != 0 || failed) {
+    fprintf(stderr, "Error writing %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+int shard_table_write(const shard_table *table, const char *dir) {
+  unsigned int n;
+  for (n = 0; n < table->num_shards; n++) {
+    char name[64];
+    snprintf(name, sizeof(name), SHARD_TRIE_FILE_FORMAT, n);
+    if (write_file(dir, name, table->shards[n], table->shard_lens[n]) != 0) {
+      return -1;
+    }
+  }
+  // the index goes last, so that it never refers to a shard not written yet
+  return write_file(dir, SHARD_TRIE_INDEX_NAME, table->index, table->index_len);
+}
+
+void shard_table_free(shard_table *table) {
+  unsigned int n;
+  if (table->shards) {
+    for (n = 0; n < table->num_shards; n++) {
+      free(table->shards[n]);
+    }
+  }
+  free(table->index);
+  free(table->shards);
+  free(table->shard_lens);
+  memset(table, 0, sizeof(*table));
+}
@@ -0,0 +1,34 @@
+// Split a trie into an index of its first digits and one packed trie per
+// subtree below them, read by shard_trie.c
+
+#ifndef SHARD_TABLE_H
+#define SHARD_TABLE_H
+
+#include "tiny_regex.h"
+
+#define SHARD_TABLE_MAX_DEPTH  8
+
+// Index and shards in newly allocated memory
+typedef struct shard_table {
+  uint8_t *index;
+  unsigned int index_len;
+  uint8_t **shards;
+  unsigned int *shard_lens;
+  unsigned int num_shards;
+} shard_table;
+
+// Build the index of the first depth digits of the flattened trie, and a
+// shard for each node at that depth that has children. Only the index and
+// each shard must fit in the packed format, not the whole trie.
+// Return 0 if success, -1 if error
+int shard_table_build(const tinreg_flat_node *nodes, int num_nodes, unsigned int depth,
+    shard_table *table);
+
+// Write the index and the shards as files in dir, which must exist
+// Return 0 if success, -1 if error
+int shard_table_write(const shard_table *table, const char *dir);
+
+// Free the index and the shards
+void shard_table_free(shard_table *table);
+
+#endif // SHARD_TABLE_H
@@ -0,0 +1,189 @@
+// Library for looking up a result in a trie split into shard files by
+// its first digits
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shard_trie.h"
+
+static unsigned int load_u16(const uint8_t *p) {
+  return (p[0] << 8) | p[1];
+}
+
+// Map the file dir/name
+// Return the map, or NULL if error
+static void *map_file(const char *dir, const char *name, unsigned int *len) {
+  char path[4096];
+  struct stat st;
+  void *map;
+  int fd;
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    fprintf(stderr, "Error opening %s: %s\n", path, strerror(errno));
+    return NULL;
+  }
+  if (fstat(fd, &st) == -1) {
+    fprintf(stderr, "Error reading %s: %s\n", path, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+  if (st.st_size == 0) {
+    fprintf(stderr, "Error reading %s: empty file\n", path);
+    close(fd);
+    return NULL;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Error mapping %s: %s\n", path, strerror(errno));
+    return NULL;
+  }
+  *len = st.st_size;
+  return map;
+}
+
+int shard_trie_open(shard_trie_t *st, const char *dir, unsigned int max_resident) {
+  unsigned int i;
+  memset(st, 0, sizeof(*st));
+  st->index_map = map_file(dir, SHARD_TRIE_INDEX_NAME, &st->index_map_len);
+  if (!st->index_map) {
+    return -1;
+  }
+  const uint8_t *data = st->index_map;
+  st->top.data = data + SHARD_TRIE_HEADER_SIZE;
+  st->top.len = st->index_map_len >= SHARD_TRIE_HEADER_SIZE ? load_u16(data) : 0;
+  st->num_shards = st->index_map_len >= SHARD_TRIE_HEADER_SIZE ? load_u16(data + 2) : 0;
+  st->stubs = st->top.data + st->top.len;
+  if (st->index_map_len < SHARD_TRIE_HEADER_SIZE ||
+      st->stubs + st->num_shards * 2 > data + st->index_map_len) {
+    fprintf(stderr, "error: %s/%s is too short (%u bytes)\n", dir, SHARD_TRIE_INDEX_NAME,
+        st->index_map_len);
+    shard_trie_close(st);
+    return -1;
+  }
+  st->dir = strdup(dir);
+  st->shards = malloc(sizeof(trie_t) * (st->num_shards + 1));
+  st->last_used = malloc(sizeof(unsigned long) * (st->num_shards + 1));
+  if (!st->dir || !st->shards || !st->last_used) {
+    fprintf(stderr, "malloc error for shards\n");
+    shard_trie_close(st);
+    return -1;
+  }
+  for (i = 0; i < st->num_shards; i++) {
+    st->shards[i].data = NULL;
+    st->shards[i].len = 0;
+    st->last_used[i] = 0;
+  }
+  st->max_resident = max_resident;
+  return 0;
+}
+
+static void unmap_shard(shard_trie_t *st, unsigned int shard) {
+  munmap((void *)st->shards[shard].data, st->shards[shard].len);
+  st->shards[shard].data = NULL;
+  st->shards[shard].len = 0;
+  st->num_resident--;
+}
+
+void shard_trie_close(shard_trie_t *st) {
+  unsigned int i;
+  if (st->shards) {
+    for (i = 0; i < st->num_shards; i++) {
+      if (st->shards[i].data) {
+        unmap_shard(st, i);
+      }
+    }
+  }
+  if (st->index_map) {
+    munmap(st->index_map, st->index_map_len);
+  }
+  free(st->dir);
+  free(st->shards);
+  free(st->last_used);
+  memset(st, 0, sizeof(*st));
+}
+
+// Find the shard of the top node at pos
+// Return its number, or -1 if the node is not a stub
+static int find_shard(const shard_trie_t *st, unsigned int pos) {
+  unsigned int low = 0;
+  unsigned int high = st->num_shards;
+  while (low < high) {
+    unsigned int mid = (low + high) / 2;
+    unsigned int stub_pos = load_u16(st->stubs + mid * 2);
+    if (stub_pos == pos) {
+      return mid;
+    } else if (stub_pos < pos) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return -1;
+}
+
+// Get the shard, mapping it in place of the least recently used one if the
+// limit is reached. The new shard is mapped first, so a shard that cannot be
+// read does not evict another one.
+// Return the shard, or NULL if it cannot be read
+static const trie_t *load_shard(shard_trie_t *st, unsigned int shard) {
+  char name[64];
+  void *map;
+  unsigned int len;
+  unsigned int i;
+  st->last_used[shard] = ++st->clock;
+  if (st->shards[shard].data) {
+    return &st->shards[shard];
+  }
+  snprintf(name, sizeof(name), SHARD_TRIE_FILE_FORMAT, shard);
+  map = map_file(st->dir, name, &len);
+  if (!map) {
+    return NULL;
+  }
+  if (st->max_resident > 0 && st->num_resident >= st->max_resident) {
+    int oldest = -1;
+    for (i = 0; i < st->num_shards; i++) {
+      if (st->shards[i].data && (oldest < 0 || st->last_used[i] < st->last_used[oldest])) {
+        oldest = i;
+      }
+    }
+    unmap_shard(st, oldest);
+    st->evictions++;
+  }
+  st->shards[shard].data = map;
+  st->shards[shard].len = len;
+  st->num_resident++;
+  st->loads++;
+  return &st->shards[shard];
+}
+
+uint8_t shard_trie_lookup(shard_trie_t *st, const uint8_t *digits, unsigned int len) {
+  trie_cursor_t cursor;
+  int8_t is_in_top = 1;
+  unsigned int i;
+  trie_cursor_start(&cursor, &st->top);
+  for (i = 0; i < len; i++) {
+    if (trie_cursor_forward(&cursor, digits[i]) == 1) {
+      continue;
+    }
+    // the children of a stub are in its shard, whose root is the stub
+    int shard = is_in_top ? find_shard(st, cursor.pos) : -1;
+    const trie_t *trie = shard >= 0 ? load_shard(st, shard) : NULL;
+    if (!trie) {
+      return '\0';
+    }
+    trie_cursor_start(&cursor, trie);
+    if (trie_cursor_forward(&cursor, digits[i]) != 1) {
+      return '\0';
+    }
+    is_in_top = 0;
+  }
+  return trie_cursor_result(&cursor);
+}
@@ -0,0 +1,60 @@
+// Library for looking up a result in a trie split into shard files by
+// its first digits (build_trie --shards), opening each shard on the first
+// lookup that needs it
+//
+// The index file holds the top of the trie, down to the nodes at the shard
+// depth, as a packed trie. Each of those nodes that has children is a stub,
+// and its subtree is a packed trie of its own in a shard file, with the node
+// as the root. Shards are mapped when a lookup goes below their stub, and
+// the least recently used shard is unmapped when more than max_resident
+// would be mapped.
+//
+// Layout of the index file (integers are big-endian):
+//
+//   uint16  length of the top in bytes, uint16 number of shards
+//   top     packed trie
+//   uint16  offset of the node in the top for each shard, in order
+//
+// Shard n is the file SHARD_TRIE_FILE_FORMAT in the same directory. A shard
+// is a packed trie that can also be used on its own.
+
+#ifndef SHARD_TRIE_H
+#define SHARD_TRIE_H
+
+#include "minimal_trie.h"
+
+#define SHARD_TRIE_HEADER_SIZE  4
+#define SHARD_TRIE_INDEX_NAME  "index.trie"
+#define SHARD_TRIE_FILE_FORMAT  "shard-%u.trie"
+
+// Index and mapped shards of one reader
+typedef struct shard_trie_t {
+  trie_t top;
+  const uint8_t *stubs;
+  unsigned int num_shards;
+  char *dir;
+  void *index_map;
+  unsigned int index_map_len;
+  trie_t *shards;              // data is NULL if the shard is not mapped
+  unsigned long *last_used;    // clock when each shard was last used
+  unsigned int max_resident;
+  unsigned int num_resident;
+  unsigned long clock;
+  unsigned long loads;         // shards mapped
+  unsigned long evictions;     // shards unmapped to make room
+} shard_trie_t;
+
+// Open the index in dir, keeping up to max_resident shards mapped (0 for no
+// limit). No shard is mapped yet.
+// A shard_trie_t is used by one thread at a time; open one per thread
+// Return 0 if success, -1 if error
+int shard_trie_open(shard_trie_t *st, const char *dir, unsigned int max_resident);
+
+// Unmap the index and the shards
+void shard_trie_close(shard_trie_t *st);
+
+// Look up the whole number digits[0..len) from the root of the trie
+// Return its result, or '\0' if it has none or its shard cannot be read
+uint8_t shard_trie_lookup(shard_trie_t *st, const uint8_t *digits, unsigned int len);
+
+#endif // SHARD_TRIE_H
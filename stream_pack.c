@@ -0,0 +1,124 @@
+// Build the packed trie directly from sorted literal patterns
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stream_pack.h"
+
+#define BYTES_PER_NODE  3
+#define MAX_DESCENDANTS  0xfff
+
+int8_t stream_pack_init(stream_packer *sp) {
+  sp->data_capacity = 256 * BYTES_PER_NODE;
+  sp->stack_capacity = 16;
+  sp->data = malloc(sp->data_capacity);
+  sp->stack = malloc(sizeof(unsigned int) * sp->stack_capacity);
+  sp->path = malloc(sp->stack_capacity);
+  if (!sp->data || !sp->stack || !sp->path) {
+    fprintf(stderr, "stream_pack_init: malloc failed\n");
+    return -1;
+  }
+  // root node
+  sp->data[0] = sp->data[1] = sp->data[2] = 0;
+  sp->data_len = BYTES_PER_NODE;
+  sp->stack[0] = 0;
+  sp->path[0] = '\0';
+  sp->depth = 1;
+  return 0;
+}
+
+// Write the number of descendants of the innermost open node and pop it
+static int8_t close_node(stream_packer *sp) {
+  unsigned int offset = sp->stack[--sp->depth];
+  unsigned int num_descendants = (sp->data_len - offset) / BYTES_PER_NODE - 1;
+  if (num_descendants > MAX_DESCENDANTS) {
+    fprintf(stderr, "error: trie is too large (number of descendants: %u > %d)\n",
+        num_descendants, MAX_DESCENDANTS);
+    return -1;
+  }
+  sp->data[offset] |= (num_descendants >> 8) & 0xf;
+  sp->data[offset + 1] = num_descendants & 0xff;
+  return 0;
+}
+
+static int8_t open_node(stream_packer *sp, char c) {
+  if (sp->data_len + BYTES_PER_NODE > sp->data_capacity) {
+    sp->data_capacity *= 2;
+    sp->data = realloc(sp->data, sp->data_capacity);
+    if (!sp->data) {
+      fprintf(stderr, "open_node: realloc failed: capacity=%u\n", sp->data_capacity);
+      return -1;
+    }
+  }
+  if (sp->depth == sp->stack_capacity) {
+    sp->stack_capacity *= 2;
+    sp->stack = realloc(sp->stack, sizeof(unsigned int) * sp->stack_capacity);
+    sp->path = realloc(sp->path, sp->stack_capacity);
+    if (!sp->stack || !sp->path) {
+      fprintf(stderr, "open_node: realloc failed: depth=%u\n", sp->stack_capacity);
+      return -1;
+    }
+  }
+  sp->data[sp->data_len] = (c - '0') << 4;
+  sp->data[sp->data_len + 1] = 0;
+  sp->data[sp->data_len + 2] = '\0';
+  sp->stack[sp->depth] = sp->data_len;
+  sp->path[sp->depth] = c;
+  sp->depth++;
+  sp->data_len += BYTES_PER_NODE;
+  return 0;
+}
+
+int8_t stream_pack_add(stream_packer *sp, const char *pat, unsigned int pat_len, char result) {
+  unsigned int common = 0;
+  unsigned int i;
+  for (i = 0; i < pat_len; i++) {
+    if (pat[i] < '0' || pat[i] > '9') {
+      fprintf(stderr, "error: invalid char '%c' in pattern (only literal digits are "
+          "allowed in sorted input): %.*s\n", pat[i], pat_len, pat);
+      return -1;
+    }
+  }
+
+  // The open nodes are the path of the previous pattern
+  while (common < pat_len && common + 1 < sp->depth && sp->path[common + 1] == pat[common]) {
+    common++;
+  }
+  if (common + 1 < sp->depth && (common == pat_len || pat[common] < sp->path[common + 1])) {
+    fprintf(stderr, "error: input is not sorted at pattern %.*s\n", pat_len, pat);
+    return -1;
+  }
+  while (sp->depth > common + 1) {
+    if (close_node(sp) != 0) {
+      return -1;
+    }
+  }
+  for (i = common; i < pat_len; i++) {
+    if (open_node(sp, pat[i]) != 0) {
+      return -1;
+    }
+  }
+
+  uint8_t *result_byte = &sp->data[sp->stack[sp->depth - 1] + BYTES_PER_NODE - 1];
+  if (*result_byte != '\0') {
+    fprintf(stderr, "warning: overwriting result: %c with %c for pattern %.*s\n",
+        *result_byte, result, pat_len, pat);
+  }
+  *result_byte = result;
+  return 0;
+}
+
+int stream_pack_finish(stream_packer *sp, uint8_t **packed_data) {
+  int8_t status = 0;
+  while (sp->depth > 0 && status == 0) {
+    status = close_node(sp);
+  }
+  free(sp->stack);
+  free(sp->path);
+  if (status != 0) {
+    free(sp->data);
+    return -1;
+  }
+  *packed_data = sp->data;
+  return sp->data_len;
+}
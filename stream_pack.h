@@ -0,0 +1,34 @@
+// Build the packed trie directly from sorted literal patterns
+//
+// Each pattern is appended as a path of nodes in preorder, and the number
+// of descendants of a node is written back when its subtree is closed, so
+// only a stack as deep as the longest pattern is kept besides the output.
+
+#ifndef STREAM_PACK_H
+#define STREAM_PACK_H
+
+#include "tiny_regex.h"
+
+typedef struct stream_packer {
+  uint8_t *data;
+  unsigned int data_len;
+  unsigned int data_capacity;
+  unsigned int *stack;  // node offset of each open node (stack[0] is the root)
+  char *path;           // digits of the open nodes
+  unsigned int depth;
+  unsigned int stack_capacity;
+} stream_packer;
+
+// Initialize the packer
+// Return 0 if success, -1 if error
+int8_t stream_pack_init(stream_packer *sp);
+
+// Add the pattern, which must sort after the previous one and contain only digits
+// Return 0 if success, -1 if error
+int8_t stream_pack_add(stream_packer *sp, const char *pat, unsigned int pat_len, char result);
+
+// Close all nodes and hand over the packed data (free it with free())
+// Return the length of the packed data, or -1 if error
+int stream_pack_finish(stream_packer *sp, uint8_t **packed_data);
+
+#endif // STREAM_PACK_H
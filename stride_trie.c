@@ -0,0 +1,166 @@
+// Library for looking up many keys at once in a fixed-stride trie
+
+#include <string.h>
+
+#include "stride_trie.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STRIDE_AVX2  1
+#include <immintrin.h>
+#endif
+
+#define LANES  8
+
+static uint32_t load_u32(const uint8_t *p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint32_t value;
+  memcpy(&value, p, 4);
+  return value;
+#else
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+#endif
+}
+
+uint8_t stride_lookup(const trie_t *trie, const char *key, uint8_t len) {
+  const uint8_t *children = trie->data + STRIDE_HEADER_SIZE;
+  const uint8_t *results = children + load_u32(trie->data) * STRIDE_FANOUT * 4;
+  uint32_t node = 0;
+  uint8_t i;
+  for (i = 0; i < len; i++) {
+    uint8_t digit = key[i] - '0';
+    if (digit > 9) {
+      return '\0';
+    }
+    node = load_u32(children + (node * STRIDE_FANOUT + digit) * 4);
+    if (node == 0) {
+      return '\0';
+    }
+  }
+  return results[node];
+}
+
+void stride_lookup_batch_scalar(const trie_t *trie, const char *keys, unsigned int key_stride,
+    const uint8_t *lens, unsigned int num_keys, uint8_t *results) {
+  unsigned int i;
+  for (i = 0; i < num_keys; i++) {
+    results[i] = stride_lookup(trie, keys + i * key_stride, lens[i]);
+  }
+}
+
+#if STRIDE_AVX2
+
+// State of a group of LANES keys going down the trie together
+typedef struct lane_group {
+  __m256i node;
+  __m256i len;
+  __m256i missed;  // all ones in the lanes that left the trie
+  __m256i active;  // all ones in the lanes still going down
+  const char *keys;
+} lane_group;
+
+__attribute__((target("avx2")))
+static void group_start(lane_group *g, const char *keys, const uint8_t *lens) {
+  g->node = _mm256_setzero_si256();
+  g->len = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)lens));
+  g->missed = _mm256_setzero_si256();
+  g->active = _mm256_cmpgt_epi32(g->len, g->missed);
+  g->keys = keys;
+}
+
+// Take one step down for the active lanes of the group
+__attribute__((target("avx2")))
+static void group_step(lane_group *g, const int *children, __m256i key_offsets, __m256i depth) {
+  const __m256i nine = _mm256_set1_epi32(9);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i digit = _mm256_mask_i32gather_epi32(zero, (const int *)g->keys,
+      _mm256_add_epi32(key_offsets, depth), g->active, 1);
+  digit = _mm256_sub_epi32(_mm256_and_si256(digit, _mm256_set1_epi32(0xff)),
+      _mm256_set1_epi32('0'));
+  // a byte other than '0'-'9' is a miss
+  __m256i bad = _mm256_or_si256(_mm256_cmpgt_epi32(digit, nine),
+      _mm256_cmpgt_epi32(zero, digit));
+  __m256i active = _mm256_andnot_si256(bad, g->active);
+  // node * 10 + digit
+  __m256i index = _mm256_add_epi32(
+      _mm256_add_epi32(_mm256_slli_epi32(g->node, 3), _mm256_slli_epi32(g->node, 1)), digit);
+  __m256i child = _mm256_mask_i32gather_epi32(g->node, children, index, active, 4);
+  g->missed = _mm256_or_si256(g->missed, _mm256_and_si256(g->active,
+        _mm256_or_si256(bad, _mm256_cmpeq_epi32(child, zero))));
+  g->node = child;
+  depth = _mm256_add_epi32(depth, _mm256_set1_epi32(1));
+  g->active = _mm256_andnot_si256(g->missed, _mm256_cmpgt_epi32(g->len, depth));
+}
+
+__attribute__((target("avx2")))
+static void group_finish(lane_group *g, const uint8_t *node_results, uint8_t *results) {
+  uint32_t nodes[LANES];
+  unsigned int missed_lanes = _mm256_movemask_ps(_mm256_castsi256_ps(g->missed));
+  int lane;
+  _mm256_storeu_si256((__m256i *)nodes, _mm256_andnot_si256(g->missed, g->node));
+  for (lane = 0; lane < LANES; lane++) {
+    results[lane] = (missed_lanes >> lane) & 1 ? '\0' : node_results[nodes[lane]];
+  }
+}
+
+// Look up keys in two groups of LANES at a time, so that the gathers of one
+// group overlap those of the other; a lane stops at the end of its key or
+// when it leaves the trie, and the groups stop when every lane has
+__attribute__((target("avx2")))
+static void lookup_batch_avx2(const trie_t *trie, const char *keys, unsigned int key_stride,
+    const uint8_t *lens, unsigned int num_keys, uint8_t *results) {
+  const int *children = (const int *)(trie->data + STRIDE_HEADER_SIZE);
+  const uint8_t *node_results = trie->data + STRIDE_HEADER_SIZE +
+    load_u32(trie->data) * STRIDE_FANOUT * 4;
+  // offset of the key of each lane in a group
+  const __m256i key_offsets = _mm256_mullo_epi32(_mm256_set1_epi32(key_stride),
+      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  unsigned int base = 0;
+
+  // a digit is gathered as 4 bytes, which may run 3 bytes past the key; keep
+  // the groups that could run past the last key for the scalar loop
+  while (num_keys - base > LANES * 2 && (num_keys - base - LANES * 2) * key_stride >= 3) {
+    lane_group a;
+    lane_group b;
+    __m256i depth = _mm256_setzero_si256();
+    group_start(&a, keys + base * key_stride, lens + base);
+    group_start(&b, keys + (base + LANES) * key_stride, lens + base + LANES);
+    while (!_mm256_testz_si256(_mm256_or_si256(a.active, b.active),
+          _mm256_or_si256(a.active, b.active))) {
+      group_step(&a, children, key_offsets, depth);
+      group_step(&b, children, key_offsets, depth);
+      depth = _mm256_add_epi32(depth, _mm256_set1_epi32(1));
+    }
+    group_finish(&a, node_results, results + base);
+    group_finish(&b, node_results, results + base + LANES);
+    base += LANES * 2;
+  }
+
+  stride_lookup_batch_scalar(trie, keys + base * key_stride, key_stride, lens + base,
+      num_keys - base, results + base);
+}
+
+#endif // STRIDE_AVX2
+
+int stride_has_simd() {
+#if STRIDE_AVX2
+  static int has_avx2 = -1;
+  if (has_avx2 == -1) {
+    __builtin_cpu_init();
+    has_avx2 = __builtin_cpu_supports("avx2") != 0;
+  }
+  return has_avx2;
+#else
+  return 0;
+#endif
+}
+
+void stride_lookup_batch(const trie_t *trie, const char *keys, unsigned int key_stride,
+    const uint8_t *lens, unsigned int num_keys, uint8_t *results) {
+#if STRIDE_AVX2
+  if (stride_has_simd()) {
+    lookup_batch_avx2(trie, keys, key_stride, lens, num_keys, results);
+    return;
+  }
+#endif
+  stride_lookup_batch_scalar(trie, keys, key_stride, lens, num_keys, results);
+}
@@ -0,0 +1,42 @@
+// Library for looking up many keys at once in a fixed-stride trie
+//
+// Every node has a slot for each digit, so one step down the trie costs the
+// same for every key and a batch of keys can go down in lockstep. On x86
+// CPUs with AVX2 eight keys advance per gather instruction; other CPUs use
+// the scalar loop. The kernel is chosen at run time.
+//
+// Layout of the data (integers are little-endian):
+//
+//   uint32  number of nodes (n)
+//   uint32  children[n * 10]   index of the child of node i for digit d at
+//                              i * 10 + d, or 0 if none (the root is node 0)
+//   uint8   results[n]         result of each node, '\0' if none
+//
+// Nodes are numbered in preorder, like the packed format.
+
+#ifndef STRIDE_TRIE_H
+#define STRIDE_TRIE_H
+
+#include "minimal_trie.h"
+
+#define STRIDE_FANOUT  10
+#define STRIDE_HEADER_SIZE  4
+
+// Look up one key of ASCII digits
+// Return the result, or '\0' if the key has no result
+uint8_t stride_lookup(const trie_t *trie, const char *key, uint8_t len);
+
+// Look up num_keys keys and store the result of key i in results[i], using
+// the fastest kernel the CPU supports
+// Key i is the lens[i] ASCII digits at keys + i * key_stride (lens[i] <= key_stride)
+void stride_lookup_batch(const trie_t *trie, const char *keys, unsigned int key_stride,
+    const uint8_t *lens, unsigned int num_keys, uint8_t *results);
+
+// Same as stride_lookup_batch, always with the scalar kernel
+void stride_lookup_batch_scalar(const trie_t *trie, const char *keys, unsigned int key_stride,
+    const uint8_t *lens, unsigned int num_keys, uint8_t *results);
+
+// Return 1 if stride_lookup_batch uses the SIMD kernel, 0 if not
+int stride_has_simd();
+
+#endif // STRIDE_TRIE_H
@@ -0,0 +1,142 @@
+// Summaries of the subtrees of a packed trie
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "summary_table.h"
+
+// Result byte of the node at pos
+#define NODE_RESULT(data, pos)  ((data)[(pos) + BYTES_PER_NODE - 1])
+
+typedef struct summarizer {
+  const uint8_t *packed;
+  uint8_t results[TRIE_SUMMARY_MAX_RESULTS];
+  unsigned int num_results;
+  uint8_t *entries;  // TRIE_SUMMARY_ENTRY_SIZE bytes per slot
+} summarizer;
+
+// Get the bit of the result, adding it if new
+// Return the bit, or -1 if there are too many results
+static int result_bit(summarizer *s, uint8_t result) {
+  unsigned int i;
+  for (i = 0; i < s->num_results; i++) {
+    if (s->results[i] == result) {
+      return i;
+    }
+  }
+  if (s->num_results == TRIE_SUMMARY_MAX_RESULTS) {
+    fprintf(stderr, "error: more than %d results for --summaries\n", TRIE_SUMMARY_MAX_RESULTS);
+    return -1;
+  }
+  s->results[s->num_results] = result;
+  return s->num_results++;
+}
+
+// Summarize the node at pos and every node below it
+// Return 0 if success, -1 if error
+static int summarize_node(summarizer *s, unsigned int pos, trie_summary_t *summary) {
+  const uint8_t *data = s->packed;
+  unsigned int end = pos + (NODE_DESCENDANTS(data, pos) + 1) * BYTES_PER_NODE;
+  unsigned int reached = 0;  // digits taken by an earlier child
+  unsigned int child;
+  uint8_t *entry;
+
+  summary->results = 0;
+  summary->min_digits = TRIE_SUMMARY_NONE;
+  summary->max_digits = TRIE_SUMMARY_NONE;
+  summary->num_terminals = 0;
+  if (NODE_RESULT(data, pos) != '\0') {
+    int bit = result_bit(s, NODE_RESULT(data, pos));
+    if (bit < 0) {
+      return -1;
+    }
+    summary->results = 1u << bit;
+    summary->min_digits = 0;
+    summary->max_digits = 0;
+    summary->num_terminals = 1;
+  }
+
+  for (child = pos + NODE_SIZE(data, pos); child < end;
+      child += (NODE_DESCENDANTS(data, child) + 1) * BYTES_PER_NODE) {
+    unsigned int mask = NODE_CHAR(data, child) == NODE_CHAR_SET ?
+      NODE_SET_MASK(data, child) : 1u << NODE_CHAR(data, child);
+    trie_summary_t below;
+    if (summarize_node(s, child, &below) != 0) {
+      return -1;
+    }
+    // a child whose digits all go to earlier children cannot be reached
+    if ((mask & ~reached) == 0 || below.min_digits == TRIE_SUMMARY_NONE) {
+      reached |= mask;
+      continue;
+    }
+    reached |= mask;
+    summary->results |= below.results;
+    // longer numbers count as TRIE_SUMMARY_MAX_DIGITS digits
+    if (below.min_digits < TRIE_SUMMARY_MAX_DIGITS) {
+      below.min_digits++;
+    }
+    if (below.max_digits < TRIE_SUMMARY_MAX_DIGITS) {
+      below.max_digits++;
+    }
+    if (summary->min_digits == TRIE_SUMMARY_NONE || below.min_digits < summary->min_digits) {
+      summary->min_digits = below.min_digits;
+    }
+    if (summary->max_digits == TRIE_SUMMARY_NONE || below.max_digits > summary->max_digits) {
+      summary->max_digits = below.max_digits;
+    }
+    summary->num_terminals += below.num_terminals;
+  }
+
+  entry = s->entries + (pos / BYTES_PER_NODE) * TRIE_SUMMARY_ENTRY_SIZE;
+  entry[0] = summary->results >> 24;
+  entry[1] = (summary->results >> 16) & 0xff;
+  entry[2] = (summary->results >> 8) & 0xff;
+  entry[3] = summary->results & 0xff;
+  entry[4] = summary->min_digits;
+  entry[5] = summary->max_digits;
+  entry[6] = summary->num_terminals >> 8;
+  entry[7] = summary->num_terminals & 0xff;
+  return 0;
+}
+
+int summary_table_build(const uint8_t *packed, int packed_len, uint8_t **out) {
+  summarizer s;
+  trie_summary_t root;
+  unsigned int num_slots;
+  unsigned int len;
+  uint8_t *data;
+  if (packed_len < BYTES_PER_NODE ||
+      (unsigned int)packed_len != (NODE_DESCENDANTS(packed, 0) + 1u) * BYTES_PER_NODE) {
+    fprintf(stderr, "error: --summaries needs a plain packed trie\n");
+    return -1;
+  }
+  num_slots = packed_len / BYTES_PER_NODE;
+  memset(&s, 0, sizeof(s));
+  s.packed = packed;
+  // mask slots keep zeros
+  s.entries = calloc(num_slots, TRIE_SUMMARY_ENTRY_SIZE);
+  if (!s.entries) {
+    fprintf(stderr, "malloc error for the summaries\n");
+    return -1;
+  }
+  if (summarize_node(&s, 0, &root) != 0) {
+    free(s.entries);
+    return -1;
+  }
+
+  len = packed_len + 1 + s.num_results + num_slots * TRIE_SUMMARY_ENTRY_SIZE;
+  data = malloc(len);
+  if (!data) {
+    fprintf(stderr, "malloc error for the summaries\n");
+    free(s.entries);
+    return -1;
+  }
+  memcpy(data, packed, packed_len);
+  data[packed_len] = s.num_results;
+  memcpy(data + packed_len + 1, s.results, s.num_results);
+  memcpy(data + packed_len + 1 + s.num_results, s.entries, num_slots * TRIE_SUMMARY_ENTRY_SIZE);
+  free(s.entries);
+  *out = data;
+  return len;
+}
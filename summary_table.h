@@ -0,0 +1,20 @@
+// Append a summary of each subtree to a packed trie, read by
+// trie_cursor_summary() (build_trie --summaries)
+//
+// For each node, the summary holds the set of results reachable from it,
+// the fewest and most digits still needed to reach one, and the number of
+// nodes with a result below it. The summaries are computed bottom-up in
+// one pass over the packed trie, so a query is a single load at the index
+// of the node.
+
+#ifndef SUMMARY_TABLE_H
+#define SUMMARY_TABLE_H
+
+#include "minimal_trie.h"
+
+// Build the data from the packed trie, which must have at most
+// TRIE_SUMMARY_MAX_RESULTS distinct results
+// Return the length of *out, or -1 if error
+int summary_table_build(const uint8_t *packed, int packed_len, uint8_t **out);
+
+#endif // SUMMARY_TABLE_H
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "minimal_trie.h"
+#include "trie_telemetry.h"
+#include "trie_test_data.h"
+#include "trie_test_profiled.h"
+
+static const char *keys[] = { "1234", "20", "21", "22", "305", "345", "9", "911", "912", "4" };
+#define NUM_KEYS  (sizeof(keys) / sizeof(keys[0]))
+
+static uint8_t lookup(const trie_t *trie, const char *digits) {
+  trie_cursor_t cursor;
+  trie_cursor_start(&cursor, trie);
+  while (*digits) {
+    if (trie_cursor_forward(&cursor, *digits - '0') != 1) {
+      return '\0';
+    }
+    digits++;
+  }
+  return trie_cursor_result(&cursor);
+}
+
+static void *lookup_911(void *arg) {
+  trie_t *trie = arg;
+  int i;
+  for (i = 0; i < 100; i++) {
+    assert(lookup(trie, "911") == 'f');
+  }
+  return NULL;
+}
+
+int main() {
+  trie_t trie = { trie_data, sizeof(trie_data) };
+  trie_t profiled = { trie_profiled_data, sizeof(trie_profiled_data) };
+  trie_telemetry_t snapshot;
+  trie_telemetry_t merged;
+  pthread_t thread;
+  char line[256];
+  int is_node_found = 0;
+  unsigned int i;
+  FILE *fp;
+
+  // count the steps of every lookup
+  trie_telemetry_set_period(1);
+
+  // the profile puts 9 and 21 first without changing any result
+  assert(NODE_CHAR(trie_profiled_data, BYTES_PER_NODE) == 9);
+  assert(sizeof(trie_profiled_data) == sizeof(trie_data));
+  for (i = 0; i < NUM_KEYS; i++) {
+    assert(lookup(&profiled, keys[i]) == lookup(&trie, keys[i]));
+  }
+
+  trie_telemetry_reset();
+  trie_telemetry_snapshot(&snapshot);
+  assert(snapshot.lookups == 0);
+  assert(snapshot.nodes[0] == 0);
+
+  // counts of exited threads are kept
+  assert(pthread_create(&thread, NULL, lookup_911, &trie) == 0);
+  assert(pthread_join(thread, NULL) == 0);
+  for (i = 0; i < NUM_KEYS; i++) {
+    lookup(&trie, keys[i]);
+  }
+
+  trie_telemetry_snapshot(&snapshot);
+  assert(snapshot.lookups == 100 + NUM_KEYS);
+  assert(snapshot.sampled == snapshot.lookups);
+  assert(snapshot.results['f'] == 101);
+  assert(snapshot.results['a'] == 1);
+  assert(snapshot.results['d'] == 2);
+  assert(snapshot.results['e'] == 1);
+  assert(snapshot.hits[3] == 101 + 2);
+  assert(snapshot.hits[4] == 1);
+  assert(snapshot.hits[2] == 2);
+  assert(snapshot.steps[0] == 100 + NUM_KEYS);
+  // "22" and "912" fail at depth 1 and 2, "4" at depth 0
+  assert(snapshot.misses[0] == 1);
+  assert(snapshot.misses[1] == 1);
+  assert(snapshot.misses[2] == 1);
+  // 9 is the last of 1, 2, 3 and 9 at the root
+  assert(snapshot.skipped[0] >= 3 * 101);
+
+  memcpy(&merged, &snapshot, sizeof(merged));
+  trie_telemetry_merge(&merged, &snapshot);
+  assert(merged.lookups == 2 * snapshot.lookups);
+  assert(merged.results['f'] == 202);
+
+  fp = tmpfile();
+  assert(fp);
+  assert(trie_telemetry_export(&snapshot, &trie, fp) == 0);
+  rewind(fp);
+  assert(fgets(line, sizeof(line), fp) && strcmp(line, "trie-telemetry 1\n") == 0);
+  while (fgets(line, sizeof(line), fp)) {
+    if (strcmp(line, "node 911 101\n") == 0) {
+      is_node_found = 1;
+    }
+    // the set [0-4] is written as its lowest digit
+    if (strncmp(line, "node 30 ", 8) == 0) {
+      assert(strcmp(line, "node 30 2\n") == 0);
+    }
+  }
+  assert(is_node_found);
+  fclose(fp);
+
+  trie_telemetry_reset();
+  trie_telemetry_snapshot(&snapshot);
+  assert(snapshot.lookups == 0);
+  assert(snapshot.results['f'] == 0);
+
+  // one in four lookups is counted in detail
+  trie_telemetry_set_period(4);
+  for (i = 0; i < 8; i++) {
+    lookup(&trie, "911");
+  }
+  trie_telemetry_snapshot(&snapshot);
+  assert(snapshot.lookups == 8);
+  assert(snapshot.sampled == 2 || snapshot.sampled == 3);
+  assert(snapshot.results['f'] == snapshot.sampled);
+
+  return 0;
+}
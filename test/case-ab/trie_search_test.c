@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "minimal_trie.h"
+#include "tiny_regex.h"
+#include "trie_test_data.h"
+
+#define NUM_THREADS  4
+
+// the same patterns as patterns.txt
+static const char *patterns[] = { "110", "119", "0[1-9]x{8,9}", "0012x{6}" };
+static const char results[] = { 'a', 'b', 'c', 'd' };
+#define NUM_PATTERNS  (sizeof(patterns) / sizeof(patterns[0]))
+
+static uint8_t lookup(const trie_t *trie, const char *digits) {
+  trie_cursor_t cursor;
+  trie_cursor_start(&cursor, trie);
+  while (*digits) {
+    if (trie_cursor_forward(&cursor, *digits - '0') != 1) {
+      return '\0';
+    }
+    digits++;
+  }
+  return trie_cursor_result(&cursor);
+}
+
+// Build the patterns, and one more pattern only this thread adds
+static void *build(void *arg) {
+  long id = (long)arg;
+  char extra[8];
+  uint8_t buf[1024];
+  trie_t trie;
+  int len;
+  unsigned int i;
+  int round;
+  for (round = 0; round < 50; round++) {
+    tinreg_builder_t *builder = tinreg_builder_new();
+    assert(builder);
+    for (i = 0; i < NUM_PATTERNS; i++) {
+      assert(tinreg_builder_add_pattern(builder, patterns[i], strlen(patterns[i]), results[i]) == 0);
+    }
+    sprintf(extra, "7%ld", id);
+    assert(tinreg_builder_add_pattern(builder, extra, strlen(extra), 'e') == 0);
+    assert(tinreg_builder_lookup_result(builder, extra) == 'e');
+
+    len = tinreg_builder_pack(builder, buf, sizeof(buf));
+    assert(len == tinreg_builder_packed_size(builder));
+    tinreg_builder_free(builder);
+
+    trie.data = buf;
+    trie.len = len;
+    assert(lookup(&trie, "119") == 'b');
+    assert(lookup(&trie, "0312345678") == 'c');
+    assert(lookup(&trie, "0012123456") == 'd');
+    assert(lookup(&trie, extra) == 'e');
+    for (i = 0; i < NUM_THREADS; i++) {
+      sprintf(extra, "7%u", i);
+      assert(lookup(&trie, extra) == (i == id ? 'e' : '\0'));
+    }
+  }
+  return NULL;
+}
+
+int main() {
+  pthread_t threads[NUM_THREADS];
+  tinreg_builder_t *builder = tinreg_builder_new();
+  uint8_t buf[sizeof(trie_data)];
+  unsigned int i;
+  long id;
+
+  // the same bytes as build_trie
+  for (i = 0; i < NUM_PATTERNS; i++) {
+    assert(tinreg_builder_add_pattern(builder, patterns[i], strlen(patterns[i]), results[i]) == 0);
+  }
+  assert(tinreg_builder_packed_size(builder) == sizeof(trie_data));
+  assert(tinreg_builder_pack(builder, buf, sizeof(buf) - 1) == -1);
+  assert(tinreg_builder_pack(builder, buf, sizeof(buf)) == sizeof(trie_data));
+  assert(memcmp(buf, trie_data, sizeof(trie_data)) == 0);
+
+  trie_set_data(buf, sizeof(buf));
+  trie_start();
+  assert(trie_forward(1) == 1 && trie_forward(1) == 1 && trie_forward(0) == 1);
+  assert(trie_get_result() == 'a');
+
+  // errors leave the builder usable, and clear empties it
+  assert(tinreg_builder_add_pattern(builder, "1a", 2, 'z') == -1);
+  tinreg_builder_clear(builder);
+  assert(tinreg_builder_packed_size(builder) == BYTES_PER_NODE);
+  assert(tinreg_builder_add_pattern(builder, "5", 1, 'f') == 0);
+  assert(tinreg_builder_lookup_result(builder, "5") == 'f');
+  assert(tinreg_builder_lookup_result(builder, "110") == '\0');
+  tinreg_builder_free(builder);
+
+  // builders do not share state
+  for (id = 0; id < NUM_THREADS; id++) {
+    assert(pthread_create(&threads[id], NULL, build, (void *)id) == 0);
+  }
+  for (id = 0; id < NUM_THREADS; id++) {
+    assert(pthread_join(threads[id], NULL) == 0);
+  }
+
+  return 0;
+}
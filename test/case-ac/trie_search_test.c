@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_patch.h"
+#include "trie_test_data.h"
+#include "trie_test_patch.h"
+
+static uint8_t lookup(const uint8_t *data, unsigned int len, const char *digits) {
+  trie_t trie = { data, len };
+  trie_cursor_t cursor;
+  trie_cursor_start(&cursor, &trie);
+  while (*digits) {
+    if (trie_cursor_forward(&cursor, *digits - '0') != 1) {
+      return '\0';
+    }
+    digits++;
+  }
+  return trie_cursor_result(&cursor);
+}
+
+int main() {
+  static uint8_t out[sizeof(trie_new_data)];
+  static uint8_t old_copy[sizeof(trie_old_data)];
+  static uint8_t patch_copy[sizeof(trie_patch_data)];
+  unsigned int new_len = trie_patch_new_len(trie_patch_data, sizeof(trie_patch_data));
+  unsigned int i;
+
+  // the patch grows with the change, not with the trie
+  assert(sizeof(trie_patch_data) * 4 < sizeof(trie_new_data));
+
+  assert(new_len == sizeof(trie_new_data));
+  assert(trie_apply_patch(trie_old_data, sizeof(trie_old_data), trie_patch_data,
+        sizeof(trie_patch_data), out, sizeof(out)) == (int)sizeof(trie_new_data));
+  assert(memcmp(out, trie_new_data, sizeof(out)) == 0);
+
+  assert(lookup(out, new_len, "12941") == 'z');
+  assert(lookup(out, new_len, "6230131") == '\0');
+  assert(lookup(out, new_len, "55512") == 'y');
+  assert(lookup(out, new_len, "0312345678") == 'n');
+  assert(lookup(out, new_len, "9110") == 'f');
+  assert(lookup(out, new_len, "911") == 'e');
+  assert(lookup(trie_old_data, sizeof(trie_old_data), "9110") == '\0');
+
+  // the output buffer must hold the new trie
+  assert(trie_apply_patch(trie_old_data, sizeof(trie_old_data), trie_patch_data,
+        sizeof(trie_patch_data), out, sizeof(out) - 1) == TRIE_PATCH_ERROR_FORMAT);
+
+  // a patch only applies to its own old trie, down to every byte
+  assert(trie_apply_patch(trie_new_data, sizeof(trie_new_data), trie_patch_data,
+        sizeof(trie_patch_data), out, sizeof(out)) == TRIE_PATCH_ERROR_OLD);
+  for (i = 0; i < sizeof(old_copy); i += 97) {
+    memcpy(old_copy, trie_old_data, sizeof(old_copy));
+    old_copy[i] ^= 0x01;
+    assert(trie_apply_patch(old_copy, sizeof(old_copy), trie_patch_data,
+          sizeof(trie_patch_data), out, sizeof(out)) == TRIE_PATCH_ERROR_OLD);
+  }
+
+  // a damaged patch is detected
+  memcpy(patch_copy, trie_patch_data, sizeof(patch_copy));
+  patch_copy[16] ^= 0x10;  // checksum of the new trie
+  assert(trie_apply_patch(trie_old_data, sizeof(trie_old_data), patch_copy,
+        sizeof(patch_copy), out, sizeof(out)) == TRIE_PATCH_ERROR_NEW);
+  for (i = TRIE_PATCH_HEADER_SIZE; i < sizeof(patch_copy); i++) {
+    memcpy(patch_copy, trie_patch_data, sizeof(patch_copy));
+    patch_copy[i] ^= 0x04;
+    assert(trie_apply_patch(trie_old_data, sizeof(trie_old_data), patch_copy,
+          sizeof(patch_copy), out, sizeof(out)) < 0);
+  }
+  assert(trie_apply_patch(trie_old_data, sizeof(trie_old_data), trie_patch_data,
+        sizeof(trie_patch_data) - 1, out, sizeof(out)) < 0);
+  assert(trie_patch_new_len(trie_old_data, sizeof(trie_old_data)) == 0);
+
+  return 0;
+}
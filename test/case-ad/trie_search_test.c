@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "minimal_trie.h"
+#include "trie_cache.h"
+#include "trie_test_data.h"
+
+#define NUM_THREADS  4
+#define NUM_ROUNDS  1000
+
+static const char *numbers[] = {
+  "110", "112", "119", "11", "111", "0120123456", "012012345", "0312345678",
+  "03123456789", "07012345678", "06012345678", "1234567890123456", "123456789012345",
+  "", "9",
+};
+#define NUM_NUMBERS  (sizeof(numbers) / sizeof(numbers[0]))
+
+static trie_t trie = { trie_data, sizeof(trie_data) };
+
+static unsigned int to_digits(const char *number, uint8_t *digits) {
+  unsigned int len = 0;
+  for (; number[len]; len++) {
+    digits[len] = number[len] - '0';
+  }
+  return len;
+}
+
+static uint8_t cache_lookup(const trie_t *t, const char *number) {
+  uint8_t digits[32];
+  unsigned int len = to_digits(number, digits);
+  return trie_cache_lookup(t, digits, len);
+}
+
+static uint8_t lookup(const trie_t *t, const char *number) {
+  uint8_t digits[32];
+  unsigned int len = to_digits(number, digits);
+  return trie_lookup(t, digits, len);
+}
+
+static void *run_lookups(void *arg) {
+  unsigned int round;
+  unsigned int i;
+  for (round = 0; round < NUM_ROUNDS; round++) {
+    for (i = 0; i < NUM_NUMBERS; i++) {
+      if (cache_lookup(&trie, numbers[i]) != lookup(&trie, numbers[i])) {
+        return (void *)1;
+      }
+    }
+  }
+  return NULL;
+}
+
+int main() {
+  static uint8_t data_copy[sizeof(trie_data)];
+  trie_t copy = { data_copy, sizeof(data_copy) };
+  pthread_t threads[NUM_THREADS];
+  trie_cache_stats_t stats;
+  trie_cursor_t cursor;
+  unsigned int i;
+
+  assert(lookup(&trie, "110") == 'a');
+  assert(lookup(&trie, "0120123456") == 'd');
+  assert(lookup(&trie, "08012345678") == 'f');
+  assert(lookup(&trie, "11") == '\0');
+  assert(lookup(&trie, "1234567890123456") == 'g');
+
+  // the second pass is answered from the cache, except for the numbers which
+  // are empty or too long
+  for (i = 0; i < NUM_NUMBERS; i++) {
+    assert(cache_lookup(&trie, numbers[i]) == lookup(&trie, numbers[i]));
+  }
+  trie_cache_get_stats(&stats);
+  assert(stats.lookups == NUM_NUMBERS);
+  assert(stats.hits == 0);
+  assert(stats.bypassed == 2);
+  assert(stats.flushes == 1);
+  for (i = 0; i < NUM_NUMBERS; i++) {
+    assert(cache_lookup(&trie, numbers[i]) == lookup(&trie, numbers[i]));
+  }
+  trie_cache_get_stats(&stats);
+  assert(stats.lookups == NUM_NUMBERS * 2);
+  assert(stats.hits == NUM_NUMBERS - 2);
+  assert(stats.bypassed == 4);
+
+  // a single set of TRIE_CACHE_WAYS entries keeps replacing them
+  trie_cache_set_size(1);
+  trie_cache_reset_stats();
+  for (i = 0; i < NUM_NUMBERS * 3; i++) {
+    assert(cache_lookup(&trie, numbers[i % NUM_NUMBERS]) ==
+        lookup(&trie, numbers[i % NUM_NUMBERS]));
+  }
+  trie_cache_get_stats(&stats);
+  assert(stats.flushes == 1);
+  assert(stats.hits < NUM_NUMBERS * 2);
+  // numbers that are hit again stay in the set
+  for (i = 0; i < 100; i++) {
+    assert(cache_lookup(&trie, "110") == 'a');
+    assert(cache_lookup(&trie, numbers[3 + i % (NUM_NUMBERS - 3)]) ==
+        lookup(&trie, numbers[3 + i % (NUM_NUMBERS - 3)]));
+  }
+  trie_cache_reset_stats();
+  assert(cache_lookup(&trie, "110") == 'a');
+  trie_cache_get_stats(&stats);
+  assert(stats.hits == 1);
+  // sizes are rounded up to a power of two, up to the largest one
+  trie_cache_set_size(300);
+  assert(trie_cache_sets == 512);
+  trie_cache_set_size(0x80000001);
+  assert(trie_cache_sets == TRIE_CACHE_MAX_SETS);
+  trie_cache_set_size(0xffffffff);
+  assert(trie_cache_sets == TRIE_CACHE_MAX_SETS);
+  trie_cache_set_size(TRIE_CACHE_SETS);
+  assert(trie_cache_sets == TRIE_CACHE_SETS);
+
+  // other trie data empties the cache
+  memcpy(data_copy, trie_data, sizeof(trie_data));
+  trie_cache_reset_stats();
+  assert(cache_lookup(&copy, "110") == 'a');
+  assert(cache_lookup(&copy, "110") == 'a');
+  trie_cache_get_stats(&stats);
+  assert(stats.flushes == 1);
+  assert(stats.hits == 1);
+
+  // data changed at the same address is only seen after trie_data_changed()
+  trie_cursor_start(&cursor, &copy);
+  assert(trie_cursor_forward(&cursor, 1) == 1);
+  assert(trie_cursor_forward(&cursor, 1) == 1);
+  assert(trie_cursor_forward(&cursor, 0) == 1);
+  data_copy[cursor.pos + BYTES_PER_NODE - 1] = 'z';
+  assert(lookup(&copy, "110") == 'z');
+  assert(cache_lookup(&copy, "110") == 'a');
+  trie_data_changed();
+  assert(cache_lookup(&copy, "110") == 'z');
+  assert(cache_lookup(&copy, "110") == 'z');
+
+  // and so does trie_set_data()
+  trie_cache_reset_stats();
+  trie_set_data(trie_data, sizeof(trie_data));
+  assert(cache_lookup(&copy, "110") == 'z');
+  trie_cache_get_stats(&stats);
+  assert(stats.flushes == 1);
+  assert(stats.hits == 0);
+
+  // each thread has its own cache, and the counters of all threads add up
+  trie_cache_reset_stats();
+  for (i = 0; i < NUM_THREADS; i++) {
+    assert(pthread_create(&threads[i], NULL, run_lookups, NULL) == 0);
+  }
+  for (i = 0; i < NUM_THREADS; i++) {
+    void *status;
+    assert(pthread_join(threads[i], &status) == 0);
+    assert(status == NULL);
+  }
+  trie_cache_get_stats(&stats);
+  assert(stats.lookups == NUM_THREADS * NUM_ROUNDS * NUM_NUMBERS);
+  assert(stats.bypassed == NUM_THREADS * NUM_ROUNDS * 2);
+  assert(stats.flushes == NUM_THREADS);
+  assert(stats.hits == NUM_THREADS * (NUM_ROUNDS * (NUM_NUMBERS - 2) - (NUM_NUMBERS - 2)));
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+
+static trie_mph_t mph;
+
+static unsigned int to_digits(const char *number, uint8_t *digits) {
+  unsigned int len = 0;
+  for (; number[len]; len++) {
+    digits[len] = number[len] - '0';
+  }
+  return len;
+}
+
+static uint8_t lookup(const char *number) {
+  uint8_t digits[32];
+  unsigned int len = to_digits(number, digits);
+  return trie_mph_lookup(&mph, digits, len);
+}
+
+static uint8_t trie_only_lookup(const char *number) {
+  uint8_t digits[32];
+  unsigned int len = to_digits(number, digits);
+  return trie_lookup(&mph.trie, digits, len);
+}
+
+int main() {
+  uint8_t digits[32];
+  uint8_t key[TRIE_MPH_KEY_SIZE];
+  unsigned int i;
+
+  mph = trie_mph_open(trie_data, sizeof(trie_data));
+  // 110 is added twice
+  assert(mph.num_keys == 9);
+  assert(mph.num_buckets == 4);
+
+  // plain numbers are found in the hash table
+  assert(lookup("110") == 'i');
+  assert(lookup("112") == 'b');
+  assert(lookup("119") == 'c');
+  assert(lookup("0312345678") == 'g');
+  assert(lookup("0312345679") == 'h');
+  assert(lookup("08012345678") == 'k');
+  assert(trie_only_lookup("110") == '\0');
+  assert(trie_only_lookup("08012345678") == '\0');
+
+  // and the hash table is tried before the trie
+  assert(lookup("911") == 'f');
+  assert(lookup("912") == 'e');
+  assert(trie_only_lookup("911") == 'e');
+
+  // the last pattern wins, as without the hash table
+  assert(lookup("1234") == 'm');
+  assert(lookup("1235") == 'm');
+  assert(lookup("5678") == 'o');
+  assert(lookup("5679") == 'n');
+
+  // the other patterns and numbers too long for a key are in the trie
+  assert(lookup("0120123456") == 'd');
+  assert(lookup("1234567890123456") == 'j');
+  assert(trie_only_lookup("1234567890123456") == 'j');
+
+  // numbers in neither
+  assert(lookup("11") == '\0');
+  assert(lookup("111") == '\0');
+  assert(lookup("031234567") == '\0');
+  assert(lookup("03123456789") == '\0');
+  assert(lookup("") == '\0');
+  assert(lookup("12345678901234567") == '\0');
+
+  // every number is in its own slot
+  for (i = 0; i < mph.num_keys; i++) {
+    const uint8_t *entry = mph.entries + i * TRIE_MPH_ENTRY_SIZE;
+    uint32_t bucket = trie_mph_hash(entry, mph.seed) & (mph.num_buckets - 1);
+    uint32_t pilot = ((uint32_t)mph.pilots[bucket * 4] << 24) | (mph.pilots[bucket * 4 + 1] << 16) |
+      (mph.pilots[bucket * 4 + 2] << 8) | mph.pilots[bucket * 4 + 3];
+    assert(trie_mph_hash(entry, mph.seed + TRIE_MPH_PILOT_STEP * (pilot + 1)) %
+        mph.num_keys == i);
+  }
+
+  // the key holds the length and the digits
+  assert(trie_mph_key(digits, to_digits("0312345678", digits), key) == 1);
+  assert(memcmp(key, "\xa0\x31\x23\x45\x67\x80\x00\x00", TRIE_MPH_KEY_SIZE) == 0);
+  assert(trie_mph_key(digits, to_digits("1234567890123456", digits), key) == 0);
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "block_table.h"
+#include "trie_test_data.h"
+
+static block_trie_t bt;
+
+static uint8_t lookup(const char *number) {
+  uint8_t digits[32];
+  unsigned int len = 0;
+  for (; number[len]; len++) {
+    digits[len] = number[len] - '0';
+  }
+  return block_trie_lookup(&bt, digits, len);
+}
+
+int main() {
+  uint8_t block[256];
+  uint8_t compressed[512];
+  uint8_t check[256];
+  unsigned int compressed_len;
+  unsigned int i;
+
+  assert(block_trie_open(&bt, trie_data, sizeof(trie_data), 1) == 0);
+  assert(bt.num_blocks > 1);
+  assert(bt.max_block_len <= 64);
+
+  // numbers in the top and in the blocks
+  assert(lookup("911") == 'e');
+  assert(lookup("110") == 'f');
+  assert(lookup("119") == 'g');
+  assert(lookup("03299") == 'a');
+  assert(lookup("03512") == 'b');
+  assert(lookup("03645") == 'c');
+  assert(lookup("04400") == 'a');
+  assert(lookup("04599") == 'b');
+  assert(lookup("04609") == 'c');
+  assert(lookup("01201234") == 'd');
+
+  // numbers that stop or go wrong in a block
+  assert(lookup("") == '\0');
+  assert(lookup("0") == '\0');
+  assert(lookup("0329") == '\0');
+  assert(lookup("032999") == '\0');
+  assert(lookup("03699") == '\0');
+  assert(lookup("01301234") == '\0');
+  assert(lookup("112") == '\0');
+
+  // a cache of one block decompresses a block again after another one
+  assert(lookup("03299") == 'a');
+  bt.hits = 0;
+  bt.misses = 0;
+  assert(lookup("03512") == 'b');
+  assert(lookup("04400") == 'a');
+  assert(lookup("03299") == 'a');
+  assert(bt.hits == 1 && bt.misses == 2);
+  block_trie_close(&bt);
+
+  // a larger cache keeps both
+  assert(block_trie_open(&bt, trie_data, sizeof(trie_data), 4) == 0);
+  assert(lookup("04400") == 'a');
+  assert(lookup("03299") == 'a');
+  assert(lookup("04400") == 'a');
+  assert(lookup("03299") == 'a');
+  assert(bt.hits == 2 && bt.misses == 2);
+  block_trie_close(&bt);
+
+  // blocks come back as they were, with repeats and long runs
+  for (i = 0; i < sizeof(block); i++) {
+    block[i] = i < 100 ? i % 7 : (i < 200 ? 0x5a : i);
+  }
+  compressed_len = block_table_compress(block, sizeof(block), compressed);
+  assert(compressed_len < sizeof(block));
+  assert(block_trie_decompress(compressed, compressed_len, check, sizeof(check)) ==
+      sizeof(block));
+  assert(memcmp(check, block, sizeof(block)) == 0);
+  compressed_len = block_table_compress(block, 0, compressed);
+  assert(block_trie_decompress(compressed, compressed_len, check, sizeof(check)) == 0);
+
+  // damaged blocks are rejected
+  compressed_len = block_table_compress(block, sizeof(block), compressed);
+  assert(block_trie_decompress(compressed, compressed_len, check, sizeof(block) - 1) == -1);
+  assert(block_trie_decompress(compressed, compressed_len - 1, check, sizeof(check)) !=
+      sizeof(block));
+  compressed[0] = 0x0f;  // a match before any output
+  assert(block_trie_decompress(compressed, compressed_len, check, sizeof(check)) == -1);
+
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "shard_trie.h"
+
+static shard_trie_t st;
+
+static uint8_t lookup(const char *number) {
+  uint8_t digits[32];
+  unsigned int len = 0;
+  for (; number[len]; len++) {
+    digits[len] = number[len] - '0';
+  }
+  return shard_trie_lookup(&st, digits, len);
+}
+
+int main() {
+  trie_t shard;
+  trie_cursor_t cursor;
+
+  assert(shard_trie_open(&st, "shards", 2) == 0);
+  // 8 has no digits below it, so it stays in the index
+  assert(st.num_shards == 4);
+  assert(st.num_resident == 0);
+
+  // numbers that end in the index do not map a shard
+  assert(lookup("8") == 'h');
+  assert(lookup("1") == '\0');
+  assert(lookup("81") == '\0');
+  assert(lookup("") == '\0');
+  assert(st.loads == 0);
+
+  // the first lookup below a prefix maps its shard
+  assert(lookup("03299") == 'a');
+  assert(lookup("03512") == 'b');
+  assert(lookup("04400") == 'a');
+  assert(lookup("01201234") == 'd');
+  assert(lookup("0362") == '\0');
+  assert(st.loads == 1);
+  assert(lookup("911") == 'e');
+  assert(lookup("91") == '\0');
+  assert(st.loads == 2 && st.num_resident == 2);
+
+  // a third shard unmaps the least recently used one
+  assert(lookup("110") == 'f');
+  assert(lookup("119") == 'g');
+  assert(st.loads == 3 && st.evictions == 1 && st.num_resident == 2);
+  assert(lookup("911") == 'e');
+  assert(st.loads == 3);
+  assert(lookup("03299") == 'a');
+  assert(st.loads == 4 && st.evictions == 2);
+  assert(lookup("529") == 'c');
+  assert(lookup("559") == '\0');
+  assert(st.num_resident == 2);
+  shard_trie_close(&st);
+
+  // without a limit every shard stays mapped
+  assert(shard_trie_open(&st, "shards", 0) == 0);
+  assert(lookup("03299") == 'a');
+  assert(lookup("911") == 'e');
+  assert(lookup("110") == 'f');
+  assert(lookup("529") == 'c');
+  assert(lookup("03512") == 'b');
+  assert(st.loads == 4 && st.evictions == 0 && st.num_resident == 4);
+
+  // a shard is a packed trie of its own, rooted at its prefix
+  shard = st.shards[0];
+  trie_cursor_start(&cursor, &shard);
+  assert(trie_cursor_forward(&cursor, 3) == 1);
+  assert(trie_cursor_forward(&cursor, 5) == 1);
+  shard_trie_close(&st);
+
+  return 0;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "trie_merge.h"
+#include "trie_test_data.h"
+
+static trie_t merged;
+
+static uint8_t lookup(const char *number) {
+  uint8_t digits[32];
+  unsigned int len = 0;
+  for (; number[len]; len++) {
+    digits[len] = number[len] - '0';
+  }
+  return trie_lookup(&merged, digits, len);
+}
+
+static void merge(int op, int conflict) {
+  trie_t a = { trie_a, sizeof(trie_a) };
+  trie_t b = { trie_b, sizeof(trie_b) };
+  uint8_t *data;
+  int len = trie_merge(&a, &b, op, conflict, &data);
+  assert(len > 0);
+  free((uint8_t *)merged.data);
+  merged.data = data;
+  merged.len = len;
+}
+
+int main() {
+  trie_t a = { trie_a, sizeof(trie_a) };
+  trie_t b = { trie_b, sizeof(trie_b) };
+  uint8_t *data;
+
+  merge(TRIE_MERGE_UNION, TRIE_MERGE_LEFT);
+  assert(lookup("0321") == 'a');
+  assert(lookup("0341") == 'a');
+  assert(lookup("0351") == 'a');  // a in one, c in the other
+  assert(lookup("0361") == 'b');
+  assert(lookup("0371") == 'b');
+  assert(lookup("110") == 'c');
+  assert(lookup("119") == 'd');
+  assert(lookup("911") == 'e');
+  assert(lookup("0120") == 'g');
+  assert(lookup("0381") == '\0');
+  assert(lookup("03") == '\0');
+  assert(lookup("012") == '\0');
+
+  merge(TRIE_MERGE_UNION, TRIE_MERGE_RIGHT);
+  assert(lookup("0351") == 'c');
+  assert(lookup("119") == 'f');
+  assert(lookup("0321") == 'a');
+  assert(lookup("911") == 'e');
+
+  // numbers with the same result in both
+  merge(TRIE_MERGE_INTERSECT, TRIE_MERGE_LEFT);
+  assert(lookup("0341") == 'a');
+  assert(lookup("0361") == 'b');
+  assert(lookup("110") == 'c');
+  assert(lookup("0321") == '\0');
+  assert(lookup("0351") == '\0');
+  assert(lookup("0371") == '\0');
+  assert(lookup("119") == '\0');
+  assert(lookup("911") == '\0');
+  assert(lookup("0120") == '\0');
+
+  // numbers of a that b drops or changes
+  merge(TRIE_MERGE_DIFFERENCE, TRIE_MERGE_LEFT);
+  assert(lookup("0321") == 'a');
+  assert(lookup("0351") == 'a');
+  assert(lookup("119") == 'd');
+  assert(lookup("911") == 'e');
+  assert(lookup("0341") == '\0');
+  assert(lookup("0361") == '\0');
+  assert(lookup("110") == '\0');
+  assert(lookup("0120") == '\0');
+  assert(lookup("0371") == '\0');
+
+  // a trie with itself
+  assert(trie_merge(&a, &a, TRIE_MERGE_INTERSECT, TRIE_MERGE_LEFT, &data) == sizeof(trie_a));
+  free(data);
+  assert(trie_merge(&a, &a, TRIE_MERGE_DIFFERENCE, TRIE_MERGE_LEFT, &data) == BYTES_PER_NODE);
+  free(data);
+  assert(trie_merge(&b, &b, TRIE_MERGE_UNION, TRIE_MERGE_ERROR, &data) == sizeof(trie_b));
+  free(data);
+
+  free((uint8_t *)merged.data);
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "mutable_trie.h"
+#include "trie_test_data.h"
+
+#define NUM_READERS  3
+#define NUM_CHANGES  20000
+
+static mutable_trie_t trie;
+static int writer_done;
+
+static unsigned int to_digits(const char *number, uint8_t *digits) {
+  unsigned int len = 0;
+  for (; number[len]; len++) {
+    digits[len] = number[len] - '0';
+  }
+  return len;
+}
+
+static uint8_t lookup(const char *number) {
+  uint8_t digits[MUTABLE_TRIE_MAX_DIGITS];
+  return mutable_trie_lookup(&trie, digits, to_digits(number, digits));
+}
+
+static int insert(const char *number, uint8_t result) {
+  uint8_t digits[MUTABLE_TRIE_MAX_DIGITS];
+  return mutable_trie_insert(&trie, digits, to_digits(number, digits), result);
+}
+
+static int delete(const char *number) {
+  uint8_t digits[MUTABLE_TRIE_MAX_DIGITS];
+  return mutable_trie_delete(&trie, digits, to_digits(number, digits));
+}
+
+// Number i of the ones that come and go during the concurrent test
+static void churn_number(unsigned int i, char *number) {
+  snprintf(number, 16, "0120%03u%u", i % 1000, i % 7);
+}
+
+static void *read_numbers(void *arg) {
+  unsigned int i = 0;
+  char number[16];
+  while (!__atomic_load_n(&writer_done, __ATOMIC_ACQUIRE)) {
+    // numbers that never change are always found
+    assert(lookup("110") == 'a');
+    assert(lookup("0312345678") == 'c');
+    // the others have their result or none
+    churn_number(i, number);
+    uint8_t result = lookup(number);
+    assert(result == '\0' || result == 'd' + i % 7 % 3);
+    i++;
+  }
+  return NULL;
+}
+
+int main() {
+  pthread_t readers[NUM_READERS];
+  char number[16];
+  uint8_t *data;
+  int len;
+  unsigned int i;
+
+  assert(mutable_trie_init(&trie) == 0);
+  assert(lookup("110") == '\0');
+  assert(lookup("") == '\0');
+
+  assert(insert("110", 'x') == 0);
+  assert(insert("110", 'a') == 0);
+  assert(insert("119", 'b') == 0);
+  assert(insert("0312345678", 'c') == 0);
+  assert(lookup("110") == 'a');
+  assert(lookup("119") == 'b');
+  assert(lookup("0312345678") == 'c');
+  assert(lookup("11") == '\0');
+  assert(lookup("1101") == '\0');
+
+  // the packed trie is the one build_trie makes from the same numbers
+  len = mutable_trie_pack(&trie, &data);
+  assert(len == sizeof(trie_data));
+  assert(memcmp(data, trie_data, len) == 0);
+  free(data);
+
+  // deleting a number unlinks the nodes that only lead to it
+  unsigned long num_nodes = trie.num_nodes;
+  assert(insert("11905", 'e') == 0);
+  assert(trie.num_nodes == num_nodes + 2);
+  assert(delete("11905") == 1);
+  assert(delete("11905") == 0);
+  assert(delete("1190") == 0);
+  assert(trie.num_nodes == num_nodes);
+  assert(trie.num_retired == 0);
+  assert(lookup("119") == 'b');
+  assert(delete("11") == 0);
+
+  // nodes are kept while a reader may be in them
+  mutable_cursor_t cursor;
+  assert(insert("11905", 'e') == 0);
+  assert(mutable_trie_read_begin() == 0);
+  mutable_cursor_start(&cursor, &trie);
+  assert(mutable_cursor_forward(&cursor, 1) == 1);
+  assert(mutable_cursor_forward(&cursor, 1) == 1);
+  assert(mutable_cursor_forward(&cursor, 9) == 1);
+  assert(mutable_cursor_forward(&cursor, 0) == 1);
+  assert(delete("11905") == 1);
+  assert(trie.num_retired == 2);
+  assert(mutable_cursor_forward(&cursor, 5) == 0);
+  assert(mutable_cursor_result(&cursor) == '\0');
+  mutable_trie_read_end();
+  assert(mutable_trie_reclaim(&trie) == 2);
+  assert(trie.num_retired == 0);
+
+  // readers run while the writer changes other numbers
+  for (i = 0; i < NUM_READERS; i++) {
+    assert(pthread_create(&readers[i], NULL, read_numbers, NULL) == 0);
+  }
+  for (i = 0; i < NUM_CHANGES; i++) {
+    churn_number(i, number);
+    if (i % 3 == 2) {
+      delete(number);
+    } else {
+      assert(insert(number, 'd' + i % 7 % 3) == 0);
+    }
+  }
+  __atomic_store_n(&writer_done, 1, __ATOMIC_RELEASE);
+  for (i = 0; i < NUM_READERS; i++) {
+    pthread_join(readers[i], NULL);
+  }
+  mutable_trie_reclaim(&trie);
+  assert(trie.num_retired == 0);
+  assert(lookup("110") == 'a');
+
+  mutable_trie_free(&trie);
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+
+static trie_t trie = { trie_data, sizeof(trie_data) };
+static trie_summary_t summary;
+
+// Summarize the node reached by the number
+static void summarize(const char *number) {
+  trie_cursor_t cursor;
+  unsigned int i;
+  trie_cursor_start(&cursor, &trie);
+  for (i = 0; number[i]; i++) {
+    assert(trie_cursor_forward(&cursor, number[i] - '0') == 1);
+  }
+  assert(trie_cursor_summary(&cursor, &summary) == 1);
+}
+
+// Whether the results of the summary are exactly the given ones
+static int has_results(const char *results) {
+  uint32_t set = 0;
+  unsigned int n;
+  for (n = 0; trie_summary_result(&trie, n) != '\0'; n++) {
+    if (strchr(results, trie_summary_result(&trie, n))) {
+      set |= 1u << n;
+    }
+  }
+  return n == 5 && summary.results == set;
+}
+
+int main() {
+  uint8_t digits[] = { 0, 3, 2, 2, 1, 2, 3, 4, 5, 6 };
+  trie_t plain = { trie_data, (NODE_DESCENDANTS(trie_data, 0) + 1) * BYTES_PER_NODE };
+  trie_cursor_t cursor;
+
+  // lookups are the same as without summaries
+  assert(trie_lookup(&trie, digits, 4) == 'e');
+  assert(trie_lookup(&trie, digits, 10) == 'd');
+  assert(trie_lookup(&trie, digits, 3) == '\0');
+
+  summarize("");
+  assert(has_results("abcde"));
+  assert(summary.min_digits == 3);
+  assert(summary.max_digits == 11);
+
+  summarize("1");
+  assert(has_results("ab"));
+  assert(summary.min_digits == 2);
+  assert(summary.max_digits == 2);
+  assert(summary.num_terminals == 2);
+
+  summarize("110");
+  assert(has_results("a"));
+  assert(summary.min_digits == 0);
+  assert(summary.max_digits == 0);
+  assert(summary.num_terminals == 1);
+
+  summarize("0");
+  assert(has_results("cde"));
+  assert(summary.min_digits == 3);
+  assert(summary.max_digits == 10);
+
+  summarize("012");
+  assert(has_results("c"));
+  assert(summary.min_digits == 7);
+  assert(summary.max_digits == 8);
+
+  summarize("032");
+  assert(has_results("de"));
+  assert(summary.min_digits == 1);
+  assert(summary.max_digits == 7);
+
+  summarize("0322");
+  assert(has_results("de"));
+  assert(summary.min_digits == 0);
+  assert(summary.max_digits == 6);
+
+  summarize("039");
+  assert(has_results("d"));
+  assert(summary.min_digits == 7);
+  assert(summary.max_digits == 7);
+  assert(summary.num_terminals == 1);
+
+  summarize("0399999999");
+  assert(has_results("d"));
+  assert(summary.min_digits == 0);
+
+  // a trie without summaries
+  trie_cursor_start(&cursor, &plain);
+  assert(trie_cursor_summary(&cursor, &summary) == 0);
+  assert(trie_summary_result(&plain, 0) == '\0');
+  assert(trie_summary_result(&trie, 5) == '\0');
+  return 0;
+}
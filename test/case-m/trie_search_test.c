@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "louds_trie.h"
+#include "trie_test_data.h"
+
+int main() {
+  int i;
+  louds_set_data(trie_data, sizeof(trie_data));
+
+  // every 3-digit path
+  for (i = 0; i < 1000; i++) {
+    louds_start();
+    assert(louds_forward(i / 100) == 1);
+    assert(louds_forward(i / 10 % 10) == 1);
+    assert(louds_forward(i % 10) == 1);
+    if (i == 558 || i == 568) {
+      assert(louds_get_result() == 'b');
+    } else if (i == 901 || i == 902) {
+      assert(louds_get_result() == 'c');
+    } else {
+      assert(louds_get_result() == 'a');
+    }
+  }
+
+  louds_start();
+  assert(louds_get_result() == '\0');
+  assert(louds_forward(5) == 1);
+  assert(louds_forward(5) == 1);
+  assert(louds_get_result() == '\0');
+  assert(louds_forward(7) == 1);
+  assert(louds_get_result() == 'a');
+  assert(louds_forward(8) == 1);
+  assert(louds_get_result() == 'b');
+  assert(louds_forward(0) == 0);
+
+  louds_start();
+  assert(louds_forward(9) == 1);
+  assert(louds_forward(0) == 1);
+  assert(louds_get_result() == 'c');
+  assert(louds_forward(1) == 1);
+  assert(louds_forward(1) == 0);
+
+  louds_start();
+  assert(louds_forward(1) == 1);
+  assert(louds_forward(2) == 1);
+  assert(louds_forward(3) == 1);
+  assert(louds_forward(4) == 0);
+
+  return 0;
+}
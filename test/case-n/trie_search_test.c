@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+
+static uint8_t lookup(const char *digits) {
+  trie_start();
+  while (*digits) {
+    if (trie_forward(*digits - '0') != 1) {
+      return '\0';
+    }
+    digits++;
+  }
+  return trie_get_result();
+}
+
+int main() {
+  trie_set_data(trie_data, sizeof(trie_data));
+
+  assert(lookup("128") == 'f');
+  assert(lookup("138") == 'f');
+  assert(lookup("1458") == 'f');
+  assert(lookup("1478") == 'f');
+  assert(lookup("148") == '\0');
+  assert(lookup("14") == '\0');
+
+  assert(lookup("5551246") == '\0');
+  assert(lookup("55512467") == 'x');
+  assert(lookup("55513567") == 'x');
+  assert(lookup("55513667") == '\0');
+
+  assert(lookup("55592") == '\0');
+  assert(lookup("555902") == 'y');
+  assert(lookup("555912") == 'y');
+  assert(lookup("5559012") == 'y');
+  assert(lookup("5559112") == 'y');
+  assert(lookup("555911") == '\0');
+
+  assert(lookup("90") == 'z');
+  assert(lookup("9") == '\0');
+  assert(lookup("") == '\0');
+
+  return 0;
+}
@@ -0,0 +1,42 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+
+static uint8_t lookup(const char *digits) {
+  trie_start();
+  while (*digits) {
+    if (trie_forward(*digits - '0') != 1) {
+      return '\0';
+    }
+    digits++;
+  }
+  return trie_get_result();
+}
+
+int main() {
+  trie_set_data(trie_data, sizeof(trie_data));
+
+  assert(lookup("110") == 'e');
+  assert(lookup("112") == 'e');
+  assert(lookup("118") == 'e');
+  assert(lookup("119") == 'e');
+  assert(lookup("1190") == 'f');
+  assert(lookup("120") == 'g');
+  assert(lookup("111") == '\0');
+  assert(lookup("11") == '\0');
+
+  assert(lookup("81312345678") == 't');
+  assert(lookup("813123456789") == 'u');
+  assert(lookup("8131299") == 'v');
+  assert(lookup("8131234567") == '\0');
+  assert(lookup("8131298") == '\0');
+
+  assert(lookup("90") == 'w');
+  assert(lookup("9012") == 'x');
+  assert(lookup("901") == '\0');
+  assert(lookup("9") == '\0');
+
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+
+static uint8_t lookup(const char *digits) {
+  trie_start();
+  while (*digits) {
+    if (trie_forward(*digits - '0') != 1) {
+      return '\0';
+    }
+    digits++;
+  }
+  return trie_get_result();
+}
+
+int main() {
+  trie_t table;
+
+  assert(trie_table_find(trie_data, "patterns") == 0);
+  assert(trie_table_find(trie_data, "subtree") == 1);
+  assert(trie_table_find(trie_data, "copy") == 2);
+  assert(trie_table_find(trie_data, "other") == 3);
+  assert(trie_table_find(trie_data, "othe") == -1);
+  assert(trie_table_find(trie_data, "others") == -1);
+
+  table = trie_table_open(trie_data, 0);
+  trie_set_data(table.data, table.len);
+  assert(lookup("12") == 'a');
+  assert(lookup("34") == 'b');
+  assert(lookup("35") == 'b');
+  assert(lookup("4") == '\0');
+  assert(lookup("9") == '\0');
+
+  // stored as the subtree 3 of the table 0
+  table = trie_table_open(trie_data, 1);
+  trie_set_data(table.data, table.len);
+  assert(lookup("4") == 'b');
+  assert(lookup("5") == 'b');
+  assert(lookup("34") == '\0');
+  assert(lookup("") == '\0');
+
+  // identical to the table 0
+  table = trie_table_open(trie_data, 2);
+  assert(table.data == trie_table_open(trie_data, 0).data);
+  trie_set_data(table.data, table.len);
+  assert(lookup("12") == 'a');
+  assert(lookup("35") == 'b');
+
+  table = trie_table_open(trie_data, 3);
+  trie_set_data(table.data, table.len);
+  assert(lookup("9") == 'z');
+  assert(lookup("12") == '\0');
+
+  assert(trie_table_open(trie_data, 4).data == NULL);
+
+  return 0;
+}
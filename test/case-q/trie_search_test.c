@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_iter.h"
+#include "trie_test_data.h"
+
+// Check that the next path is expected_path with expected_result
+static void expect_next(trie_iter_t *it, const char *expected_path, char expected_result) {
+  char path[TRIE_ITER_MAX_DEPTH + 1];
+  uint8_t i;
+  assert(trie_iter_next(it) == 1);
+  for (i = 0; i < it->len; i++) {
+    path[i] = '0' + it->digits[i];
+  }
+  path[i] = '\0';
+  assert(strcmp(path, expected_path) == 0);
+  assert(it->result == expected_result);
+}
+
+int main() {
+  trie_t trie = { trie_data, sizeof(trie_data) };
+  trie_iter_t it;
+  uint8_t prefix[] = { 1, 3 };
+  unsigned int token;
+
+  // whole trie
+  assert(trie_iter_init(&it, &trie, prefix, 0) == 1);
+  expect_next(&it, "12", 'a');
+  expect_next(&it, "13", 'b');
+  expect_next(&it, "135", 'b');
+  expect_next(&it, "14", 'b');
+  expect_next(&it, "145", 'b');
+  expect_next(&it, "2", 'c');
+  assert(trie_iter_next(&it) == 0);
+  assert(trie_iter_next(&it) == 0);
+
+  // prefix 1, in pages of 2 paths
+  assert(trie_iter_init(&it, &trie, prefix, 1) == 1);
+  expect_next(&it, "12", 'a');
+  expect_next(&it, "13", 'b');
+  token = trie_iter_token(&it);
+  memset(&it, 0, sizeof(it));
+  assert(trie_iter_resume(&it, &trie, prefix, 1, token) == 1);
+  expect_next(&it, "135", 'b');
+  expect_next(&it, "14", 'b');
+  token = trie_iter_token(&it);
+  assert(trie_iter_resume(&it, &trie, prefix, 1, token) == 1);
+  expect_next(&it, "145", 'b');
+  assert(trie_iter_next(&it) == 0);
+  token = trie_iter_token(&it);
+  assert(trie_iter_resume(&it, &trie, prefix, 1, token) == 1);
+  assert(trie_iter_next(&it) == 0);
+
+  // prefix 13 includes the prefix itself
+  assert(trie_iter_init(&it, &trie, prefix, 2) == 1);
+  expect_next(&it, "13", 'b');
+  expect_next(&it, "135", 'b');
+  assert(trie_iter_next(&it) == 0);
+
+  // invalid prefix and token
+  prefix[1] = 5;
+  assert(trie_iter_init(&it, &trie, prefix, 2) == 0);
+  assert(trie_iter_resume(&it, &trie, prefix, 1, 1) == 0);
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_fuzzy.h"
+#include "trie_test_data.h"
+
+typedef struct match {
+  char path[TRIE_FUZZY_MAX_LEN + 1];
+  uint8_t result;
+  uint8_t distance;
+} match;
+
+static match matches[16];
+static int num_matches;
+
+static int collect(const uint8_t *path, uint8_t path_len, uint8_t result,
+    uint8_t distance, void *user_data) {
+  uint8_t i;
+  for (i = 0; i < path_len; i++) {
+    matches[num_matches].path[i] = '0' + path[i];
+  }
+  matches[num_matches].path[i] = '\0';
+  matches[num_matches].result = result;
+  matches[num_matches].distance = distance;
+  num_matches++;
+  return 0;
+}
+
+static int stop_at_first(const uint8_t *path, uint8_t path_len, uint8_t result,
+    uint8_t distance, void *user_data) {
+  return 1;
+}
+
+static int fuzzy(const char *digits, uint8_t max_edits) {
+  uint8_t buf[TRIE_FUZZY_MAX_LEN + 1];
+  uint8_t len = strlen(digits);
+  uint8_t i;
+  trie_t trie = { trie_data, sizeof(trie_data) };
+  for (i = 0; i < len; i++) {
+    buf[i] = digits[i] - '0';
+  }
+  num_matches = 0;
+  return trie_lookup_fuzzy(&trie, buf, len, max_edits, collect, NULL);
+}
+
+// Check that path is among the matches with result and distance
+static void expect_match(const char *path, uint8_t result, uint8_t distance) {
+  int i;
+  for (i = 0; i < num_matches; i++) {
+    if (strcmp(matches[i].path, path) == 0) {
+      assert(matches[i].result == result);
+      assert(matches[i].distance == distance);
+      return;
+    }
+  }
+  assert(0);
+}
+
+int main() {
+  trie_t trie = { trie_data, sizeof(trie_data) };
+  uint8_t digits[TRIE_FUZZY_MAX_LEN + 1] = { 0 };
+
+  // exact
+  assert(fuzzy("5551234", 0) == 1);
+  expect_match("5551234", 'a', 0);
+  assert(fuzzy("5551234", 1) == 1);
+
+  // substitution, insertion, deletion
+  assert(fuzzy("5551235", 1) == 1);
+  expect_match("5551234", 'a', 1);
+  assert(fuzzy("55512345", 1) == 1);
+  expect_match("5551234", 'a', 1);
+  assert(fuzzy("555123", 1) == 1);
+  expect_match("5551234", 'a', 1);
+
+  // transposition costs 2 edits
+  assert(fuzzy("5551243", 1) == 0);
+  assert(fuzzy("5551243", 2) == 1);
+  expect_match("5551234", 'a', 2);
+
+  // several matches, including the root and paths shorter than the digits
+  assert(fuzzy("91", 1) == 2);
+  expect_match("911", 'e', 1);
+  expect_match("1", 'z', 1);
+  assert(fuzzy("1", 1) == 3);
+  expect_match("", 'z', 1);
+  expect_match("1", 'z', 0);
+  expect_match("2", 'z', 1);
+
+  assert(fuzzy("5550000", 2) == 0);
+  assert(fuzzy("5550000", 4) == 2);
+  expect_match("5551234", 'a', 4);
+  expect_match("5559876", 'b', 4);
+
+  // stop at the first match, too long digits
+  assert(trie_lookup_fuzzy(&trie, digits, 1, 1, stop_at_first, NULL) == 1);
+  assert(trie_lookup_fuzzy(&trie, digits, TRIE_FUZZY_MAX_LEN + 1, 1, collect, NULL) == -1);
+
+  return 0;
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+static void copy_file(const char *from, const char *to) {
+  char buf[4096];
+  size_t n;
+  FILE *in = fopen(from, "rb");
+  FILE *out = fopen("trie_test_tmp.bin", "wb");
+  assert(in && out);
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    fwrite(buf, 1, n, out);
+  }
+  fclose(in);
+  fclose(out);
+  // replace the file atomically
+  assert(rename("trie_test_tmp.bin", to) == 0);
+}
+
+static int connect_server(const char *path) {
+  struct sockaddr_un addr;
+  int i;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  for (i = 0; i < 100; i++) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+      return fd;
+    }
+    close(fd);
+    usleep(10000);
+  }
+  return -1;
+}
+
+// Send the requests in one write, and read one response byte per request
+static void query(int fd, const char **numbers, int num_numbers, char *responses) {
+  char buf[1024];
+  size_t len = 0;
+  int received = 0;
+  int i;
+  for (i = 0; i < num_numbers; i++) {
+    buf[len++] = strlen(numbers[i]);
+    memcpy(buf + len, numbers[i], strlen(numbers[i]));
+    len += strlen(numbers[i]);
+  }
+  assert(write(fd, buf, len) == len);
+  while (received < num_numbers) {
+    ssize_t n = read(fd, responses + received, num_numbers - received);
+    assert(n > 0);
+    received += n;
+  }
+}
+
+int main() {
+  char socket_path[64];
+  const char *numbers[] = { "123", "45", "12", "1234", "", "4x", "45" };
+  char responses[8];
+  pid_t pid;
+  int fd;
+  int i;
+
+  snprintf(socket_path, sizeof(socket_path), "/tmp/trie_test_%d.sock", getpid());
+  copy_file("trie_test_data.bin", "trie_test_current.bin");
+  pid = fork();
+  if (pid == 0) {
+    execl("../../trie_server", "trie_server", "-s", socket_path, "trie_test_current.bin",
+        (char *)NULL);
+    _exit(1);
+  }
+  fd = connect_server(socket_path);
+  assert(fd != -1);
+
+  // pipelined requests in one batch
+  query(fd, numbers, 7, responses);
+  assert(memcmp(responses, "ab\0\0\0\0b", 7) == 0);
+
+  // requests split across writes
+  assert(write(fd, "\x03" "12", 3) == 3);
+  usleep(10000);
+  assert(write(fd, "3\x02" "45", 4) == 4);
+  assert(read(fd, responses, 1) == 1);
+  if (responses[0] == 'a') {
+    assert(read(fd, responses + 1, 1) == 1);
+  } else {
+    responses[1] = responses[0];
+  }
+  assert(responses[1] == 'b');
+
+  // reload on SIGHUP
+  copy_file("trie_test_reload.bin", "trie_test_current.bin");
+  kill(pid, SIGHUP);
+  for (i = 0; i < 100; i++) {
+    query(fd, numbers, 1, responses);
+    if (responses[0] == 'c') {
+      break;
+    }
+    usleep(10000);
+  }
+  assert(responses[0] == 'c');
+  query(fd, numbers + 1, 1, responses);
+  assert(responses[0] == '\0');
+
+  close(fd);
+  kill(pid, SIGTERM);
+  waitpid(pid, NULL, 0);
+  assert(access(socket_path, F_OK) != 0);
+  unlink("trie_test_current.bin");
+
+  return 0;
+}
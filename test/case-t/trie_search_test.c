@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+
+#define NUM_LINES  5000
+
+static char lines[NUM_LINES][16];
+
+static char expected_result(const char *line) {
+  trie_cursor_t cursor;
+  trie_t trie = { trie_data, sizeof(trie_data) };
+  size_t len = strcspn(line, "\r");
+  size_t i;
+  trie_cursor_start(&cursor, &trie);
+  for (i = 0; i < len; i++) {
+    if (line[i] < '0' || line[i] > '9' || trie_cursor_forward(&cursor, line[i] - '0') != 1) {
+      return '\0';
+    }
+  }
+  return trie_cursor_result(&cursor);
+}
+
+static void write_input() {
+  FILE *fp = fopen("trie_test_input.txt", "w");
+  int i;
+  assert(fp);
+  srand(1);
+  for (i = 0; i < NUM_LINES - 1; i++) {
+    switch (i % 7) {
+      case 0:
+        strcpy(lines[i], "");
+        break;
+      case 1:
+        strcpy(lines[i], "12x");
+        break;
+      case 2:
+        sprintf(lines[i], "%d\r", 100 + rand() % 300);
+        break;
+      default:
+        sprintf(lines[i], "%d", rand() % 400);
+    }
+    fprintf(fp, "%s\n", lines[i]);
+  }
+  strcpy(lines[NUM_LINES - 1], "81312345678");
+  // the last line has no newline
+  fprintf(fp, "%s", lines[NUM_LINES - 1]);
+  fclose(fp);
+}
+
+static void check_output(const char *command) {
+  char buf[64];
+  int i;
+  FILE *fp = popen(command, "r");
+  assert(fp);
+  for (i = 0; i < NUM_LINES; i++) {
+    char expected = expected_result(lines[i]);
+    assert(fgets(buf, sizeof(buf), fp));
+    if (expected == '\0') {
+      assert(strcmp(buf, "\n") == 0);
+    } else {
+      assert(buf[0] == expected && buf[1] == '\n' && buf[2] == '\0');
+    }
+  }
+  assert(fgets(buf, sizeof(buf), fp) == NULL);
+  assert(pclose(fp) == 0);
+}
+
+// Empty lines get the result of the root of a trie that has one
+static void check_empty_lines() {
+  char buf[64];
+  int i;
+  FILE *fp = fopen("trie_test_input.txt", "w");
+  assert(fp);
+  for (i = 0; i < NUM_LINES; i++) {
+    fputc('\n', fp);
+  }
+  fclose(fp);
+  fp = popen("../../trie_query -j 1 -p patterns_root.txt trie_test_input.txt", "r");
+  assert(fp);
+  for (i = 0; i < NUM_LINES; i++) {
+    assert(fgets(buf, sizeof(buf), fp));
+    assert(strcmp(buf, "z\n") == 0);
+  }
+  assert(fgets(buf, sizeof(buf), fp) == NULL);
+  assert(pclose(fp) == 0);
+}
+
+int main() {
+  write_input();
+  assert(expected_result("125") == 'd');
+  assert(expected_result("81312345678") == 'f');
+
+  // one thread, one block
+  check_output("../../trie_query -j 1 -p patterns.txt trie_test_input.txt");
+  // several threads and many rounds of small blocks
+  check_output("../../trie_query -j 3 -b 64 -p patterns.txt trie_test_input.txt");
+  check_output("../../trie_query -j 4 -b 1 -t trie_test_data.bin trie_test_input.txt");
+
+  check_empty_lines();
+
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "stride_trie.h"
+#include "trie_test_data.h"
+
+#define NUM_KEYS  3000
+#define KEY_STRIDE  24
+
+static char keys[NUM_KEYS][KEY_STRIDE];
+static uint8_t lens[NUM_KEYS];
+static uint8_t expected[NUM_KEYS];
+static uint8_t results[NUM_KEYS];
+
+static uint8_t packed_data[4096 * 3];
+static trie_t packed;
+
+static uint8_t packed_lookup(const char *key, uint8_t len) {
+  trie_cursor_t cursor;
+  uint8_t i;
+  trie_cursor_start(&cursor, &packed);
+  for (i = 0; i < len; i++) {
+    if (key[i] < '0' || key[i] > '9' || trie_cursor_forward(&cursor, key[i] - '0') != 1) {
+      return '\0';
+    }
+  }
+  return trie_cursor_result(&cursor);
+}
+
+static void make_keys() {
+  static const char *fixed[] = {
+    "", "5", "110", "112", "1190", "125", "12", "320", "3202", "5147",
+    "5267", "81312345678", "9012", "55555555555555555555", "5555555555555555555",
+    "12a", "1a0", "-1", "9:",
+  };
+  unsigned int num_fixed = sizeof(fixed) / sizeof(fixed[0]);
+  unsigned int i;
+  srand(1);
+  for (i = 0; i < NUM_KEYS; i++) {
+    if (i % 5 == 0) {
+      const char *key = fixed[(i / 5) % num_fixed];
+      lens[i] = strlen(key);
+      memcpy(keys[i], key, lens[i]);
+    } else {
+      // random digits, mostly prefixes of 1, 3, 5 and 9
+      unsigned int j;
+      lens[i] = 1 + rand() % 12;
+      for (j = 0; j < lens[i]; j++) {
+        keys[i][j] = '0' + (j == 0 ? "1359"[rand() % 4] - '0' : rand() % 10);
+      }
+      if (rand() % 3 == 0) {
+        keys[i][0] = "15"[rand() % 2];
+        for (j = 1; j < lens[i]; j++) {
+          keys[i][j] = keys[i][0];
+        }
+      }
+    }
+    expected[i] = packed_lookup(keys[i], lens[i]);
+  }
+}
+
+int main() {
+  trie_t stride = { trie_data, sizeof(trie_data) };
+  FILE *fp = fopen("trie_test_data.bin", "rb");
+  unsigned int num_keys;
+  unsigned int i;
+  assert(fp);
+  packed.data = packed_data;
+  packed.len = fread(packed_data, 1, sizeof(packed_data), fp);
+  fclose(fp);
+  make_keys();
+
+  assert(stride_lookup(&stride, "125", 3) == 'd');
+  assert(stride_lookup(&stride, "5", 1) == 'i');
+  assert(stride_lookup(&stride, "55555555555555555555", 20) == 'j');
+  assert(stride_lookup(&stride, "5555555555555555555", 19) == '\0');
+  assert(stride_lookup(&stride, "", 0) == '\0');
+  assert(stride_lookup(&stride, "12a", 3) == '\0');
+
+  for (i = 0; i < NUM_KEYS; i++) {
+    assert(stride_lookup(&stride, keys[i], lens[i]) == expected[i]);
+  }
+
+  // every batch size up to a few groups, and the whole set
+  for (num_keys = 0; num_keys <= 40; num_keys++) {
+    memset(results, 0xff, sizeof(results));
+    stride_lookup_batch(&stride, keys[0], KEY_STRIDE, lens, num_keys, results);
+    assert(memcmp(results, expected, num_keys) == 0);
+    assert(num_keys == NUM_KEYS || results[num_keys] == 0xff);
+  }
+  memset(results, 0xff, sizeof(results));
+  stride_lookup_batch(&stride, keys[0], KEY_STRIDE, lens, NUM_KEYS, results);
+  assert(memcmp(results, expected, NUM_KEYS) == 0);
+  memset(results, 0xff, sizeof(results));
+  stride_lookup_batch_scalar(&stride, keys[0], KEY_STRIDE, lens, NUM_KEYS, results);
+  assert(memcmp(results, expected, NUM_KEYS) == 0);
+
+  // keys packed back to back, where the SIMD kernel reads past each key
+  {
+    static char packed_keys[NUM_KEYS];
+    static uint8_t one[NUM_KEYS];
+    for (i = 0; i < NUM_KEYS; i++) {
+      packed_keys[i] = '0' + i % 10;
+      one[i] = 1;
+      expected[i] = packed_lookup(packed_keys + i, 1);
+    }
+    stride_lookup_batch(&stride, packed_keys, 1, one, NUM_KEYS, results);
+    assert(memcmp(results, expected, NUM_KEYS) == 0);
+  }
+
+  return 0;
+}
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+
+// Look up the digits of a string with the global API
+static uint8_t lookup(const char *digits) {
+  trie_start();
+  for (; *digits; digits++) {
+    if (trie_forward(*digits - '0') != 1) {
+      return '\0';
+    }
+  }
+  return trie_get_result();
+}
+
+int main() {
+  char key[1024];
+  int i;
+  trie_set_data(trie_data, sizeof(trie_data));
+
+  // a pattern longer than 255 characters
+  key[0] = '1';
+  for (i = 0; i < 300; i++) {
+    key[1 + i] = '0' + (i + 1) % 10;
+  }
+  key[301] = '\0';
+  assert(lookup(key) == 'a');
+  key[300] = '\0';
+  assert(lookup(key) == '\0');
+
+  // 1000 branches alive at once
+  for (i = 0; i < 1000; i++) {
+    sprintf(key, "2%03d", i);
+    assert(lookup(key) == 'b');
+  }
+  assert(lookup("200") == '\0');
+
+  // 300 alternatives in one group
+  for (i = 0; i < 300; i++) {
+    sprintf(key, "3%03d", i);
+    assert(lookup(key) == 'c');
+  }
+  assert(lookup("3300") == '\0');
+
+  // 600 nested groups
+  assert(lookup("45") == 'd');
+  assert(lookup("4") == '\0');
+
+  // 300 nested optional groups
+  key[0] = '7';
+  for (i = 1; i <= 300; i++) {
+    key[i] = '\0';
+    assert(lookup(key) == 'e');
+    key[i] = '8';
+  }
+  key[301] = '\0';
+  assert(lookup(key) == 'e');
+  key[301] = '8';
+  key[302] = '\0';
+  assert(lookup(key) == '\0');
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <signal.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+
+extern const uint8_t trie_object[];
+extern const unsigned int trie_object_len;
+extern const uint8_t trie_asm[];
+extern const unsigned int trie_asm_len;
+
+static sigjmp_buf jump_buffer;
+
+static void on_segv(int signum) {
+  siglongjmp(jump_buffer, 1);
+}
+
+// Return 1 if writing to the byte faults
+static int is_read_only(const uint8_t *p) {
+  volatile int faulted = 0;
+  signal(SIGSEGV, on_segv);
+  signal(SIGBUS, on_segv);
+  if (sigsetjmp(jump_buffer, 1) == 0) {
+    *(volatile uint8_t *)p = *p;
+  } else {
+    faulted = 1;
+  }
+  signal(SIGSEGV, SIG_DFL);
+  signal(SIGBUS, SIG_DFL);
+  return faulted;
+}
+
+static void check_lookups(const uint8_t *data, unsigned int len) {
+  trie_set_data(data, len);
+  trie_start();
+  assert(trie_forward(1) == 1);
+  assert(trie_forward(2) == 1);
+  assert(trie_forward(5) == 1);
+  assert(trie_get_result() == 'd');
+
+  trie_start();
+  assert(trie_forward(9) == 1);
+  assert(trie_forward(0) == 1);
+  assert(trie_forward(1) == 1);
+  assert(trie_forward(2) == 1);
+  assert(trie_get_result() == 'g');
+  assert(trie_forward(3) == 0);
+}
+
+int main() {
+  assert(trie_object_len == sizeof(trie_data));
+  assert(memcmp(trie_object, trie_data, sizeof(trie_data)) == 0);
+  assert(trie_asm_len == sizeof(trie_data));
+  assert(memcmp(trie_asm, trie_data, sizeof(trie_data)) == 0);
+
+  assert((uintptr_t)trie_object % 16 == 0);
+  assert((uintptr_t)trie_asm % 16 == 0);
+  assert(is_read_only(trie_object));
+  assert(is_read_only(trie_asm));
+  assert(is_read_only((const uint8_t *)&trie_object_len));
+  assert(!is_read_only(trie_data));
+
+  check_lookups(trie_object, trie_object_len);
+  check_lookups(trie_asm, trie_asm_len);
+
+  return 0;
+}
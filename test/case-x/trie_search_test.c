@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+
+#define BIT(n)  (1 << (n))
+
+int main() {
+  trie_t trie = { trie_data, sizeof(trie_data) };
+  trie_cursor_t cursor;
+  trie_set_data(trie_data, sizeof(trie_data));
+
+  trie_start();
+  assert(trie_next_mask() == (BIT(1) | BIT(5) | BIT(9)));
+  assert(trie_is_complete() == 0);
+
+  assert(trie_forward(1) == 1);
+  assert(trie_next_mask() == (BIT(1) | BIT(2)));
+  assert(trie_forward(1) == 1);
+  assert(trie_next_mask() == (BIT(0) | BIT(9)));
+  assert(trie_is_complete() == 0);
+
+  // a result with a longer match still possible
+  assert(trie_forward(9) == 1);
+  assert(trie_get_result() == 'b');
+  assert(trie_next_mask() == BIT(0));
+  assert(trie_is_complete() == 0);
+  // asking does not move the current node
+  assert(trie_forward(0) == 1);
+  assert(trie_get_result() == 'c');
+  assert(trie_next_mask() == 0);
+  assert(trie_is_complete() == 1);
+
+  trie_start();
+  assert(trie_forward(1) == 1);
+  assert(trie_forward(2) == 1);
+  assert(trie_get_result() == '\0');
+  assert(trie_next_mask() == (BIT(0) | BIT(1) | BIT(2)));
+  assert(trie_is_complete() == 0);
+  assert(trie_forward(2) == 1);
+  assert(trie_is_complete() == 1);
+
+  trie_start();
+  assert(trie_forward(5) == 1);
+  assert(trie_next_mask() == 0);
+  assert(trie_is_complete() == 1);
+
+  // the mask agrees with trie_cursor_forward for every digit
+  trie_cursor_start(&cursor, &trie);
+  assert(trie_cursor_forward(&cursor, 9) == 1);
+  {
+    uint16_t mask = trie_cursor_next_mask(&cursor);
+    uint8_t digit;
+    assert(mask == BIT(1));
+    for (digit = 0; digit < 10; digit++) {
+      trie_cursor_t probe = cursor;
+      assert(trie_cursor_forward(&probe, digit) == ((mask >> digit) & 1));
+    }
+  }
+  assert(trie_cursor_is_complete(&cursor) == 0);
+  assert(trie_cursor_forward(&cursor, 1) == 1);
+  assert(trie_cursor_forward(&cursor, 1) == 1);
+  assert(trie_cursor_is_complete(&cursor) == 1);
+  assert(trie_cursor_next_mask(&cursor) == 0);
+
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+
+static uint8_t lookup(const char *digits) {
+  size_t i;
+  trie_start();
+  for (i = 0; i < strlen(digits); i++) {
+    if (trie_forward(digits[i] - '0') != 1) {
+      return '\0';
+    }
+  }
+  return trie_get_result();
+}
+
+int main() {
+  trie_set_data(trie_data, sizeof(trie_data));
+
+  // each x{6} takes six nodes (and six slots), not a million
+  assert(sizeof(trie_data) < 200 * BYTES_PER_NODE);
+
+  assert(lookup("2125551234") == 'l');
+  assert(lookup("9995550000") == 'l');
+  assert(lookup("9115551234") == 'l');
+  assert(lookup("12125551234") == 'n');
+  assert(lookup("19999999999") == 'n');
+  assert(lookup("2120551234") == '\0');
+  assert(lookup("11125551234") == '\0');
+  assert(lookup("212555123") == '\0');
+  assert(lookup("21255512345") == '\0');
+
+  // a literal inside a class keeps the rest of the class
+  assert(lookup("911") == 'e');
+  assert(lookup("811") == '\0');
+
+  assert(lookup("01112") == '\0');
+  assert(lookup("011123") == 'i');
+  assert(lookup("0111234") == 'i');
+  assert(lookup("01112345") == 'i');
+  assert(lookup("011123456") == '\0');
+
+  assert(lookup("4") == 'c');
+  assert(lookup("45") == 'c');
+  assert(lookup("49") == 'c');
+  assert(lookup("43") == '\0');
+
+  // a set of digits is followed by every digit in it
+  trie_start();
+  assert(trie_next_mask() == 0x3ff);
+  assert(trie_forward(1) == 1);
+  assert(trie_next_mask() == 0x3fc);
+  trie_start();
+  assert(trie_forward(9) == 1);
+  assert(trie_forward(1) == 1);
+  assert(trie_next_mask() == 0x3ff);
+  assert(trie_is_complete() == 0);
+  assert(trie_forward(1) == 1);
+  assert(trie_get_result() == 'e');
+  assert(trie_is_complete() == 0);
+  assert(lookup("01112345") == 'i');
+  assert(trie_is_complete() == 1);
+  assert(lookup("0111234") == 'i');
+  assert(trie_is_complete() == 0);
+
+  // the char of a set node is not a digit
+  trie_start();
+  assert(trie_forward(NODE_CHAR_SET) == 0);
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "minimal_trie.h"
+#include "trie_test_data.h"
+#include "trie_test_jump.h"
+
+#define MAX_LEN  5
+
+static uint8_t lookup(const trie_t *trie, const uint8_t *digits, uint8_t len) {
+  trie_cursor_t cursor;
+  uint8_t i;
+  trie_cursor_start(&cursor, trie);
+  for (i = 0; i < len; i++) {
+    if (trie_cursor_forward(&cursor, digits[i]) != 1) {
+      return '\0';
+    }
+  }
+  return trie_cursor_result(&cursor);
+}
+
+static uint8_t jump_lookup(const trie_jump_t *jump, const uint8_t *digits, uint8_t len) {
+  trie_cursor_t cursor;
+  uint8_t i = 0;
+  if (len < jump->depth) {
+    return lookup(&jump->trie, digits, len);
+  }
+  if (trie_cursor_jump(&cursor, jump, digits) != 1) {
+    return '\0';
+  }
+  for (i = jump->depth; i < len; i++) {
+    if (trie_cursor_forward(&cursor, digits[i]) != 1) {
+      return '\0';
+    }
+  }
+  return trie_cursor_result(&cursor);
+}
+
+int main() {
+  trie_t trie = { trie_data, sizeof(trie_data) };
+  trie_jump_t jump = trie_jump_open(trie_jump_data, sizeof(trie_jump_data));
+  uint8_t digits[MAX_LEN];
+  uint8_t len;
+  unsigned int n;
+  unsigned int num_found = 0;
+
+  assert(jump.depth == 3);
+  // the table is followed by the same packed trie
+  assert(jump.trie.len == sizeof(trie_data));
+  assert(jump.trie.data == trie_jump_data + TRIE_JUMP_HEADER_SIZE + 2000);
+
+  // every key of up to MAX_LEN digits gives the same result both ways
+  for (len = 0; len <= MAX_LEN; len++) {
+    unsigned int num_keys = 1;
+    uint8_t i;
+    for (i = 0; i < len; i++) {
+      num_keys *= 10;
+    }
+    for (n = 0; n < num_keys; n++) {
+      unsigned int rest = n;
+      for (i = len; i > 0; i--) {
+        digits[i - 1] = rest % 10;
+        rest /= 10;
+      }
+      uint8_t result = lookup(&trie, digits, len);
+      assert(jump_lookup(&jump, digits, len) == result);
+      if (result != '\0') {
+        num_found++;
+      }
+    }
+  }
+  assert(num_found > 1900);
+
+  // a prefix that is not in the trie is a miss in the table
+  {
+    uint8_t missing[] = { 4, 0, 0 };
+    uint8_t short_path[] = { 0, 1, 0 };
+    uint8_t found[] = { 9, 1, 1 };
+    trie_cursor_t cursor;
+    assert(trie_cursor_jump(&cursor, &jump, missing) == 0);
+    assert(trie_cursor_jump(&cursor, &jump, short_path) == 0);
+    assert(trie_cursor_jump(&cursor, &jump, found) == 1);
+    assert(trie_cursor_result(&cursor) == 'e');
+    assert(trie_cursor_forward(&cursor, 1) == 0);
+  }
+
+  return 0;
+}
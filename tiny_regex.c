@@ -6,6 +6,9 @@
 #define ENABLE_TRIE_DIAGNOSIS  1
 #define BYTES_PER_NODE  3
 
+// Packed char of a node for a set of digits (NODE_CHAR_SET in minimal_trie.h)
+#define PACKED_CHAR_SET  0xf
+
 // USE_GRAPH==1 will not work due to a fundamental problem
 #define USE_GRAPH  0
 
@@ -35,49 +38,50 @@
 #define FREE(ptr)  free(ptr)
 #endif
 
+// Digits matched by an edge, bit n for digit n
+#define ALL_DIGITS  0x3ff
+
+// Largest count accepted in {m} and {m,n}
+#define MAX_REPEAT  255
+
 typedef struct pnode {
-  uint8_t node_char;
+  uint8_t node_char;  // '0'-'9', or 'x' for a set of digits
+  uint16_t digits;
   char result;
+  uint8_t is_head;      // mark for remove_duplicate_heads()
+  struct pnode *copy;   // set by copy_subtree() until clear_copies()
+  unsigned long hits;   // lookups through the node, set by tinreg_add_hits()
   struct pnode **next_nodes;
-  uint8_t num_next_nodes;
+  unsigned int num_next_nodes;
 #if ENABLE_TRIE_DIAGNOSIS
   struct pnode **previous_nodes;
-  uint8_t previous_nodes_len;
+  unsigned int previous_nodes_len;
 #endif
 } pnode;
 
-static pnode root_node = {
-  .node_char = 0,
-  .result = '\0',
-  .next_nodes = NULL,
-  .num_next_nodes = 0,
-#if ENABLE_TRIE_DIAGNOSIS
-  .previous_nodes = NULL,
-  .previous_nodes_len = 0,
-#endif
-};
-
 typedef struct pnode_stack_item {
   pnode **nodes;
-  uint8_t nodes_len;
+  unsigned int nodes_len;
 #if USE_GRAPH
   uint8_t can_merge_next;
 #endif
 } pnode_stack_item;
 
-static pnode_stack_item **pnode_stack;
-static uint8_t pnode_stack_len = 0;
-
-static pnode_stack_item **pnode_group_stack;
-static uint8_t pnode_group_stack_len = 0;
-
-static pnode *lookup_head;
-
-static int display_depth = 0;
-
+// All state of one trie being built
+struct tinreg_builder_t {
+  pnode root_node;
+  pnode_stack_item **pnode_stack;
+  unsigned int pnode_stack_len;
+  pnode_stack_item **pnode_group_stack;
+  unsigned int pnode_group_stack_len;
+  pnode *lookup_head;
 #if USE_GRAPH
-static uint8_t can_merge_next = 0;
+  uint8_t can_merge_next;
 #endif
+};
+
+// Builder of the tinreg_* functions that take no builder
+static tinreg_builder_t default_builder;
 
 static void add_pnode(pnode *base, pnode *add) {
   // Link base -> add
@@ -103,10 +107,37 @@ static void add_pnode(pnode *base, pnode *add) {
 #endif
 }
 
-static void push_pnode_stack(pnode ***branch_nodes, uint8_t *num_branch_nodes) {
-  uint8_t copy_len = sizeof(pnode *) * *num_branch_nodes;
-  REALLOC(pnode_stack, sizeof(pnode *) * (pnode_stack_len + 1));
-  if (!pnode_stack) {
+static void append_head(pnode ***heads, unsigned int *num_heads, pnode *node) {
+  REALLOC(*heads, sizeof(pnode *) * (*num_heads + 1));
+  if (!*heads) {
+    fprintf(stderr, "append_head: realloc failed\n");
+    *num_heads = 0;
+    return;
+  }
+  (*heads)[*num_heads] = node;
+  (*num_heads)++;
+}
+
+// Keep only the first occurrence of each head
+static void remove_duplicate_heads(pnode **heads, unsigned int *num_heads) {
+  unsigned int i;
+  unsigned int n = 0;
+  for (i = 0; i < *num_heads; i++) {
+    if (!heads[i]->is_head) {
+      heads[i]->is_head = 1;
+      heads[n++] = heads[i];
+    }
+  }
+  for (i = 0; i < n; i++) {
+    heads[i]->is_head = 0;
+  }
+  *num_heads = n;
+}
+
+static void push_pnode_stack(tinreg_builder_t *builder, pnode ***branch_nodes, unsigned int *num_branch_nodes) {
+  size_t copy_len = sizeof(pnode *) * *num_branch_nodes;
+  REALLOC(builder->pnode_stack, sizeof(pnode_stack_item *) * (builder->pnode_stack_len + 1));
+  if (!builder->pnode_stack) {
     fprintf(stderr, "realloc failed for pnode_stack\n");
     return;
   }
@@ -117,7 +148,7 @@ static void push_pnode_stack(pnode ***branch_nodes, uint8_t *num_branch_nodes) {
     return;
   }
 #if USE_GRAPH
-  stack_item->can_merge_next = can_merge_next;
+  stack_item->can_merge_next = builder->can_merge_next;
 #endif
   stack_item->nodes = MALLOC(copy_len);
   if (!stack_item->nodes) {
@@ -130,12 +161,12 @@ static void push_pnode_stack(pnode ***branch_nodes, uint8_t *num_branch_nodes) {
 
   stack_item->nodes_len = *num_branch_nodes;
 
-  pnode_stack[pnode_stack_len] = stack_item;
-  pnode_stack_len++;
+  builder->pnode_stack[builder->pnode_stack_len] = stack_item;
+  builder->pnode_stack_len++;
 
   // add to group stack
-  REALLOC(pnode_group_stack, sizeof(pnode *) * (pnode_group_stack_len + 1));
-  if (!pnode_group_stack) {
+  REALLOC(builder->pnode_group_stack, sizeof(pnode_stack_item *) * (builder->pnode_group_stack_len + 1));
+  if (!builder->pnode_group_stack) {
     fprintf(stderr, "realloc failed for pnode_group_stack\n");
     return;
   }
@@ -147,38 +178,39 @@ static void push_pnode_stack(pnode ***branch_nodes, uint8_t *num_branch_nodes) {
     return;
   }
   group_stack_item->nodes_len = 0;  // TODO: unnecessary?
-  pnode_group_stack[pnode_group_stack_len] = group_stack_item;
-  pnode_group_stack_len++;
+  builder->pnode_group_stack[builder->pnode_group_stack_len] = group_stack_item;
+  builder->pnode_group_stack_len++;
 }
 
-static void save_group(pnode ***branch_nodes, uint8_t *num_branch_nodes) {
-  if (pnode_group_stack_len == 0) {
+static void save_group(tinreg_builder_t *builder, pnode ***branch_nodes, unsigned int *num_branch_nodes) {
+  if (builder->pnode_group_stack_len == 0) {
     fprintf(stderr, "save_group error: group stack is empty\n");
     return;
   }
-  pnode_stack_item *group_stack_item = pnode_group_stack[pnode_group_stack_len - 1];
+  pnode_stack_item *group_stack_item = builder->pnode_group_stack[builder->pnode_group_stack_len - 1];
   REALLOC(group_stack_item->nodes,
       sizeof(pnode *) * (group_stack_item->nodes_len + *num_branch_nodes));
   if (!group_stack_item->nodes) {
     fprintf(stderr, "save_group error: memory allocation failed for group_stack_item\n");
     return;
   }
-  uint8_t i;
+  unsigned int i;
   for (i = 0; i < *num_branch_nodes; i++) {
     group_stack_item->nodes[group_stack_item->nodes_len + i] = (*branch_nodes)[i];
   }
   group_stack_item->nodes_len += *num_branch_nodes;
+  remove_duplicate_heads(group_stack_item->nodes, &group_stack_item->nodes_len);
 }
 
-static void set_head_to_last_trunk(pnode ***branch_nodes, uint8_t *num_branch_nodes) {
-  if (pnode_stack_len > 0) {
-    pnode_stack_item *last_trunk = pnode_stack[pnode_stack_len - 1];
+static void set_head_to_last_trunk(tinreg_builder_t *builder, pnode ***branch_nodes, unsigned int *num_branch_nodes) {
+  if (builder->pnode_stack_len > 0) {
+    pnode_stack_item *last_trunk = builder->pnode_stack[builder->pnode_stack_len - 1];
 #if USE_GRAPH
-    can_merge_next = last_trunk->can_merge_next;
+    builder->can_merge_next = last_trunk->can_merge_next;
 #endif
     if (*num_branch_nodes < last_trunk->nodes_len) {
-      REALLOC(*branch_nodes, last_trunk->nodes_len);
-      if (!branch_nodes) {
+      REALLOC(*branch_nodes, sizeof(pnode *) * last_trunk->nodes_len);
+      if (!*branch_nodes) {
         fprintf(stderr, "set_head_to_last_trunk: failed to realloc branch_nodes\n");
         return;
       }
@@ -191,16 +223,49 @@ static void set_head_to_last_trunk(pnode ***branch_nodes, uint8_t *num_branch_no
   }
 }
 
-static int memory_usage;
+// Write a set of digits as "x" or a class such as "[0-35]"
+static void format_digits(char *buf, uint16_t digits) {
+  uint8_t d = 0;
+  if (digits == ALL_DIGITS) {
+    strcpy(buf, "x");
+    return;
+  }
+  *buf++ = '[';
+  while (d < 10) {
+    uint8_t last = d;
+    if (!((digits >> d) & 1)) {
+      d++;
+      continue;
+    }
+    while (last + 1 < 10 && ((digits >> (last + 1)) & 1)) {
+      last++;
+    }
+    *buf++ = '0' + d;
+    if (last >= d + 2) {
+      *buf++ = '-';
+      *buf++ = '0' + last;
+    } else if (last == d + 1) {
+      *buf++ = '0' + last;
+    }
+    d = last + 1;
+  }
+  *buf++ = ']';
+  *buf = '\0';
+}
 
-static void display_node(pnode *node) {
+// Return the number of nodes displayed
+static unsigned int display_node(pnode *node, int depth) {
+  unsigned int num_nodes = 1;
   int i;
   int j;
-  memory_usage += sizeof(pnode);
-  for (j = 0; j < display_depth; j++) {
+  for (j = 0; j < depth; j++) {
     printf("  ");
   }
-  if (node->node_char != '\0') {
+  if (node->node_char == 'x') {
+    char set[24];
+    format_digits(set, node->digits);
+    printf("node %s", set);
+  } else if (node->node_char != '\0') {
     printf("node %c", node->node_char);
   } else {
     printf("node (none)");
@@ -213,16 +278,15 @@ static void display_node(pnode *node) {
   }
   printf("\n");
   for (i = 0; i < node->num_next_nodes; i++) {
-    display_depth++;
-    display_node(node->next_nodes[i]);
-    display_depth--;
+    num_nodes += display_node(node->next_nodes[i], depth + 1);
   }
+  return num_nodes;
 }
 
-static void merge_pnodes(pnode ***branch_nodes, uint8_t *num_branch_nodes, pnode_stack_item *add_pnodes) {
-  uint8_t total_len = *num_branch_nodes + add_pnodes->nodes_len;
+static void merge_pnodes(pnode ***branch_nodes, unsigned int *num_branch_nodes, pnode_stack_item *add_pnodes) {
+  unsigned int total_len = *num_branch_nodes + add_pnodes->nodes_len;
   REALLOC(*branch_nodes, sizeof(pnode *) * total_len);
-  if (!branch_nodes) {
+  if (!*branch_nodes) {
     fprintf(stderr, "merge_pnodes: realloc failed\n");
     return;
   }
@@ -231,17 +295,18 @@ static void merge_pnodes(pnode ***branch_nodes, uint8_t *num_branch_nodes, pnode
   *num_branch_nodes += add_pnodes->nodes_len;
 }
 
-static pnode_stack_item *pop_pnode_stack(pnode ***branch_nodes, uint8_t *num_branch_nodes) {
-  if (pnode_stack_len > 0) {
-    pnode_group_stack_len--;
-    pnode_stack_item *group_stack_item = pnode_group_stack[pnode_group_stack_len];
+static pnode_stack_item *pop_pnode_stack(tinreg_builder_t *builder, pnode ***branch_nodes, unsigned int *num_branch_nodes) {
+  if (builder->pnode_stack_len > 0) {
+    builder->pnode_group_stack_len--;
+    pnode_stack_item *group_stack_item = builder->pnode_group_stack[builder->pnode_group_stack_len];
     if (group_stack_item->nodes_len > 0) {
       merge_pnodes(branch_nodes, num_branch_nodes, group_stack_item);
     }
+    FREE(group_stack_item->nodes);
     FREE(group_stack_item);
 
-    pnode_stack_len--;
-    return pnode_stack[pnode_stack_len];  // needs to be free'd in caller
+    builder->pnode_stack_len--;
+    return builder->pnode_stack[builder->pnode_stack_len];  // needs to be free'd in caller
   } else {
     fprintf(stderr, "pop_pnode_stack: stack is empty\n");
     return NULL;
@@ -249,9 +314,9 @@ static pnode_stack_item *pop_pnode_stack(pnode ***branch_nodes, uint8_t *num_bra
 }
 
 #if USE_GRAPH
-static void delete_branch_node(pnode ***branch_nodes, uint8_t *num_branch_nodes, uint8_t delete_index) {
-  uint8_t i;
-  uint8_t num_deleted = 0;
+static void delete_branch_node(pnode ***branch_nodes, unsigned int *num_branch_nodes, unsigned int delete_index) {
+  unsigned int i;
+  unsigned int num_deleted = 0;
   for (i = 0; i < *num_branch_nodes; i++) {
     if (i == delete_index) {
       num_deleted++;
@@ -265,71 +330,58 @@ static void delete_branch_node(pnode ***branch_nodes, uint8_t *num_branch_nodes,
 }
 #endif
 
-static void add_branch_node(pnode ***branch_nodes, uint8_t *num_branch_nodes, uint8_t node_char, uint8_t is_optional) {
-  uint8_t i, j;
-  int orig_num_branch_nodes = *num_branch_nodes;
-  pnode *next_node;
+static void set_node_digits(pnode *node, uint16_t digits) {
+  uint8_t d;
+  node->digits = digits;
+  if (digits & (digits - 1)) {
+    node->node_char = 'x';
+    return;
+  }
+  for (d = 0; !((digits >> d) & 1); d++) {
+  }
+  node->node_char = '0' + d;
+}
 
 #if USE_GRAPH
-  can_merge_next = 0;
-#endif
+static void add_branch_node(tinreg_builder_t *builder, pnode ***branch_nodes, unsigned int *num_branch_nodes, uint16_t digits, uint8_t is_optional) {
+  unsigned int i, j;
+  unsigned int orig_num_branch_nodes = *num_branch_nodes;
+  pnode *next_node;
+
+  builder->can_merge_next = 0;
 
   if (orig_num_branch_nodes == 0) {
     fprintf(stderr, "warning: branch_nodes is empty\n");
     return;
   }
 
-#if USE_GRAPH
-  if (can_merge_next) {
+  if (builder->can_merge_next) {
     CALLOC(next_node, sizeof(pnode));
     if (!next_node) {
       fprintf(stderr, "add_branch_node: calloc failed for pnode: size=%u\n",
           sizeof(pnode));
       return;
     }
-    next_node->node_char = node_char;
+    set_node_digits(next_node, digits);
     next_node->next_nodes = NULL;
     next_node->num_next_nodes = 0;
   }
-#endif
 
   for (i = 0; i < orig_num_branch_nodes; i++) {
     pnode *head_node = (*branch_nodes)[i];
 
-#if !(USE_GRAPH)
-    uint8_t has_child = 0;
-    // The following code is applicable only to a trie structure
-    if (head_node->num_next_nodes > 0) { // check child contents
-      for (j = 0; j < head_node->num_next_nodes; j++) {
-        if (head_node->next_nodes[j]->node_char == node_char) {
-          has_child = 1;
-          (*branch_nodes)[i] = head_node->next_nodes[j];
-          break;
-        }
+    if (!builder->can_merge_next) {
+      CALLOC(next_node, sizeof(pnode));
+      if (!next_node) {
+        fprintf(stderr, "add_branch_node: memory allocation failed for pnode\n");
+        return;
       }
+      set_node_digits(next_node, digits);
+      next_node->next_nodes = NULL;
+      next_node->num_next_nodes = 0;
     }
-    if (!has_child) {
-#endif
-
-#if USE_GRAPH
-      if (!can_merge_next) {
-#endif
-        CALLOC(next_node, sizeof(pnode));
-        if (!next_node) {
-          fprintf(stderr, "add_branch_node: memory allocation failed for pnode\n");
-          return;
-        }
-        next_node->node_char = node_char;
-        next_node->next_nodes = NULL;
-        next_node->num_next_nodes = 0;
-#if USE_GRAPH
-      }
-#endif
-      add_pnode(head_node, next_node);
-      (*branch_nodes)[i] = next_node;
-#if !(USE_GRAPH)
-    }  // if (!has_child)
-#endif
+    add_pnode(head_node, next_node);
+    (*branch_nodes)[i] = next_node;
 
     if (is_optional) {
       REALLOC(*branch_nodes, sizeof(pnode *) * (*num_branch_nodes + 1));
@@ -342,8 +394,7 @@ static void add_branch_node(pnode ***branch_nodes, uint8_t *num_branch_nodes, ui
     }
   }
 
-#if USE_GRAPH
-  if (can_merge_next) {
+  if (builder->can_merge_next) {
     int k;
     while (*num_branch_nodes >= 2) {
       for (j = 0; j < *num_branch_nodes; j++) {
@@ -359,41 +410,176 @@ static void add_branch_node(pnode ***branch_nodes, uint8_t *num_branch_nodes, ui
       continue;
     }
 
-    can_merge_next = 0;
+    builder->can_merge_next = 0;
   }
 
   if (is_optional) {
-    can_merge_next = 1;
+    builder->can_merge_next = 1;
   }
-#endif
 }
 
-#if ENABLE_TRIE_DIAGNOSIS
-static void print_path_to_root(FILE *out, pnode *node) {
-  char path[32];
-  char *path_ptr = path;
-  uint8_t depth = 0;
-  while (node != &root_node) {
-    if (depth >= 16) {
-      fprintf(out, "depth overflow\n");
-      break;
+#else
+// Copy node and its subtree, leaving a link to each copy in node->copy
+static pnode *copy_subtree(pnode *node) {
+  unsigned int i;
+  pnode *copy;
+  CALLOC(copy, sizeof(pnode));
+  if (!copy) {
+    fprintf(stderr, "copy_subtree: memory allocation failed for pnode\n");
+    return NULL;
+  }
+  copy->node_char = node->node_char;
+  copy->digits = node->digits;
+  copy->result = node->result;
+  node->copy = copy;
+  for (i = 0; i < node->num_next_nodes; i++) {
+    pnode *child = copy_subtree(node->next_nodes[i]);
+    if (!child) {
+      return NULL;
     }
-    if (depth > 0) {
-      *path_ptr++ = '-';
+    add_pnode(copy, child);
+  }
+  return copy;
+}
+
+static void clear_copies(pnode *node) {
+  unsigned int i;
+  node->copy = NULL;
+  for (i = 0; i < node->num_next_nodes; i++) {
+    clear_copies(node->next_nodes[i]);
+  }
+}
+
+// Add the copy of every copied node in heads to heads
+static void add_copied_heads(pnode ***heads, unsigned int *num_heads) {
+  unsigned int i;
+  unsigned int n = *num_heads;
+  for (i = 0; i < n; i++) {
+    if ((*heads)[i]->copy) {
+      append_head(heads, num_heads, (*heads)[i]->copy);
+    }
+  }
+  if (*num_heads > n) {
+    remove_duplicate_heads(*heads, num_heads);
+  }
+}
+
+// Split the edge parent -> node so that a new copy of node takes the given
+// digits. Wherever the pattern being added has a head inside the subtree of
+// node, the same place in the copy becomes a head too.
+// Return the copy, or NULL if error
+static pnode *split_node(tinreg_builder_t *builder, pnode *parent, pnode *node, uint16_t digits,
+    pnode ***branch_nodes, unsigned int *num_branch_nodes,
+    pnode ***new_heads, unsigned int *num_new_heads) {
+  unsigned int i;
+  pnode *copy = copy_subtree(node);
+  if (!copy) {
+    return NULL;
+  }
+  set_node_digits(copy, digits);
+  set_node_digits(node, node->digits & ~digits);
+  add_pnode(parent, copy);
+
+  add_copied_heads(branch_nodes, num_branch_nodes);
+  add_copied_heads(new_heads, num_new_heads);
+  for (i = 0; i < builder->pnode_stack_len; i++) {
+    add_copied_heads(&builder->pnode_stack[i]->nodes, &builder->pnode_stack[i]->nodes_len);
+  }
+  for (i = 0; i < builder->pnode_group_stack_len; i++) {
+    add_copied_heads(&builder->pnode_group_stack[i]->nodes, &builder->pnode_group_stack[i]->nodes_len);
+  }
+  clear_copies(node);
+  return copy;
+}
+
+// Go from each head along an edge for digits. The children of a node match
+// disjoint sets of digits, so a child that matches only some of the digits
+// is split first.
+static void add_branch_node(tinreg_builder_t *builder, pnode ***branch_nodes, unsigned int *num_branch_nodes, uint16_t digits, uint8_t is_optional) {
+  unsigned int i, j;
+  pnode **new_heads = NULL;
+  unsigned int num_new_heads = 0;
+  pnode *next_node;
+
+  if (*num_branch_nodes == 0) {
+    fprintf(stderr, "warning: branch_nodes is empty\n");
+    return;
+  }
+
+  // split_node() may add heads to branch_nodes while looping
+  for (i = 0; i < *num_branch_nodes; i++) {
+    pnode *head_node = (*branch_nodes)[i];
+    uint16_t remaining = digits;
+    unsigned int num_children = head_node->num_next_nodes;
+    for (j = 0; j < num_children && remaining; j++) {
+      next_node = head_node->next_nodes[j];
+      uint16_t common = next_node->digits & remaining;
+      if (!common) {
+        continue;
+      }
+      if (common != next_node->digits) {
+        next_node = split_node(builder, head_node, next_node, common,
+            branch_nodes, num_branch_nodes, &new_heads, &num_new_heads);
+        if (!next_node) {
+          return;
+        }
+      }
+      remaining &= ~common;
+      append_head(&new_heads, &num_new_heads, next_node);
+    }
+    if (remaining) {
+      CALLOC(next_node, sizeof(pnode));
+      if (!next_node) {
+        fprintf(stderr, "add_branch_node: memory allocation failed for pnode\n");
+        return;
+      }
+      set_node_digits(next_node, remaining);
+      add_pnode(head_node, next_node);
+      append_head(&new_heads, &num_new_heads, next_node);
     }
-    sprintf(path_ptr++, "%c", node->node_char);
-    node = node->previous_nodes[0];
+  }
+
+  if (is_optional) {
+    for (i = 0; i < *num_branch_nodes; i++) {
+      append_head(&new_heads, &num_new_heads, (*branch_nodes)[i]);
+    }
+  }
+  remove_duplicate_heads(new_heads, &num_new_heads);
+  FREE(*branch_nodes);
+  *branch_nodes = new_heads;
+  *num_branch_nodes = num_new_heads;
+}
+#endif
+
+#if ENABLE_TRIE_DIAGNOSIS
+// The root is the only node without previous nodes
+static void print_path_to_root(FILE *out, pnode *node) {
+  pnode *p;
+  unsigned int depth = 0;
+  for (p = node; p->previous_nodes_len > 0; p = p->previous_nodes[0]) {
     depth++;
   }
-  while (path_ptr != path) {
-    path_ptr--;
-    fprintf(out, "%c", *path_ptr);
+  if (depth == 0) {
+    return;
   }
+  char *path = MALLOC(depth * 2);
+  if (!path) {
+    fprintf(out, "(path too long)");
+    return;
+  }
+  // fill the path from the end, as the nodes are visited leaf first
+  char *path_ptr = path + depth * 2 - 1;
+  for (p = node; p->previous_nodes_len > 0; p = p->previous_nodes[0]) {
+    *path_ptr-- = p->node_char;
+    *path_ptr-- = '-';
+  }
+  fprintf(out, "%.*s", (int)(depth * 2 - 1), path + 1);
+  FREE(path);
 }
 #endif
 
-static void add_results(pnode **branch_nodes, uint8_t num_branch_nodes, char result) {
-  uint8_t i;
+static void add_results(pnode **branch_nodes, unsigned int num_branch_nodes, char result) {
+  unsigned int i;
   for (i = 0; i < num_branch_nodes; i++) {
     if (branch_nodes[i]->result != '\0') {
 #if ENABLE_TRIE_DIAGNOSIS
@@ -414,23 +600,79 @@ static void add_results(pnode **branch_nodes, uint8_t num_branch_nodes, char res
   }
 }
 
-// Add the new pattern and the result character
-int8_t tinreg_add_pattern(char *pat, uint8_t pat_len, char result) {
-  int i;
+// Parse the class starting with '[' at pat[*i] into a set of digits
+// On return *i is the index of the closing ']'
+// Return 0 if success, -1 if error
+static int parse_class(const char *pat, unsigned int pat_len, unsigned int *i, uint16_t *digits) {
+  unsigned int j = *i + 1;
+  uint8_t is_negated = 0;
+  *digits = 0;
+  if (j < pat_len && pat[j] == '^') {
+    is_negated = 1;
+    j++;
+  }
+  for (; j < pat_len && pat[j] != ']'; j++) {
+    char first = pat[j];
+    char last = first;
+    if (j + 2 < pat_len && pat[j+1] == '-' && pat[j+2] != ']') {
+      last = pat[j+2];
+      j += 2;
+    }
+    if (first < '0' || first > '9' || last < '0' || last > '9' || last < first) {
+      fprintf(stderr, "error: invalid class (only digits and ranges allowed) in pattern: %.*s\n",
+          (int)pat_len, pat);
+      return -1;
+    }
+    for (; first <= last; first++) {
+      *digits |= 1 << (first - '0');
+    }
+  }
+  if (j == pat_len) {
+    fprintf(stderr, "error: missing ] in pattern: %.*s\n", (int)pat_len, pat);
+    return -1;
+  }
+  if (is_negated) {
+    *digits = ~*digits & ALL_DIGITS;
+  }
+  if (*digits == 0) {
+    fprintf(stderr, "error: empty class in pattern: %.*s\n", (int)pat_len, pat);
+    return -1;
+  }
+  *i = j;
+  return 0;
+}
+
+// Free the stack items left by a pattern with an error or without a closing )
+static void discard_stacks(tinreg_builder_t *builder) {
+  while (builder->pnode_stack_len > 0) {
+    builder->pnode_stack_len--;
+    FREE(builder->pnode_stack[builder->pnode_stack_len]->nodes);
+    FREE(builder->pnode_stack[builder->pnode_stack_len]);
+  }
+  while (builder->pnode_group_stack_len > 0) {
+    builder->pnode_group_stack_len--;
+    FREE(builder->pnode_group_stack[builder->pnode_group_stack_len]->nodes);
+    FREE(builder->pnode_group_stack[builder->pnode_group_stack_len]);
+  }
+}
+
+static int8_t add_pattern(tinreg_builder_t *builder, const char *pat, unsigned int pat_len, char result) {
+  unsigned int i;
+  uint16_t digits;
   pnode_stack_item *last_pnodes;
   pnode **branch_nodes = MALLOC(sizeof(pnode *));
   if (!branch_nodes) {
     fprintf(stderr, "malloc error\n");
     return -1;
   }
-  branch_nodes[0] = &root_node;
-  uint8_t num_branch_nodes = 1;
+  branch_nodes[0] = &builder->root_node;
+  unsigned int num_branch_nodes = 1;
   for (i = 0; i < pat_len; i++) {
     char c = pat[i];
     uint8_t is_optional = 0;
 
-    // look-ahead '?'
-    if (i < pat_len - 1) {
+    // look-ahead '?' (after the ']' for a class)
+    if (c != '[' && i + 1 < pat_len) {
       if (pat[i+1] == '?') {
         is_optional = 1;
         i++;
@@ -447,7 +689,21 @@ int8_t tinreg_add_pattern(char *pat, uint8_t pat_len, char result) {
       case '7':
       case '8':
       case '9':
-        add_branch_node(&branch_nodes, &num_branch_nodes, c, is_optional);
+        add_branch_node(builder, &branch_nodes, &num_branch_nodes, 1 << (c - '0'), is_optional);
+        break;
+      case 'x':  // any digit
+      case 'X':
+        add_branch_node(builder, &branch_nodes, &num_branch_nodes, ALL_DIGITS, is_optional);
+        break;
+      case '[':  // class of digits
+        if (parse_class(pat, pat_len, &i, &digits) != 0) {
+          goto error;
+        }
+        if (i + 1 < pat_len && pat[i+1] == '?') {
+          is_optional = 1;
+          i++;
+        }
+        add_branch_node(builder, &branch_nodes, &num_branch_nodes, digits, is_optional);
         break;
       case '?':  // previous character is optional
         fprintf(stderr, "warning: orphan ? detected in pattern\n");
@@ -455,14 +711,14 @@ int8_t tinreg_add_pattern(char *pat, uint8_t pat_len, char result) {
         break;
       case '(':  // start grouping
         // create a branch here
-        push_pnode_stack(&branch_nodes, &num_branch_nodes);
+        push_pnode_stack(builder, &branch_nodes, &num_branch_nodes);
         // we don't support | without surrounding ( )
         break;
       case ')':  // end grouping
-        last_pnodes = pop_pnode_stack(&branch_nodes, &num_branch_nodes);
+        last_pnodes = pop_pnode_stack(builder, &branch_nodes, &num_branch_nodes);
         if (!last_pnodes) {
           fprintf(stderr, "grouping inconsistency detected at )\n");
-          return -1;
+          goto error;
         }
         if (is_optional) {
           // add popped pnodes to branch_nodes
@@ -471,7 +727,7 @@ int8_t tinreg_add_pattern(char *pat, uint8_t pat_len, char result) {
         FREE(last_pnodes->nodes);
         FREE(last_pnodes);
 #if USE_GRAPH
-        can_merge_next = 1;
+        builder->can_merge_next = 1;
 #endif
 
         // end branch here
@@ -479,28 +735,187 @@ int8_t tinreg_add_pattern(char *pat, uint8_t pat_len, char result) {
         break;
       case '|':  // OR
         // create a branch starting from last '('
-        save_group(&branch_nodes, &num_branch_nodes);
-        set_head_to_last_trunk(&branch_nodes, &num_branch_nodes);
+        save_group(builder, &branch_nodes, &num_branch_nodes);
+        set_head_to_last_trunk(builder, &branch_nodes, &num_branch_nodes);
         break;
       default:
-        fprintf(stderr, "error: invalid char '%c' (only numbers allowed) in pattern: %s", c, pat);
-        return -1;
+        fprintf(stderr, "error: invalid char '%c' (only digits, x, [], (), | and ? allowed) in pattern: %.*s\n", c, (int)pat_len, pat);
+        goto error;
     }
   }
   // add result character
+  remove_duplicate_heads(branch_nodes, &num_branch_nodes);
   add_results(branch_nodes, num_branch_nodes, result);
 
   FREE(branch_nodes);
+  discard_stacks(builder);
+
+  return 0;
+
+error:
+  FREE(branch_nodes);
+  discard_stacks(builder);
+  return -1;
+}
 
+// Append len bytes to the buffer, growing it as needed
+static int append_chars(char **buf, unsigned int *len, unsigned int *capacity,
+    const char *chars, unsigned int num_chars) {
+  if (*len + num_chars > *capacity) {
+    while (*len + num_chars > *capacity) {
+      *capacity *= 2;
+    }
+    REALLOC(*buf, *capacity);
+    if (!*buf) {
+      fprintf(stderr, "realloc failed for expanded pattern\n");
+      return -1;
+    }
+  }
+  MEMCPY(*buf + *len, chars, num_chars);
+  *len += num_chars;
   return 0;
 }
 
+// Find the start of the digit, class or group that ends at buf[len-1]
+// Return -1 if there is none
+static int find_atom(const char *buf, unsigned int len) {
+  int i = len - 1;
+  int depth = 0;
+  if (len == 0) {
+    return -1;
+  }
+  if (buf[i] == ']') {
+    while (i >= 0 && buf[i] != '[') {
+      i--;
+    }
+    return i;
+  }
+  if (buf[i] == ')') {
+    for (; i >= 0; i--) {
+      if (buf[i] == ')') {
+        depth++;
+      } else if (buf[i] == '(' && --depth == 0) {
+        return i;
+      }
+    }
+    return -1;
+  }
+  if ((buf[i] >= '0' && buf[i] <= '9') || buf[i] == 'x' || buf[i] == 'X') {
+    return i;
+  }
+  return -1;
+}
+
+// Rewrite each {m} or {m,n} as m copies of the preceding digit, class or
+// group followed by n-m optional copies
+// Return the new pattern, to be freed by the caller, or NULL if error
+static char *expand_repeats(const char *pat, unsigned int pat_len, unsigned int *out_len) {
+  unsigned int capacity = pat_len * 2;
+  unsigned int len = 0;
+  unsigned int i = 0;
+  char *buf = MALLOC(capacity);
+  if (!buf) {
+    fprintf(stderr, "malloc error for expanded pattern\n");
+    return NULL;
+  }
+  while (i < pat_len) {
+    unsigned int min = 0;
+    unsigned int max;
+    unsigned int j;
+    int atom_start;
+    if (pat[i] != '{') {
+      if (append_chars(&buf, &len, &capacity, pat + i, 1) != 0) {
+        return NULL;
+      }
+      i++;
+      continue;
+    }
+    // parse {m} or {m,n}
+    for (i++; i < pat_len && pat[i] >= '0' && pat[i] <= '9'; i++) {
+      // stop growing past the limit, which is reported below
+      min = min > MAX_REPEAT ? min : min * 10 + (pat[i] - '0');
+    }
+    max = min;
+    if (i < pat_len && pat[i] == ',') {
+      max = 0;
+      for (i++; i < pat_len && pat[i] >= '0' && pat[i] <= '9'; i++) {
+        max = max > MAX_REPEAT ? max : max * 10 + (pat[i] - '0');
+      }
+    }
+    if (i == pat_len || pat[i] != '}' || pat[i-1] == '{' || pat[i-1] == ',') {
+      fprintf(stderr, "error: invalid repetition (use {m} or {m,n}) in pattern: %.*s\n",
+          (int)pat_len, pat);
+      FREE(buf);
+      return NULL;
+    }
+    i++;
+    if (max > MAX_REPEAT || max < min) {
+      fprintf(stderr, "error: invalid repetition count (must be 0 <= m <= n <= %d) "
+          "in pattern: %.*s\n", MAX_REPEAT, (int)pat_len, pat);
+      FREE(buf);
+      return NULL;
+    }
+    atom_start = find_atom(buf, len);
+    if (atom_start < 0) {
+      fprintf(stderr, "error: nothing to repeat before { in pattern: %.*s\n",
+          (int)pat_len, pat);
+      FREE(buf);
+      return NULL;
+    }
+
+    // the atom is copied from the end of buf, which moves on realloc
+    unsigned int atom_len = len - atom_start;
+    char *atom = MALLOC(atom_len + 1);
+    if (!atom) {
+      fprintf(stderr, "malloc error for repeated atom\n");
+      FREE(buf);
+      return NULL;
+    }
+    MEMCPY(atom, buf + atom_start, atom_len);
+    atom[atom_len] = '?';
+    len = atom_start;
+    for (j = 0; j < max; j++) {
+      if (append_chars(&buf, &len, &capacity, atom, j < min ? atom_len : atom_len + 1) != 0) {
+        FREE(atom);
+        return NULL;
+      }
+    }
+    FREE(atom);
+  }
+  *out_len = len;
+  return buf;
+}
+
+int8_t tinreg_builder_add_pattern(tinreg_builder_t *builder, const char *pat,
+    unsigned int pat_len, char result) {
+  unsigned int expanded_len;
+  char *expanded;
+  int8_t status;
+  if (!memchr(pat, '{', pat_len)) {
+    return add_pattern(builder, pat, pat_len, result);
+  }
+  expanded = expand_repeats(pat, pat_len, &expanded_len);
+  if (!expanded) {
+    return -1;
+  }
+  status = add_pattern(builder, expanded, expanded_len, result);
+  FREE(expanded);
+  return status;
+}
+
+// Add the new pattern and the result character
+int8_t tinreg_add_pattern(const char *pat, unsigned int pat_len, char result) {
+  return tinreg_builder_add_pattern(&default_builder, pat, pat_len, result);
+}
+
 static void free_node(pnode *node) {
-  uint8_t i;
-  for (i = 0; i < node->num_next_nodes; i++) {
+  unsigned int i;
+  // free_node() unlinks each child from node, so take the count first
+  unsigned int num_next_nodes = node->num_next_nodes;
+  for (i = 0; i < num_next_nodes; i++) {
     free_node(node->next_nodes[i]);
   }
-  if (node->num_next_nodes > 0) {
+  if (num_next_nodes > 0) {
     FREE(node->next_nodes);
   }
 
@@ -517,85 +932,130 @@ static void free_node(pnode *node) {
   FREE(node);
 }
 
-// Clear all patterns
-void tinreg_clear_patterns() {
-  uint8_t i;
-  for (i = 0; i < root_node.num_next_nodes; i++) {
-    free_node(root_node.next_nodes[i]);
+tinreg_builder_t *tinreg_builder_new() {
+  tinreg_builder_t *builder;
+  CALLOC(builder, sizeof(tinreg_builder_t));
+  if (!builder) {
+    fprintf(stderr, "malloc error for tinreg_builder_t\n");
   }
-  FREE(root_node.next_nodes);
-  root_node.node_char = 0;
-  root_node.result = '\0';
-  root_node.next_nodes = NULL;
-  root_node.num_next_nodes = 0;
+  return builder;
+}
 
-  if (pnode_stack_len > 0) {
+void tinreg_builder_clear(tinreg_builder_t *builder) {
+  unsigned int i;
+  pnode *root_node = &builder->root_node;
+  unsigned int num_next_nodes = root_node->num_next_nodes;
+  for (i = 0; i < num_next_nodes; i++) {
+    free_node(root_node->next_nodes[i]);
+  }
+  FREE(root_node->next_nodes);
+  root_node->node_char = 0;
+  root_node->result = '\0';
+  root_node->hits = 0;
+  root_node->next_nodes = NULL;
+  root_node->num_next_nodes = 0;
+  builder->lookup_head = NULL;
+
+  if (builder->pnode_stack_len > 0) {
     fprintf(stderr, "warning: pnode_stack is not empty\n");
   }
-  for (i = 0; i < pnode_stack_len; i++) {
-    FREE(pnode_stack[i]->nodes);
-    FREE(pnode_stack[i]);
+  for (i = 0; i < builder->pnode_stack_len; i++) {
+    FREE(builder->pnode_stack[i]->nodes);
+    FREE(builder->pnode_stack[i]);
   }
-  FREE(pnode_stack);
-  pnode_stack = NULL;
-  pnode_stack_len = 0;
+  FREE(builder->pnode_stack);
+  builder->pnode_stack = NULL;
+  builder->pnode_stack_len = 0;
 
-  if (pnode_group_stack_len > 0) {
+  if (builder->pnode_group_stack_len > 0) {
     fprintf(stderr, "warning: pnode_group_stack is not empty\n");
   }
-  for (i = 0; i < pnode_group_stack_len; i++) {
-    FREE(pnode_group_stack[i]->nodes);
-    FREE(pnode_group_stack[i]);
+  for (i = 0; i < builder->pnode_group_stack_len; i++) {
+    FREE(builder->pnode_group_stack[i]->nodes);
+    FREE(builder->pnode_group_stack[i]);
   }
-  FREE(pnode_group_stack);
-  pnode_group_stack = NULL;
-  pnode_group_stack_len = 0;
+  FREE(builder->pnode_group_stack);
+  builder->pnode_group_stack = NULL;
+  builder->pnode_group_stack_len = 0;
+}
+
+void tinreg_builder_free(tinreg_builder_t *builder) {
+  if (builder) {
+    tinreg_builder_clear(builder);
+    FREE(builder);
+  }
+}
+
+// Clear all patterns
+void tinreg_clear_patterns() {
+  tinreg_builder_clear(&default_builder);
+}
+
+void tinreg_builder_display_trie(tinreg_builder_t *builder) {
+  unsigned int num_nodes = display_node(&builder->root_node, 0);
+  printf("---\n");
+  printf("%u nodes in total\n", num_nodes);
 }
 
 // Display the whole trie (for the debugging purposes)
 void tinreg_display_trie() {
-  memory_usage = 0;
-  display_node(&root_node);
-  printf("---\n");
-  printf("%lu nodes in total\n", memory_usage / sizeof(pnode));
+  tinreg_builder_display_trie(&default_builder);
 }
 
-// Rewind the position of lookup head to start
-void tinreg_init_lookup() {
-  lookup_head = &root_node;
+static void builder_init_lookup(tinreg_builder_t *builder) {
+  builder->lookup_head = &builder->root_node;
 }
 
-// Forward the lookup head by one
-// Return 1 if the next node exists, 0 if the next node does not exist
-uint8_t tinreg_forward_lookup(char next_char) {
-  uint8_t i;
+static uint8_t builder_forward_lookup(tinreg_builder_t *builder, char next_char) {
+  pnode *lookup_head = builder->lookup_head;
+  unsigned int i;
   for (i = 0; i < lookup_head->num_next_nodes; i++) {
-    if (lookup_head->next_nodes[i]->node_char == next_char) {
-      lookup_head = lookup_head->next_nodes[i];
+    if (next_char >= '0' && next_char <= '9' &&
+        ((lookup_head->next_nodes[i]->digits >> (next_char - '0')) & 1)) {
+      builder->lookup_head = lookup_head->next_nodes[i];
       return 1;  // matched
     }
   }
   return 0;  // not matched
 }
 
-// Utility function that is meant to be used for debugging and testing purposes
-char tinreg_lookup_result(char *string) {
-  uint8_t i, len;
+static char builder_get_lookup_result(tinreg_builder_t *builder) {
+  return builder->lookup_head->result;
+}
+
+char tinreg_builder_lookup_result(tinreg_builder_t *builder, const char *string) {
+  size_t i, len;
 
-  tinreg_init_lookup();
+  builder_init_lookup(builder);
   len = strlen(string);
   for (i = 0; i < len; i++) {
-    if (tinreg_forward_lookup(string[i]) != 1) {
+    if (builder_forward_lookup(builder, string[i]) != 1) {
       // lookup failed
       return '\0';
     }
   }
-  return tinreg_get_lookup_result();
+  return builder_get_lookup_result(builder);
+}
+
+// Rewind the position of lookup head to start
+void tinreg_init_lookup() {
+  builder_init_lookup(&default_builder);
+}
+
+// Forward the lookup head by one
+// Return 1 if the next node exists, 0 if the next node does not exist
+uint8_t tinreg_forward_lookup(char next_char) {
+  return builder_forward_lookup(&default_builder, next_char);
+}
+
+// Utility function that is meant to be used for debugging and testing purposes
+char tinreg_lookup_result(char *string) {
+  return tinreg_builder_lookup_result(&default_builder, string);
 }
 
 // Return the result character
 char tinreg_get_lookup_result() {
-  return lookup_head->result;
+  return builder_get_lookup_result(&default_builder);
 }
 
 static unsigned int lookup_pos = 0;
@@ -685,61 +1145,181 @@ void parse_compact_string(unsigned char *compact_str, unsigned int len) {
   printf("\n");
 }
 
-unsigned int compact_node(pnode *node, uint8_t **str, unsigned int *str_offset, unsigned int *str_capacity) {
+#if BYTES_PER_NODE == 4
+#define MAX_DESCENDANTS  0xffff
+#else
+#define MAX_DESCENDANTS  0xfff
+#endif
+
+// Count the slots taken by node and its subtree in the packed format
+static unsigned int count_slots(pnode *node) {
+  unsigned int num_slots = node->node_char == 'x' ? 2 : 1;
+  unsigned int i;
+  for (i = 0; i < node->num_next_nodes; i++) {
+    num_slots += count_slots(node->next_nodes[i]);
+  }
+  return num_slots;
+}
+
+// Write node and its subtree at str + *str_offset, which has room for them
+static unsigned int compact_node(pnode *node, uint8_t *str, unsigned int *str_offset) {
   unsigned int this_str_offset = *str_offset;
-  int i;
+  unsigned int i;
   unsigned int num_descendants = 0;
-  for (i = 0; i < node->num_next_nodes; i++) {
+  uint8_t is_set = node->node_char == 'x';
+  if (is_set) {
+    // the slot holding the digits counts as a descendant
     *str_offset += BYTES_PER_NODE;
-    num_descendants += compact_node(node->next_nodes[i], str, str_offset, str_capacity);
+    num_descendants++;
   }
-  if (*str_offset + BYTES_PER_NODE > *str_capacity) {
-    *str = realloc(*str, *str_capacity * 2);
-    if (!str) {
-      fprintf(stderr, "realloc failed for str: capacity=%d\n", *str_capacity);
-      return 0;
-    }
-    *str_capacity *= 2;
+  for (i = 0; i < node->num_next_nodes; i++) {
+    *str_offset += BYTES_PER_NODE;
+    num_descendants += compact_node(node->next_nodes[i], str, str_offset);
   }
 
 #if BYTES_PER_NODE == 4
-  if (num_descendants > 0xffff) {
-    fprintf(stderr, "error: trie is too large (number of descendants: %d > %d)\n", num_descendants, 0xffff);
-    exit(EXIT_FAILURE);
-  }
-
-  (*str)[this_str_offset] = node->node_char;
-  (*str)[this_str_offset + 1] = num_descendants >> 8;
-  (*str)[this_str_offset + 2] = num_descendants & 0xff;
-  (*str)[this_str_offset + 3] = node->result;
+  str[this_str_offset] = node->node_char;
+  str[this_str_offset + 1] = num_descendants >> 8;
+  str[this_str_offset + 2] = num_descendants & 0xff;
+  str[this_str_offset + 3] = node->result;
 #else
-  if (num_descendants > 0xfff) {
-    fprintf(stderr, "error: trie is too large (number of descendants: %d > %d)\n", num_descendants, 0xfff);
-    exit(EXIT_FAILURE);
-  }
-
   uint8_t node_char;
   if (node->node_char == '\0') {
     node_char = 0;
+  } else if (is_set) {
+    node_char = PACKED_CHAR_SET;
   } else {
     node_char = node->node_char - '0';
   }
-  (*str)[this_str_offset] = ((node_char << 4) & 0xf0) | ((num_descendants >> 8) & 0xf);
-  (*str)[this_str_offset + 1] = num_descendants & 0xff;
-  (*str)[this_str_offset + 2] = node->result;
+  str[this_str_offset] = ((node_char << 4) & 0xf0) | ((num_descendants >> 8) & 0xf);
+  str[this_str_offset + 1] = num_descendants & 0xff;
+  str[this_str_offset + 2] = node->result;
 #endif
+  if (is_set) {
+    MEMSET(str + this_str_offset + BYTES_PER_NODE, 0, BYTES_PER_NODE);
+    str[this_str_offset + BYTES_PER_NODE] = node->digits >> 8;
+    str[this_str_offset + BYTES_PER_NODE + 1] = node->digits & 0xff;
+  }
 
   return num_descendants + 1;
 }
 
+int tinreg_builder_packed_size(tinreg_builder_t *builder) {
+  // no node has more descendants than the root
+  unsigned int num_slots = count_slots(&builder->root_node);
+  if (num_slots - 1 > MAX_DESCENDANTS) {
+    fprintf(stderr, "error: trie is too large (number of descendants: %u > %d)\n",
+        num_slots - 1, MAX_DESCENDANTS);
+    return -1;
+  }
+  return num_slots * BYTES_PER_NODE;
+}
+
+int tinreg_builder_pack(tinreg_builder_t *builder, uint8_t *buf, unsigned int buf_len) {
+  unsigned int str_offset = 0;
+  int packed_len = tinreg_builder_packed_size(builder);
+  if (packed_len < 0) {
+    return -1;
+  }
+  if ((unsigned int)packed_len > buf_len) {
+    fprintf(stderr, "error: buffer too small for the packed trie (%u < %d bytes)\n",
+        buf_len, packed_len);
+    return -1;
+  }
+  compact_node(&builder->root_node, buf, &str_offset);
+  return packed_len;
+}
+
 int tinreg_pack(uint8_t **packed_data) {
-  unsigned int str_capacity = 256;
-  *packed_data = malloc(str_capacity);
+  int packed_len = tinreg_builder_packed_size(&default_builder);
+  if (packed_len < 0) {
+    return -1;
+  }
+  *packed_data = malloc(packed_len);
   if (!*packed_data) {
     fprintf(stderr, "malloc error for packed_data\n");
     return -1;
   }
-  unsigned int str_offset = 0;
-  int total_nodes = compact_node(&root_node, packed_data, &str_offset, &str_capacity);
-  return total_nodes * BYTES_PER_NODE;
+  return tinreg_builder_pack(&default_builder, *packed_data, packed_len);
+}
+
+static unsigned int flatten_node(pnode *node, tinreg_flat_node **nodes,
+    unsigned int *num_nodes, unsigned int *capacity) {
+  unsigned int this_index = *num_nodes;
+  unsigned int num_descendants = 0;
+  unsigned int i;
+  if (*num_nodes == *capacity) {
+    *capacity *= 2;
+    *nodes = realloc(*nodes, sizeof(tinreg_flat_node) * *capacity);
+    if (!*nodes) {
+      fprintf(stderr, "flatten_node: realloc failed: capacity=%u\n", *capacity);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (node->node_char == 'x') {
+    (*nodes)[this_index].digit = TINREG_DIGIT_SET;
+  } else {
+    (*nodes)[this_index].digit = node->node_char == '\0' ? 0 : node->node_char - '0';
+  }
+  (*nodes)[this_index].digits = node->digits;
+  (*nodes)[this_index].result = node->result;
+  (*num_nodes)++;
+  for (i = 0; i < node->num_next_nodes; i++) {
+    num_descendants += flatten_node(node->next_nodes[i], nodes, num_nodes, capacity);
+  }
+  (*nodes)[this_index].num_descendants = num_descendants;
+  return num_descendants + 1;
+}
+
+int tinreg_flatten(tinreg_flat_node **nodes) {
+  unsigned int capacity = 256;
+  unsigned int num_nodes = 0;
+  *nodes = malloc(sizeof(tinreg_flat_node) * capacity);
+  if (!*nodes) {
+    fprintf(stderr, "malloc error for flat nodes\n");
+    return -1;
+  }
+  flatten_node(&default_builder.root_node, nodes, &num_nodes, &capacity);
+  return num_nodes;
+}
+
+int8_t tinreg_add_hits(const char *path, unsigned int path_len, unsigned long hits) {
+  pnode *node = &default_builder.root_node;
+  unsigned int i, j;
+  for (i = 0; i < path_len; i++) {
+    if (path[i] < '0' || path[i] > '9') {
+      return 0;
+    }
+    for (j = 0; j < node->num_next_nodes; j++) {
+      if ((node->next_nodes[j]->digits >> (path[i] - '0')) & 1) {
+        break;
+      }
+    }
+    if (j == node->num_next_nodes) {
+      return 0;
+    }
+    node = node->next_nodes[j];
+  }
+  node->hits += hits;
+  return 1;
+}
+
+// Children match disjoint digits, so any order gives the same lookups
+static void sort_node_by_hits(pnode *node) {
+  unsigned int i, j;
+  for (i = 1; i < node->num_next_nodes; i++) {
+    pnode *child = node->next_nodes[i];
+    // stable, so children without hits keep the order of the patterns
+    for (j = i; j > 0 && node->next_nodes[j - 1]->hits < child->hits; j--) {
+      node->next_nodes[j] = node->next_nodes[j - 1];
+    }
+    node->next_nodes[j] = child;
+  }
+  for (i = 0; i < node->num_next_nodes; i++) {
+    sort_node_by_hits(node->next_nodes[i]);
+  }
+}
+
+void tinreg_sort_by_hits() {
+  sort_node_by_hits(&default_builder.root_node);
 }
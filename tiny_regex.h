@@ -10,11 +10,50 @@
 #else
 typedef unsigned char uint8_t;
 typedef signed char int8_t;
+typedef unsigned short uint16_t;
 #endif
 
+// A trie being built. Each builder holds all of its own state, so several
+// tries can be built at the same time, one builder per thread.
+typedef struct tinreg_builder_t tinreg_builder_t;
+
+// Create an empty builder
+// Return NULL if error
+tinreg_builder_t *tinreg_builder_new();
+
+// Add the new pattern and the result character to the builder
+// Return 0 if success, -1 if error
+int8_t tinreg_builder_add_pattern(tinreg_builder_t *builder, const char *pat,
+    unsigned int pat_len, char result);
+
+// Get the number of bytes of the packed trie
+// Return -1 if the trie is too large for the packed format
+int tinreg_builder_packed_size(tinreg_builder_t *builder);
+
+// Write the packed trie into buf, ready for trie_set_data(), without
+// allocating memory
+// Return the number of bytes written, or -1 if error (including a buffer
+// shorter than tinreg_builder_packed_size())
+int tinreg_builder_pack(tinreg_builder_t *builder, uint8_t *buf, unsigned int buf_len);
+
+// Remove all patterns, keeping the builder for new ones
+void tinreg_builder_clear(tinreg_builder_t *builder);
+
+// Free the builder and its trie
+void tinreg_builder_free(tinreg_builder_t *builder);
+
+// Display the trie of the builder (for the debugging purposes)
+void tinreg_builder_display_trie(tinreg_builder_t *builder);
+
+// Look up a string in the trie of the builder
+// Return the result character, otherwise '\0'
+char tinreg_builder_lookup_result(tinreg_builder_t *builder, const char *string);
+
+// The functions below work on one builder shared by the whole process
+
 // Add the new pattern and the result character
 // Return 0 if success, -1 if error
-int8_t tinreg_add_pattern(char *pat, uint8_t pat_len, char result);
+int8_t tinreg_add_pattern(const char *pat, unsigned int pat_len, char result);
 
 // Clear all patterns
 void tinreg_clear_patterns();
@@ -34,6 +73,32 @@ char tinreg_get_lookup_result();
 
 char tinreg_lookup_result(char *string);
 
+// Pack the trie into newly allocated memory, to be freed by the caller
+// Return the number of bytes, or -1 if error
 int tinreg_pack(uint8_t **packed_data);
 
+// digit of a node that matches a set of digits
+#define TINREG_DIGIT_SET  0xf
+
+// A node of the flattened trie
+typedef struct tinreg_flat_node {
+  uint8_t digit;    // 0-9, or TINREG_DIGIT_SET (0 for the root)
+  uint16_t digits;  // digits matched by the node, bit n for digit n
+  char result;      // '\0' if no result
+  unsigned int num_descendants;
+} tinreg_flat_node;
+
+// Flatten the trie into an array of nodes in preorder (root first)
+// Return the number of nodes, or -1 if error
+int tinreg_flatten(tinreg_flat_node **nodes);
+
+// Add lookup hits to the node reached by the digits of path, as read from
+// a profile written by trie_telemetry_export()
+// Return 1 if the node exists, 0 if not
+int8_t tinreg_add_hits(const char *path, unsigned int path_len, unsigned long hits);
+
+// Put the children of each node in order of descending hits, so that the
+// most used child is found first (the lookup results do not change)
+void tinreg_sort_by_hits();
+
 #endif // TINY_REGEX_H
@@ -0,0 +1,402 @@
+// Measure the lookup rate of the packed and fixed-stride formats, of the
+// packed format behind a jump table of each depth, and behind a cache of
+// results (trie_cache.h)
+//
+// Keys are made by walking the trie from the root through random children,
+// so most of them have a result; one in ten is a random number instead.
+// With --hot=N, nine in ten keys are copies of the first N keys, as in
+// skewed traffic.
+// With --blocks=SIZE, the packed format is also compared with the same trie
+// compressed in blocks (block_trie.h): bytes kept in memory and the latency
+// of single lookups.
+// Every format looks up the same keys, and the results are compared.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "minimal_trie.h"
+#include "stride_trie.h"
+#include "tiny_regex.h"
+#include "trie_encode.h"
+#include "pattern_file.h"
+#include "jump_table.h"
+#include "trie_cache.h"
+#include "block_table.h"
+
+#define MAX_KEY_LEN  32
+#define MAX_TIMED_KEYS  100000
+
+static char (*keys)[MAX_KEY_LEN];
+static uint8_t *key_lens;
+static unsigned int num_keys = 1000000;
+static unsigned int num_hot_keys = 0;
+static unsigned int block_size = 0;
+static unsigned int num_cached_blocks = 8;
+
+void print_usage() {
+  printf("Usage: trie_bench [options] <pattern_file>\n");
+  printf("\n");
+  printf("Options:\n");
+  printf("  -n, --keys=N    number of keys (default: 1000000)\n");
+  printf("  -r, --rounds=N  lookups of every key per format (default: 5)\n");
+  printf("  -H, --hot=N     make 90%% of the keys copies of N hot keys (default: 0)\n");
+  printf("  -b, --blocks=SIZE  compare with the trie compressed in blocks of SIZE bytes\n");
+  printf("  -c, --block-cache=N  blocks kept decompressed (default: 8)\n");
+}
+
+static double now_sec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t stride_child(const trie_t *stride, uint32_t node, uint8_t digit) {
+  const uint8_t *p = stride->data + STRIDE_HEADER_SIZE + (node * STRIDE_FANOUT + digit) * 4;
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void make_keys(const trie_t *stride) {
+  unsigned int i;
+  for (i = 0; i < num_keys; i++) {
+    uint8_t len = 0;
+    if (rand() % 10 == 0) {
+      for (; len < 10; len++) {
+        keys[i][len] = '0' + rand() % 10;
+      }
+    } else {
+      uint32_t node = 0;
+      while (len < MAX_KEY_LEN) {
+        uint32_t children[STRIDE_FANOUT];
+        unsigned int num_children = 0;
+        uint8_t digit;
+        for (digit = 0; digit < STRIDE_FANOUT; digit++) {
+          if (stride_child(stride, node, digit)) {
+            children[num_children++] = digit;
+          }
+        }
+        if (num_children == 0 || (len > 0 && rand() % 8 == 0)) {
+          break;
+        }
+        digit = children[rand() % num_children];
+        keys[i][len++] = '0' + digit;
+        node = stride_child(stride, node, digit);
+      }
+    }
+    key_lens[i] = len;
+  }
+  for (i = num_hot_keys; num_hot_keys > 0 && i < num_keys; i++) {
+    if (rand() % 10 != 0) {
+      unsigned int hot = rand() % num_hot_keys;
+      memcpy(keys[i], keys[hot], MAX_KEY_LEN);
+      key_lens[i] = key_lens[hot];
+    }
+  }
+}
+
+static uint8_t packed_lookup(const trie_t *packed, const char *key, uint8_t len) {
+  trie_cursor_t cursor;
+  uint8_t i;
+  trie_cursor_start(&cursor, packed);
+  for (i = 0; i < len; i++) {
+    uint8_t digit = key[i] - '0';
+    if (digit > 9 || trie_cursor_forward(&cursor, digit) != 1) {
+      return '\0';
+    }
+  }
+  return trie_cursor_result(&cursor);
+}
+
+static uint8_t jump_lookup(const trie_jump_t *jump, const char *key, uint8_t len) {
+  trie_cursor_t cursor;
+  uint8_t digits[TRIE_JUMP_MAX_DEPTH];
+  uint8_t i = 0;
+  if (len >= jump->depth) {
+    for (; i < jump->depth; i++) {
+      digits[i] = key[i] - '0';
+    }
+    if (trie_cursor_jump(&cursor, jump, digits) != 1) {
+      return '\0';
+    }
+  } else {
+    trie_cursor_start(&cursor, &jump->trie);
+  }
+  for (; i < len; i++) {
+    uint8_t digit = key[i] - '0';
+    if (digit > 9 || trie_cursor_forward(&cursor, digit) != 1) {
+      return '\0';
+    }
+  }
+  return trie_cursor_result(&cursor);
+}
+
+static uint8_t cached_lookup(const trie_t *packed, const char *key, uint8_t len) {
+  uint8_t digits[MAX_KEY_LEN];
+  uint8_t i;
+  for (i = 0; i < len; i++) {
+    digits[i] = key[i] - '0';
+    if (digits[i] > 9) {
+      return '\0';
+    }
+  }
+  return trie_cache_lookup(packed, digits, len);
+}
+
+static uint8_t block_lookup(block_trie_t *bt, const char *key, uint8_t len) {
+  uint8_t digits[MAX_KEY_LEN];
+  uint8_t i;
+  for (i = 0; i < len; i++) {
+    digits[i] = key[i] - '0';
+    if (digits[i] > 9) {
+      return '\0';
+    }
+  }
+  return block_trie_lookup(bt, digits, len);
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+// Print the median and the 99th percentile of the latencies, which are sorted
+static void report_latency(const char *name, double *latencies, unsigned int count,
+    unsigned int resident_size) {
+  qsort(latencies, count, sizeof(double), compare_double);
+  printf("%-14s p50 %6.0f ns  p99 %6.0f ns  (%u bytes in memory)\n", name,
+      latencies[count / 2] * 1e9, latencies[count * 99 / 100] * 1e9, resident_size);
+}
+
+// Time each lookup of the packed and block formats on its own
+// Return 0 if success, -1 if error
+static int compare_blocks(const trie_t *packed, const uint8_t *expected) {
+  unsigned int count = num_keys < MAX_TIMED_KEYS ? num_keys : MAX_TIMED_KEYS;
+  double *latencies = malloc(sizeof(double) * count);
+  block_trie_t bt;
+  uint8_t *data;
+  unsigned int i;
+  int status = -1;
+  int data_len = block_table_build(packed->data, packed->len, block_size, &data);
+  if (data_len < 0 || !latencies) {
+    free(latencies);
+    return -1;
+  }
+  if (block_trie_open(&bt, data, data_len, num_cached_blocks) != 0) {
+    goto done;
+  }
+  for (i = 0; i < count; i++) {
+    double start = now_sec();
+    uint8_t result = packed_lookup(packed, keys[i], key_lens[i]);
+    latencies[i] = now_sec() - start;
+    if (result != expected[i]) {
+      fprintf(stderr, "packed results differ\n");
+      goto done;
+    }
+  }
+  report_latency("packed", latencies, count, packed->len);
+  for (i = 0; i < count; i++) {
+    double start = now_sec();
+    uint8_t result = block_lookup(&bt, keys[i], key_lens[i]);
+    latencies[i] = now_sec() - start;
+    if (result != expected[i]) {
+      fprintf(stderr, "block results differ\n");
+      goto done;
+    }
+  }
+  report_latency("blocks", latencies, count, block_trie_resident_size(&bt));
+  printf("%-14s %u blocks of up to %u bytes, %lu decompressed in %u lookups\n", "",
+      bt.num_blocks, bt.max_block_len, bt.misses, count);
+  status = 0;
+
+done:
+  block_trie_close(&bt);
+  free(data);
+  free(latencies);
+  return status;
+}
+
+static void report(const char *name, double elapsed, unsigned int rounds) {
+  printf("%-14s %6.1f M keys/s\n", name, (double)num_keys * rounds / elapsed / 1e6);
+}
+
+int main(int argc, char **argv) {
+  unsigned int rounds = 5;
+  tinreg_flat_node *nodes;
+  trie_t packed = { 0, 0 };
+  trie_t stride;
+  uint8_t *expected;
+  uint8_t *results;
+  unsigned int round;
+  unsigned int i;
+  double start;
+
+  static struct option long_options[] = {
+    { "keys", required_argument, NULL, 'n' },
+    { "rounds", required_argument, NULL, 'r' },
+    { "hot", required_argument, NULL, 'H' },
+    { "blocks", required_argument, NULL, 'b' },
+    { "block-cache", required_argument, NULL, 'c' },
+    { 0, 0, 0, 0 },
+  };
+  int option_index = 0;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "n:r:H:b:c:", long_options, &option_index)) != -1) {
+    switch (opt) {
+      case 'n':
+        num_keys = strtoul(optarg, NULL, 10);
+        break;
+      case 'r':
+        rounds = strtoul(optarg, NULL, 10);
+        break;
+      case 'H':
+        num_hot_keys = strtoul(optarg, NULL, 10);
+        break;
+      case 'b':
+        block_size = strtoul(optarg, NULL, 10);
+        break;
+      case 'c':
+        num_cached_blocks = strtoul(optarg, NULL, 10);
+        break;
+      default:
+        print_usage();
+        return EXIT_FAILURE;
+    }
+  }
+  if (argc < optind + 1 || num_keys == 0 || rounds == 0) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+
+  if (pattern_file_read(argv[optind], NULL, NULL) != 0) {
+    return EXIT_FAILURE;
+  }
+  int num_nodes = tinreg_flatten(&nodes);
+  if (num_nodes < 0) {
+    return EXIT_FAILURE;
+  }
+  uint8_t *data;
+  int stride_len = trie_encode_stride(nodes, num_nodes, &data);
+  if (stride_len < 0) {
+    return EXIT_FAILURE;
+  }
+  stride.data = data;
+  stride.len = stride_len;
+  // the packed format is limited to 4096 nodes, including a slot for each set
+  // of digits; skip it for larger tries
+  unsigned int num_slots = num_nodes;
+  for (i = 0; i < (unsigned int)num_nodes; i++) {
+    if (nodes[i].digit == TINREG_DIGIT_SET) {
+      num_slots++;
+    }
+  }
+  if (num_slots <= 0xfff + 1) {
+    int packed_len = tinreg_pack(&data);
+    if (packed_len < 0) {
+      return EXIT_FAILURE;
+    }
+    packed.data = data;
+    packed.len = packed_len;
+  }
+  free(nodes);
+
+  keys = malloc(sizeof(*keys) * num_keys);
+  key_lens = malloc(num_keys);
+  expected = malloc(num_keys);
+  results = malloc(num_keys);
+  if (!keys || !key_lens || !expected || !results) {
+    fprintf(stderr, "malloc failed for keys\n");
+    return EXIT_FAILURE;
+  }
+  srand(1);
+  make_keys(&stride);
+  stride_lookup_batch_scalar(&stride, keys[0], MAX_KEY_LEN, key_lens, num_keys, expected);
+
+  printf("nodes: %d, stride data: %u bytes, keys: %u\n", num_nodes, stride.len, num_keys);
+
+  if (packed.data) {
+    start = now_sec();
+    for (round = 0; round < rounds; round++) {
+      for (i = 0; i < num_keys; i++) {
+        results[i] = packed_lookup(&packed, keys[i], key_lens[i]);
+      }
+    }
+    report("packed", now_sec() - start, rounds);
+    if (memcmp(results, expected, num_keys) != 0) {
+      fprintf(stderr, "packed results differ\n");
+      return EXIT_FAILURE;
+    }
+
+    trie_cache_stats_t stats;
+    memset(results, 0, num_keys);
+    start = now_sec();
+    for (round = 0; round < rounds; round++) {
+      for (i = 0; i < num_keys; i++) {
+        results[i] = cached_lookup(&packed, keys[i], key_lens[i]);
+      }
+    }
+    trie_cache_get_stats(&stats);
+    printf("%-14s %6.1f M keys/s  (%.1f%% hits in %u bytes)\n", "packed cached",
+        (double)num_keys * rounds / (now_sec() - start) / 1e6,
+        stats.lookups ? stats.hits * 100.0 / stats.lookups : 0.0,
+        (unsigned int)(trie_cache_sets * TRIE_CACHE_ALIGN));
+    if (memcmp(results, expected, num_keys) != 0) {
+      fprintf(stderr, "cached results differ\n");
+      return EXIT_FAILURE;
+    }
+
+    int depth;
+    for (depth = 1; depth <= TRIE_JUMP_MAX_DEPTH; depth++) {
+      char name[32];
+      int jump_len = jump_table_build(packed.data, packed.len, depth, &data);
+      if (jump_len < 0) {
+        return EXIT_FAILURE;
+      }
+      trie_jump_t jump = trie_jump_open(data, jump_len);
+      memset(results, 0, num_keys);
+      start = now_sec();
+      for (round = 0; round < rounds; round++) {
+        for (i = 0; i < num_keys; i++) {
+          results[i] = jump_lookup(&jump, keys[i], key_lens[i]);
+        }
+      }
+      snprintf(name, sizeof(name), "jump %d", depth);
+      printf("%-14s %6.1f M keys/s  (+%u bytes)\n", name,
+          (double)num_keys * rounds / (now_sec() - start) / 1e6, jump_table_size(depth));
+      free(data);
+      if (memcmp(results, expected, num_keys) != 0) {
+        fprintf(stderr, "jump %d results differ\n", depth);
+        return EXIT_FAILURE;
+      }
+    }
+
+    if (block_size > 0 && compare_blocks(&packed, expected) != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  start = now_sec();
+  for (round = 0; round < rounds; round++) {
+    stride_lookup_batch_scalar(&stride, keys[0], MAX_KEY_LEN, key_lens, num_keys, results);
+  }
+  report("stride scalar", now_sec() - start, rounds);
+
+  if (stride_has_simd()) {
+    memset(results, 0, num_keys);
+    start = now_sec();
+    for (round = 0; round < rounds; round++) {
+      stride_lookup_batch(&stride, keys[0], MAX_KEY_LEN, key_lens, num_keys, results);
+    }
+    report("stride simd", now_sec() - start, rounds);
+    if (memcmp(results, expected, num_keys) != 0) {
+      fprintf(stderr, "simd results differ\n");
+      return EXIT_FAILURE;
+    }
+  } else {
+    printf("stride simd    not supported by this CPU\n");
+  }
+
+  return EXIT_SUCCESS;
+}
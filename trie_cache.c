@@ -0,0 +1,156 @@
+// Cache of the results of whole numbers in front of trie_lookup()
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "trie_cache.h"
+
+// One cache line: a key is the length in the low 4 bits and a digit in each
+// 4 bits above it, so 0 is never a key and marks an empty entry
+typedef struct cache_set {
+  uint64_t keys[TRIE_CACHE_WAYS];
+  uint8_t results[TRIE_CACHE_WAYS];
+  uint8_t referenced;  // bit n is set when way n is hit
+  uint8_t hand;        // next way to consider for replacement
+} __attribute__((aligned(TRIE_CACHE_ALIGN))) cache_set;
+
+typedef struct local_cache {
+  trie_cache_stats_t stats;
+  cache_set *sets;
+  unsigned int num_sets;
+  trie_t trie;              // the trie whose results are cached
+  unsigned int generation;  // trie_data_generation() when they were cached
+  struct local_cache *next;
+} local_cache;
+
+unsigned int trie_cache_sets = TRIE_CACHE_SETS;
+
+static __thread local_cache *local;
+
+// Caches of all threads, pushed without a lock and never removed
+static local_cache *registry;
+
+// Only the owner thread writes the counters
+#define STATS_ADD(cache, field, n)  \
+  __atomic_store_n(&(cache)->stats.field, \
+      __atomic_load_n(&(cache)->stats.field, __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+
+void trie_cache_set_size(unsigned int sets) {
+  unsigned int num_sets = 1;
+  if (sets > TRIE_CACHE_MAX_SETS) {
+    sets = TRIE_CACHE_MAX_SETS;
+  }
+  while (num_sets < sets) {
+    num_sets <<= 1;
+  }
+  __atomic_store_n(&trie_cache_sets, num_sets, __ATOMIC_RELAXED);
+}
+
+static local_cache *register_cache() {
+  local_cache *cache = calloc(1, sizeof(local_cache));
+  if (!cache) {
+    return NULL;
+  }
+  cache->next = __atomic_load_n(&registry, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&registry, &cache->next, cache, 1,
+        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+  }
+  local = cache;
+  return cache;
+}
+
+// Drop all entries, and make the sets match trie_cache_sets
+// Return 0 if success, -1 if the sets cannot be allocated
+static int flush(local_cache *cache) {
+  unsigned int num_sets = __atomic_load_n(&trie_cache_sets, __ATOMIC_RELAXED);
+  if (cache->num_sets != num_sets) {
+    free(cache->sets);
+    cache->sets = aligned_alloc(TRIE_CACHE_ALIGN, sizeof(cache_set) * num_sets);
+    if (!cache->sets) {
+      cache->num_sets = 0;
+      return -1;
+    }
+    cache->num_sets = num_sets;
+  }
+  memset(cache->sets, 0, sizeof(cache_set) * num_sets);
+  STATS_ADD(cache, flushes, 1);
+  return 0;
+}
+
+uint8_t trie_cache_lookup(const trie_t *trie, const uint8_t *digits, unsigned int len) {
+  local_cache *cache = local;
+  unsigned int generation = trie_data_generation();
+  uint64_t key = len;
+  cache_set *set;
+  uint8_t result;
+  unsigned int i;
+  if (!cache && (cache = register_cache()) == NULL) {
+    return trie_lookup(trie, digits, len);
+  }
+  STATS_ADD(cache, lookups, 1);
+  if (len == 0 || len > TRIE_CACHE_MAX_DIGITS) {
+    STATS_ADD(cache, bypassed, 1);
+    return trie_lookup(trie, digits, len);
+  }
+  for (i = 0; i < len; i++) {
+    if (digits[i] > 0xf) {
+      STATS_ADD(cache, bypassed, 1);
+      return trie_lookup(trie, digits, len);
+    }
+    key |= (uint64_t)digits[i] << (4 + i * 4);
+  }
+
+  if (cache->trie.data != trie->data || cache->trie.len != trie->len ||
+      cache->generation != generation ||
+      cache->num_sets != __atomic_load_n(&trie_cache_sets, __ATOMIC_RELAXED)) {
+    if (flush(cache) != 0) {
+      return trie_lookup(trie, digits, len);
+    }
+    cache->trie = *trie;
+    cache->generation = generation;
+  }
+
+  set = &cache->sets[(key * 0x9e3779b97f4a7c15ULL) >> 32 & (cache->num_sets - 1)];
+  for (i = 0; i < TRIE_CACHE_WAYS; i++) {
+    if (set->keys[i] == key) {
+      set->referenced |= 1 << i;
+      STATS_ADD(cache, hits, 1);
+      return set->results[i];
+    }
+  }
+
+  result = trie_lookup(trie, digits, len);
+  // replace the first way from the hand that has not been hit since the hand
+  // last passed it
+  while (set->referenced & (1 << set->hand)) {
+    set->referenced &= ~(1 << set->hand);
+    set->hand = (set->hand + 1) % TRIE_CACHE_WAYS;
+  }
+  set->keys[set->hand] = key;
+  set->results[set->hand] = result;
+  set->hand = (set->hand + 1) % TRIE_CACHE_WAYS;
+  return result;
+}
+
+#define LOAD(field)  __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+void trie_cache_get_stats(trie_cache_stats_t *stats) {
+  local_cache *cache;
+  memset(stats, 0, sizeof(trie_cache_stats_t));
+  for (cache = __atomic_load_n(&registry, __ATOMIC_ACQUIRE); cache; cache = cache->next) {
+    stats->lookups += LOAD(cache->stats.lookups);
+    stats->hits += LOAD(cache->stats.hits);
+    stats->bypassed += LOAD(cache->stats.bypassed);
+    stats->flushes += LOAD(cache->stats.flushes);
+  }
+}
+
+void trie_cache_reset_stats() {
+  local_cache *cache;
+  for (cache = __atomic_load_n(&registry, __ATOMIC_ACQUIRE); cache; cache = cache->next) {
+    __atomic_store_n(&cache->stats.lookups, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&cache->stats.hits, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&cache->stats.bypassed, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&cache->stats.flushes, 0, __ATOMIC_RELAXED);
+  }
+}
@@ -0,0 +1,52 @@
+// Cache of the results of whole numbers in front of trie_lookup()
+//
+// Each thread has its own set-associative cache, allocated on its first
+// lookup, so lookups take no lock. A set is one cache line of
+// TRIE_CACHE_WAYS entries, replaced in clock order, so numbers that are
+// looked up again and again stay while the others pass through.
+//
+// A thread's cache holds the results of one trie. It is emptied when a lookup
+// is given other trie data, or when trie_data_generation() has changed since
+// the last lookup, so call trie_data_changed() after reloading a trie at the
+// same address. Numbers longer than TRIE_CACHE_MAX_DIGITS are looked up in
+// the trie every time.
+
+#ifndef TRIE_CACHE_H
+#define TRIE_CACHE_H
+
+#include "minimal_trie.h"
+
+#define TRIE_CACHE_WAYS  4
+#define TRIE_CACHE_MAX_DIGITS  15
+#define TRIE_CACHE_ALIGN  64
+// Default of trie_cache_sets
+#define TRIE_CACHE_SETS  256
+// Largest trie_cache_sets, 1 GB of sets per thread
+#define TRIE_CACHE_MAX_SETS  0x1000000
+
+typedef struct trie_cache_stats_t {
+  uint64_t lookups;   // trie_cache_lookup() calls
+  uint64_t hits;      // lookups answered from the cache
+  uint64_t bypassed;  // lookups of numbers that cannot be cached
+  uint64_t flushes;   // times a cache was emptied for other trie data
+} trie_cache_stats_t;
+
+// Number of sets of each thread's cache, a power of two
+extern unsigned int trie_cache_sets;
+
+// Set trie_cache_sets, rounded up to a power of two and limited to
+// TRIE_CACHE_MAX_SETS, which each thread uses from its next lookup; the
+// entries it has cached so far are dropped
+void trie_cache_set_size(unsigned int sets);
+
+// Look up the whole number digits[0..len) like trie_lookup(), using the
+// cache of the calling thread
+uint8_t trie_cache_lookup(const trie_t *trie, const uint8_t *digits, unsigned int len);
+
+// Store the sum of the counters of all threads in stats
+void trie_cache_get_stats(trie_cache_stats_t *stats);
+
+// Set the counters of all threads to zero
+void trie_cache_reset_stats();
+
+#endif // TRIE_CACHE_H
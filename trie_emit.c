@@ -0,0 +1,172 @@
+// Write trie data as assembler source or as a relocatable object file
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "trie_emit.h"
+
+#if defined(__x86_64__)
+#define ELF_MACHINE  62  // EM_X86_64
+#elif defined(__aarch64__)
+#define ELF_MACHINE  183  // EM_AARCH64
+#endif
+
+#define ELF_HEADER_SIZE  64
+#define ELF_SECTION_HEADER_SIZE  64
+#define ELF_SYMBOL_SIZE  24
+
+// Sections of the object, in order
+enum {
+  SECTION_NULL,
+  SECTION_RODATA,
+  SECTION_SYMTAB,
+  SECTION_STRTAB,
+  SECTION_SHSTRTAB,
+  SECTION_NOTE_STACK,
+  NUM_SECTIONS,
+};
+
+static const char section_names[] = "\0.rodata\0.symtab\0.strtab\0.shstrtab\0.note.GNU-stack";
+static const unsigned int section_name_offsets[NUM_SECTIONS] = { 0, 1, 9, 17, 25, 35 };
+
+static unsigned int align(unsigned int n, unsigned int alignment) {
+  return (n + alignment - 1) & ~(alignment - 1);
+}
+
+void trie_emit_asm(FILE *out, const char *name, const uint8_t *data, unsigned int len) {
+  unsigned int i;
+  fprintf(out, "\t.section .rodata\n");
+  fprintf(out, "\t.balign %d\n", TRIE_EMIT_ALIGN);
+  fprintf(out, "\t.globl %s\n", name);
+  fprintf(out, "\t.type %s, @object\n", name);
+  fprintf(out, "\t.size %s, %u\n", name, len);
+  fprintf(out, "%s:\n", name);
+  for (i = 0; i < len; i++) {
+    if (i % 16 == 0) {
+      fprintf(out, "\t.byte 0x%02x", data[i]);
+    } else {
+      fprintf(out, ",0x%02x", data[i]);
+    }
+    if (i % 16 == 15 || i == len - 1) {
+      fprintf(out, "\n");
+    }
+  }
+  fprintf(out, "\t.balign 4\n");
+  fprintf(out, "\t.globl %s_len\n", name);
+  fprintf(out, "\t.type %s_len, @object\n", name);
+  fprintf(out, "\t.size %s_len, 4\n", name);
+  fprintf(out, "%s_len:\n", name);
+  fprintf(out, "\t.long %u\n", len);
+  fprintf(out, "\t.section .note.GNU-stack,\"\",@progbits\n");
+}
+
+static void store_u16(uint8_t *p, uint16_t value) {
+  p[0] = value & 0xff;
+  p[1] = value >> 8;
+}
+
+static void store_u32(uint8_t *p, uint32_t value) {
+  store_u16(p, value & 0xffff);
+  store_u16(p + 2, value >> 16);
+}
+
+static void store_u64(uint8_t *p, uint64_t value) {
+  store_u32(p, value & 0xffffffff);
+  store_u32(p + 4, value >> 32);
+}
+
+static void store_section_header(uint8_t *p, unsigned int section, uint32_t type, uint64_t flags,
+    uint64_t offset, uint64_t size, uint32_t link, uint32_t info, uint64_t alignment,
+    uint64_t entry_size) {
+  store_u32(p, section_name_offsets[section]);
+  store_u32(p + 4, type);
+  store_u64(p + 8, flags);
+  store_u64(p + 16, 0);  // address
+  store_u64(p + 24, offset);
+  store_u64(p + 32, size);
+  store_u32(p + 40, link);
+  store_u32(p + 44, info);
+  store_u64(p + 48, alignment);
+  store_u64(p + 56, entry_size);
+}
+
+static void store_symbol(uint8_t *p, uint32_t name, uint64_t value, uint64_t size) {
+  store_u32(p, name);
+  p[4] = 0x11;  // STB_GLOBAL, STT_OBJECT
+  p[5] = 0;     // STV_DEFAULT
+  store_u16(p + 6, SECTION_RODATA);
+  store_u64(p + 8, value);
+  store_u64(p + 16, size);
+}
+
+// The object has one .rodata section holding the data, padded to 4 bytes,
+// and the length, and a symbol for each of them. Nothing needs relocation.
+int trie_emit_object(FILE *out, const char *name, const uint8_t *data, unsigned int len) {
+#if defined(ELF_MACHINE)
+  unsigned int name_len = strlen(name);
+  unsigned int len_offset = align(len, 4);
+  unsigned int rodata_offset = align(ELF_HEADER_SIZE, TRIE_EMIT_ALIGN);
+  unsigned int strtab_offset = rodata_offset + len_offset + 4;
+  // "\0<name>\0<name>_len\0"
+  unsigned int strtab_size = 1 + name_len + 1 + name_len + 5;
+  unsigned int shstrtab_offset = strtab_offset + strtab_size;
+  unsigned int symtab_offset = align(shstrtab_offset + sizeof(section_names), 8);
+  unsigned int section_header_offset = symtab_offset + ELF_SYMBOL_SIZE * 3;
+  unsigned int object_len = section_header_offset + ELF_SECTION_HEADER_SIZE * NUM_SECTIONS;
+  uint8_t *object = calloc(object_len, 1);
+  uint8_t *p;
+  if (!object) {
+    fprintf(stderr, "malloc error for object file\n");
+    return -1;
+  }
+
+  // ELF header
+  memcpy(object, "\x7f" "ELF", 4);
+  object[4] = 2;  // ELFCLASS64
+  object[5] = 1;  // ELFDATA2LSB
+  object[6] = 1;  // EV_CURRENT
+  store_u16(object + 16, 1);  // ET_REL
+  store_u16(object + 18, ELF_MACHINE);
+  store_u32(object + 20, 1);  // EV_CURRENT
+  store_u64(object + 40, section_header_offset);
+  store_u16(object + 52, ELF_HEADER_SIZE);
+  store_u16(object + 58, ELF_SECTION_HEADER_SIZE);
+  store_u16(object + 60, NUM_SECTIONS);
+  store_u16(object + 62, SECTION_SHSTRTAB);
+
+  memcpy(object + rodata_offset, data, len);
+  store_u32(object + rodata_offset + len_offset, len);
+
+  p = object + strtab_offset + 1;
+  memcpy(p, name, name_len);
+  p += name_len + 1;
+  memcpy(p, name, name_len);
+  memcpy(p + name_len, "_len", 4);
+  memcpy(object + shstrtab_offset, section_names, sizeof(section_names));
+
+  // the first symbol is the null symbol
+  store_symbol(object + symtab_offset + ELF_SYMBOL_SIZE, 1, 0, len);
+  store_symbol(object + symtab_offset + ELF_SYMBOL_SIZE * 2, 1 + name_len + 1, len_offset, 4);
+
+  p = object + section_header_offset;
+  store_section_header(p + ELF_SECTION_HEADER_SIZE * SECTION_RODATA, SECTION_RODATA,
+      1, 2, rodata_offset, len_offset + 4, 0, 0, TRIE_EMIT_ALIGN, 0);  // SHT_PROGBITS, SHF_ALLOC
+  // all symbols from index 1 are global
+  store_section_header(p + ELF_SECTION_HEADER_SIZE * SECTION_SYMTAB, SECTION_SYMTAB,
+      2, 0, symtab_offset, ELF_SYMBOL_SIZE * 3, SECTION_STRTAB, 1, 8, ELF_SYMBOL_SIZE);
+  store_section_header(p + ELF_SECTION_HEADER_SIZE * SECTION_STRTAB, SECTION_STRTAB,
+      3, 0, strtab_offset, strtab_size, 0, 0, 1, 0);
+  store_section_header(p + ELF_SECTION_HEADER_SIZE * SECTION_SHSTRTAB, SECTION_SHSTRTAB,
+      3, 0, shstrtab_offset, sizeof(section_names), 0, 0, 1, 0);
+  // marks the stack as non-executable
+  store_section_header(p + ELF_SECTION_HEADER_SIZE * SECTION_NOTE_STACK, SECTION_NOTE_STACK,
+      1, 0, shstrtab_offset, 0, 0, 0, 1, 0);
+
+  fwrite(object, 1, object_len, out);
+  free(object);
+  return 0;
+#else
+  fprintf(stderr, "--emit=object is not supported on this architecture, use --emit=asm\n");
+  return -1;
+#endif
+}
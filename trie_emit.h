@@ -0,0 +1,25 @@
+// Write trie data as assembler source or as a relocatable object file
+//
+// Both define two read-only symbols, which C code declares as
+//
+//   extern const uint8_t trie_data[];      // aligned to 16 bytes
+//   extern const unsigned int trie_data_len;
+//
+// The names can be changed; the length is always the name plus "_len".
+
+#ifndef TRIE_EMIT_H
+#define TRIE_EMIT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define TRIE_EMIT_ALIGN  16
+
+// Write GNU assembler source for ELF targets
+void trie_emit_asm(FILE *out, const char *name, const uint8_t *data, unsigned int len);
+
+// Write an ELF64 relocatable object for the host architecture
+// Return 0 if success, -1 if the host architecture is not supported
+int trie_emit_object(FILE *out, const char *name, const uint8_t *data, unsigned int len);
+
+#endif // TRIE_EMIT_H
@@ -0,0 +1,243 @@
+// Encoders that turn a flattened trie into alternative runtime formats
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trie_encode.h"
+#include "louds_trie.h"
+#include "stride_trie.h"
+
+// Node layout of the terminal-flag format (see minimal_trie.h)
+#define TERMINAL_BYTES_PER_NODE  2
+#define TERMINAL_MAX_DESCENDANTS  0x7ff
+#define TERMINAL_RANK_BLOCK  16
+
+static void store_u32(uint8_t *p, uint32_t value) {
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  p[2] = (value >> 16) & 0xff;
+  p[3] = (value >> 24) & 0xff;
+}
+
+static void set_bit(uint8_t *words, unsigned int pos) {
+  words[pos >> 3] |= 1 << (pos & 7);
+}
+
+static unsigned int align8(unsigned int n) {
+  return (n + 7) & ~7u;
+}
+
+// Write the number of 1s before every LOUDS_RANK_BLOCK_WORDS words
+static void build_rank_dir(uint8_t *words, unsigned int num_words, uint8_t *dir) {
+  unsigned int count = 0;
+  unsigned int i;
+  for (i = 0; i < num_words * 8; i++) {
+    if (i % (LOUDS_RANK_BLOCK_WORDS * 8) == 0) {
+      store_u32(dir + (i / (LOUDS_RANK_BLOCK_WORDS * 8)) * 4, count);
+    }
+    uint8_t b = words[i];
+    while (b) {
+      b &= b - 1;
+      count++;
+    }
+  }
+  if (num_words % LOUDS_RANK_BLOCK_WORDS == 0) {
+    store_u32(dir + (num_words / LOUDS_RANK_BLOCK_WORDS) * 4, count);
+  }
+}
+
+// Collect the children of the preorder node at index into children, sorted by digit
+static int collect_children(tinreg_flat_node *nodes, int index, int *children) {
+  int num_children = 0;
+  int child = index + 1;
+  int end = index + nodes[index].num_descendants;
+  while (child <= end) {
+    int i = num_children++;
+    while (i > 0 && nodes[children[i-1]].digit > nodes[child].digit) {
+      children[i] = children[i-1];
+      i--;
+    }
+    children[i] = child;
+    child += nodes[child].num_descendants + 1;
+  }
+  return num_children;
+}
+
+int trie_encode_louds(tinreg_flat_node *nodes, int num_nodes, uint8_t **out) {
+  unsigned int num_bits = 2 * num_nodes - 1;
+  unsigned int num_words = (num_bits + 63) / 64;
+  unsigned int num_terminal_words = (num_nodes + 63) / 64;
+  unsigned int num_terminals = 0;
+  int i;
+  for (i = 0; i < num_nodes; i++) {
+    if (nodes[i].digit == TINREG_DIGIT_SET) {
+      fprintf(stderr, "error: the louds format does not support sets of digits such as [2-9]\n");
+      return -1;
+    }
+    if (nodes[i].result != '\0') {
+      num_terminals++;
+    }
+  }
+
+  unsigned int louds_offset = 8;
+  unsigned int rank_offset = louds_offset + num_words * 8;
+  unsigned int select_offset = rank_offset +
+    align8((num_words / LOUDS_RANK_BLOCK_WORDS + 1) * 4);
+  unsigned int terminal_offset = select_offset +
+    align8(((num_nodes - 1) / LOUDS_SELECT_SAMPLE + 1) * 4);
+  unsigned int terminal_rank_offset = terminal_offset + num_terminal_words * 8;
+  unsigned int labels_offset = terminal_rank_offset +
+    align8((num_terminal_words / LOUDS_RANK_BLOCK_WORDS + 1) * 4);
+  unsigned int results_offset = labels_offset + align8((num_nodes + 1) / 2);
+  unsigned int len = results_offset + num_terminals;
+
+  uint8_t *data = calloc(len, 1);
+  int *queue = malloc(sizeof(int) * num_nodes);
+  if (!data || !queue) {
+    fprintf(stderr, "malloc error for LOUDS data\n");
+    free(data);
+    free(queue);
+    return -1;
+  }
+  store_u32(data, num_nodes);
+  store_u32(data + 4, num_terminals);
+
+  // Walk the trie in BFS order; queue[i] is the preorder index of the node i
+  int queue_len = 1;
+  unsigned int bit_pos = 0;
+  unsigned int num_zeros = 0;
+  unsigned int terminal_index = 0;
+  queue[0] = 0;
+  for (i = 0; i < queue_len; i++) {
+    tinreg_flat_node *node = &nodes[queue[i]];
+    int children[10];
+    int num_children = collect_children(nodes, queue[i], children);
+    int j;
+    for (j = 0; j < num_children; j++) {
+      queue[queue_len++] = children[j];
+      set_bit(data + louds_offset, bit_pos++);
+    }
+    if (num_zeros % LOUDS_SELECT_SAMPLE == 0) {
+      store_u32(data + select_offset + (num_zeros / LOUDS_SELECT_SAMPLE) * 4, bit_pos);
+    }
+    num_zeros++;
+    bit_pos++;
+
+    data[labels_offset + (i >> 1)] |= node->digit << ((i & 1) * 4);
+    if (node->result != '\0') {
+      set_bit(data + terminal_offset, i);
+      data[results_offset + terminal_index++] = node->result;
+    }
+  }
+  build_rank_dir(data + louds_offset, num_words, data + rank_offset);
+  build_rank_dir(data + terminal_offset, num_terminal_words, data + terminal_rank_offset);
+
+  free(queue);
+  *out = data;
+  return len;
+}
+
+// A set of digits takes one more node for its mask, as in the packed format
+int trie_encode_terminal(tinreg_flat_node *nodes, int num_nodes, uint8_t **out) {
+  unsigned int num_terminals = 0;
+  int i;
+  // sets_before[i] is the number of sets among nodes[0..i)
+  unsigned int *sets_before = malloc(sizeof(unsigned int) * (num_nodes + 1));
+  if (!sets_before) {
+    fprintf(stderr, "malloc error for terminal-flag data\n");
+    return -1;
+  }
+  sets_before[0] = 0;
+  for (i = 0; i < num_nodes; i++) {
+    sets_before[i + 1] = sets_before[i] + (nodes[i].digit == TINREG_DIGIT_SET);
+    if (nodes[i].result != '\0') {
+      num_terminals++;
+    }
+  }
+  unsigned int num_slots = num_nodes + sets_before[num_nodes];
+  if (num_slots - 1 > TERMINAL_MAX_DESCENDANTS) {
+    fprintf(stderr, "error: trie is too large (number of descendants: %u > %d)\n",
+        num_slots - 1, TERMINAL_MAX_DESCENDANTS);
+    free(sets_before);
+    return -1;
+  }
+
+  unsigned int dir_offset = num_slots * TERMINAL_BYTES_PER_NODE;
+  unsigned int results_offset = dir_offset +
+    ((num_slots + TERMINAL_RANK_BLOCK - 1) / TERMINAL_RANK_BLOCK) * 2;
+  unsigned int len = results_offset + num_terminals;
+  uint8_t *data = malloc(len);
+  if (!data) {
+    fprintf(stderr, "malloc error for terminal-flag data\n");
+    free(sets_before);
+    return -1;
+  }
+
+  unsigned int terminal_index = 0;
+  for (i = 0; i < num_nodes; i++) {
+    uint8_t *p = data + (i + sets_before[i]) * TERMINAL_BYTES_PER_NODE;
+    unsigned int end = i + nodes[i].num_descendants + 1;
+    unsigned int num_descendants = nodes[i].num_descendants + sets_before[end] - sets_before[i];
+    unsigned int is_terminal = nodes[i].result != '\0';
+    p[0] = (nodes[i].digit << 4) | (is_terminal << 3) | ((num_descendants >> 8) & 0x7);
+    p[1] = num_descendants & 0xff;
+    if (nodes[i].digit == TINREG_DIGIT_SET) {
+      // the high bits of the mask never set the terminal flag
+      p[2] = nodes[i].digits >> 8;
+      p[3] = nodes[i].digits & 0xff;
+    }
+    if (is_terminal) {
+      data[results_offset + terminal_index++] = nodes[i].result;
+    }
+  }
+  // number of terminals before each block
+  terminal_index = 0;
+  for (i = 0; i < num_slots; i++) {
+    if (i % TERMINAL_RANK_BLOCK == 0) {
+      data[dir_offset + (i / TERMINAL_RANK_BLOCK) * 2] = terminal_index >> 8;
+      data[dir_offset + (i / TERMINAL_RANK_BLOCK) * 2 + 1] = terminal_index & 0xff;
+    }
+    if (data[i * TERMINAL_BYTES_PER_NODE] & 0x8) {
+      terminal_index++;
+    }
+  }
+
+  free(sets_before);
+  *out = data;
+  return len;
+}
+
+int trie_encode_stride(tinreg_flat_node *nodes, int num_nodes, uint8_t **out) {
+  unsigned int results_offset = STRIDE_HEADER_SIZE + num_nodes * STRIDE_FANOUT * 4;
+  unsigned int len = results_offset + num_nodes;
+  uint8_t *data = calloc(len, 1);
+  int i;
+  if (!data) {
+    fprintf(stderr, "malloc error for stride data\n");
+    return -1;
+  }
+
+  store_u32(data, num_nodes);
+  for (i = 0; i < num_nodes; i++) {
+    uint8_t *slots = data + STRIDE_HEADER_SIZE + i * STRIDE_FANOUT * 4;
+    int child = i + 1;
+    int end = i + nodes[i].num_descendants;
+    while (child <= end) {
+      int digit;
+      // a set of digits fills the slot of each of its digits
+      for (digit = 0; digit < STRIDE_FANOUT; digit++) {
+        uint8_t *slot = slots + digit * 4;
+        // the first sibling with a digit wins, as in the packed format
+        if (((nodes[child].digits >> digit) & 1) && !(slot[0] | slot[1] | slot[2] | slot[3])) {
+          store_u32(slot, child);
+        }
+      }
+      child += nodes[child].num_descendants + 1;
+    }
+    data[results_offset + i] = nodes[i].result;
+  }
+
+  *out = data;
+  return len;
+}
@@ -0,0 +1,21 @@
+// Encoders that turn a flattened trie into alternative runtime formats
+
+#ifndef TRIE_ENCODE_H
+#define TRIE_ENCODE_H
+
+#include "tiny_regex.h"
+
+// Encode the trie in the LOUDS succinct format read by louds_trie.c
+// Return the length of *out, or -1 if error
+int trie_encode_louds(tinreg_flat_node *nodes, int num_nodes, uint8_t **out);
+
+// Encode the trie in the terminal-flag format read by minimal_trie.c built
+// with USE_TERMINAL_FLAG=1
+// Return the length of *out, or -1 if error
+int trie_encode_terminal(tinreg_flat_node *nodes, int num_nodes, uint8_t **out);
+
+// Encode the trie in the fixed-stride format read by stride_trie.c
+// Return the length of *out, or -1 if error
+int trie_encode_stride(tinreg_flat_node *nodes, int num_nodes, uint8_t **out);
+
+#endif // TRIE_ENCODE_H
@@ -0,0 +1,86 @@
+// Find the paths of a packed trie within a few edits of a digit string
+
+#include "trie_fuzzy.h"
+
+#define SUBTREE_END(data, pos)  ((pos) + (NODE_DESCENDANTS(data, pos) + 1) * BYTES_PER_NODE)
+
+static uint8_t min3(uint8_t a, uint8_t b, uint8_t c) {
+  uint8_t m = a < b ? a : b;
+  return m < c ? m : c;
+}
+
+int trie_lookup_fuzzy(const trie_t *trie, const uint8_t *digits, uint8_t len,
+    uint8_t max_edits, trie_fuzzy_callback callback, void *user_data) {
+  // rows[d][j] is the edit distance between the path of depth d and digits[0..j)
+  uint8_t rows[TRIE_FUZZY_MAX_LEN + 1][TRIE_FUZZY_MAX_LEN + 1];
+  uint8_t path[TRIE_FUZZY_MAX_LEN];
+  unsigned int ends[TRIE_FUZZY_MAX_LEN];
+  const uint8_t *data = trie->data;
+  uint8_t depth = 0;
+  int num_found = 0;
+  unsigned int end = SUBTREE_END(data, 0);
+  unsigned int pos;
+  uint8_t j;
+
+  if (len > TRIE_FUZZY_MAX_LEN) {
+    return -1;
+  }
+  for (j = 0; j <= len; j++) {
+    rows[0][j] = j;
+  }
+  trie_cursor_t cursor = { *trie, 0 };
+  if (len <= max_edits && trie_cursor_result(&cursor) != '\0') {
+    num_found++;
+    if (callback(path, 0, trie_cursor_result(&cursor), len, user_data)) {
+      return num_found;
+    }
+  }
+
+  pos = BYTES_PER_NODE;
+  while (pos < end) {
+    uint8_t digit = NODE_CHAR(data, pos);
+    // digits matched by the node
+    uint16_t mask = digit == NODE_CHAR_SET ? NODE_SET_MASK(data, pos) : 1u << digit;
+    uint8_t *prev;
+    uint8_t *row;
+    uint8_t row_min;
+
+    // leave the subtrees that end here
+    while (depth > 0 && ends[depth - 1] <= pos) {
+      depth--;
+    }
+    if (depth == TRIE_FUZZY_MAX_LEN) {
+      pos = SUBTREE_END(data, pos);
+      continue;
+    }
+    prev = rows[depth];
+    row = rows[depth + 1];
+    row[0] = depth + 1;
+    row_min = row[0];
+    for (j = 1; j <= len; j++) {
+      uint8_t is_match = digits[j - 1] < 16 && ((mask >> digits[j - 1]) & 1);
+      row[j] = min3(prev[j] + 1, row[j - 1] + 1, prev[j - 1] + !is_match);
+      if (row[j] < row_min) {
+        row_min = row[j];
+      }
+    }
+    if (row_min > max_edits) {
+      // no path below this node can be within max_edits
+      pos = SUBTREE_END(data, pos);
+      continue;
+    }
+
+    path[depth] = digit;
+    ends[depth] = SUBTREE_END(data, pos);
+    depth++;
+    cursor.pos = pos;
+    if (row[len] <= max_edits && trie_cursor_result(&cursor) != '\0') {
+      num_found++;
+      if (callback(path, depth, trie_cursor_result(&cursor), row[len], user_data)) {
+        return num_found;
+      }
+    }
+    pos += NODE_SIZE(data, pos);
+  }
+  return num_found;
+}
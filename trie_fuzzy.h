@@ -0,0 +1,30 @@
+// Find the paths of a packed trie within a few edits of a digit string
+//
+// The trie is scanned in preorder while keeping one row of the Levenshtein
+// distance table per depth. A subtree is skipped as soon as every entry of
+// its row exceeds the edit budget. No memory is allocated.
+
+#ifndef TRIE_FUZZY_H
+#define TRIE_FUZZY_H
+
+#include "minimal_trie.h"
+
+// Maximum length of the digit string and of a matched path
+#ifndef TRIE_FUZZY_MAX_LEN
+#define TRIE_FUZZY_MAX_LEN  32
+#endif
+
+// Called for each path with a result within max_edits of the digits
+// A set of digits on the path matches any digit in it and is given as
+// NODE_CHAR_SET in path
+// Return nonzero to stop the search
+typedef int (*trie_fuzzy_callback)(const uint8_t *path, uint8_t path_len, uint8_t result,
+    uint8_t distance, void *user_data);
+
+// Report every path within max_edits substitutions, insertions or deletions
+// of digits[0..len) to callback
+// Return the number of reported paths, or -1 if len is too long
+int trie_lookup_fuzzy(const trie_t *trie, const uint8_t *digits, uint8_t len,
+    uint8_t max_edits, trie_fuzzy_callback callback, void *user_data);
+
+#endif // TRIE_FUZZY_H
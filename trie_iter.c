@@ -0,0 +1,96 @@
+// Enumerate the paths and results below a prefix of a packed trie
+
+#include "trie_iter.h"
+
+#define SUBTREE_END(data, pos)  ((pos) + (NODE_DESCENDANTS(data, pos) + 1) * BYTES_PER_NODE)
+
+int8_t trie_iter_init(trie_iter_t *it, const trie_t *trie, const uint8_t *prefix,
+    uint8_t prefix_len) {
+  trie_cursor_t cursor;
+  uint8_t i;
+  if (prefix_len > TRIE_ITER_MAX_DEPTH) {
+    return 0;
+  }
+  trie_cursor_start(&cursor, trie);
+  for (i = 0; i < prefix_len; i++) {
+    if (trie_cursor_forward(&cursor, prefix[i]) != 1) {
+      return 0;
+    }
+    it->digits[i] = prefix[i];
+  }
+  it->trie = *trie;
+  it->start = cursor.pos;
+  it->end = SUBTREE_END(trie->data, cursor.pos);
+  it->pos = cursor.pos;
+  it->prefix_len = prefix_len;
+  it->len = prefix_len;
+  it->result = '\0';
+  return 1;
+}
+
+int8_t trie_iter_next(trie_iter_t *it) {
+  const uint8_t *data = it->trie.data;
+  while (it->pos < it->end) {
+    unsigned int pos = it->pos;
+    if (pos != it->start) {
+      // leave the subtrees that end here
+      while (it->len > it->prefix_len && it->ends[it->len - 1] <= pos) {
+        it->len--;
+      }
+      if (it->len == TRIE_ITER_MAX_DEPTH) {
+        return -1;
+      }
+      it->digits[it->len] = NODE_CHAR(data, pos);
+      it->ends[it->len] = SUBTREE_END(data, pos);
+      it->len++;
+    }
+    it->pos += NODE_SIZE(data, pos);
+    trie_cursor_t cursor = { it->trie, pos };
+    it->result = trie_cursor_result(&cursor);
+    if (it->result != '\0') {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+unsigned int trie_iter_token(const trie_iter_t *it) {
+  return it->pos;
+}
+
+int8_t trie_iter_resume(trie_iter_t *it, const trie_t *trie, const uint8_t *prefix,
+    uint8_t prefix_len, unsigned int token) {
+  const uint8_t *data = trie->data;
+  unsigned int node;
+  if (!trie_iter_init(it, trie, prefix, prefix_len)) {
+    return 0;
+  }
+  if (token < it->start || token > it->end || (token - it->start) % BYTES_PER_NODE != 0) {
+    return 0;
+  }
+  // Rebuild the path from the prefix node down to the parent of the token node
+  node = it->start;
+  while (node < token) {
+    unsigned int child = node + NODE_SIZE(data, node);
+    unsigned int node_end = SUBTREE_END(data, node);
+    while (child < node_end && SUBTREE_END(data, child) <= token) {
+      child = SUBTREE_END(data, child);
+    }
+    if (child > token) {
+      // the token points into the slot of a set of digits
+      return 0;
+    }
+    if (child >= node_end || child == token) {
+      break;
+    }
+    if (it->len == TRIE_ITER_MAX_DEPTH) {
+      return 0;
+    }
+    it->digits[it->len] = NODE_CHAR(data, child);
+    it->ends[it->len] = SUBTREE_END(data, child);
+    it->len++;
+    node = child;
+  }
+  it->pos = token;
+  return 1;
+}
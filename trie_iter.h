@@ -0,0 +1,49 @@
+// Enumerate the paths and results below a prefix of a packed trie
+//
+// The subtree of a node is a contiguous range of the packed data, so the
+// iterator scans it linearly and keeps only the path to the current node.
+// No memory is allocated.
+
+#ifndef TRIE_ITER_H
+#define TRIE_ITER_H
+
+#include "minimal_trie.h"
+
+// Maximum length of an enumerated path (including the prefix)
+#ifndef TRIE_ITER_MAX_DEPTH
+#define TRIE_ITER_MAX_DEPTH  32
+#endif
+
+typedef struct trie_iter_t {
+  trie_t trie;
+  unsigned int start;  // offset of the prefix node
+  unsigned int end;    // end of the subtree of the prefix node
+  unsigned int pos;    // offset of the next node to visit
+  uint8_t prefix_len;
+  uint8_t len;         // length of digits
+  uint8_t result;      // result of the last path returned by trie_iter_next()
+  uint8_t digits[TRIE_ITER_MAX_DEPTH];
+  unsigned int ends[TRIE_ITER_MAX_DEPTH];  // end of the subtree of each digit
+} trie_iter_t;
+
+// Start enumerating the paths that begin with prefix
+// Return 1 if the prefix exists in the trie, 0 if not
+int8_t trie_iter_init(trie_iter_t *it, const trie_t *trie, const uint8_t *prefix,
+    uint8_t prefix_len);
+
+// Go to the next path that has a result
+// The path is it->digits[0..it->len) and its result is it->result, where
+// NODE_CHAR_SET stands for a set of digits such as [2-9]
+// Return 1 if found, 0 if all paths have been enumerated, -1 if a path is
+// longer than TRIE_ITER_MAX_DEPTH
+int8_t trie_iter_next(trie_iter_t *it);
+
+// Get a token from which trie_iter_resume() continues the enumeration
+unsigned int trie_iter_token(const trie_iter_t *it);
+
+// Continue the enumeration of the prefix from the token
+// Return 1 if success, 0 if the prefix or the token is invalid
+int8_t trie_iter_resume(trie_iter_t *it, const trie_t *trie, const uint8_t *prefix,
+    uint8_t prefix_len, unsigned int token);
+
+#endif // TRIE_ITER_H
@@ -0,0 +1,285 @@
+// Measure the throughput and latency of trie_server
+//
+// Each thread opens a connection and sends batches of pipelined requests,
+// waiting for all responses of a batch before sending the next one. The
+// latency of a batch is the time from sending it to receiving its last
+// response. Responses are read while the batch is being sent, as the server
+// stops reading a connection until its responses can be sent.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define MAX_KEY_LEN  32
+
+typedef struct worker {
+  pthread_t thread;
+  unsigned int id;
+  unsigned long num_batches;
+  unsigned long num_hits;
+  double *latencies;  // in microseconds
+  int failed;
+} worker;
+
+static char *socket_path = "/tmp/trie.sock";
+static unsigned int batch_size = 64;
+static unsigned long num_requests = 1000000;
+static char (*keys)[MAX_KEY_LEN + 1];
+static unsigned int num_keys;
+
+void print_usage() {
+  printf("Usage: trie_loadgen [options]\n");
+  printf("\n");
+  printf("Options:\n");
+  printf("  -s, --socket=PATH   socket path (default: /tmp/trie.sock)\n");
+  printf("  -n, --requests=N    requests per thread (default: 1000000)\n");
+  printf("  -b, --batch=N       requests per batch (default: 64)\n");
+  printf("  -t, --threads=N     number of connections (default: 1)\n");
+  printf("  -k, --keys=FILE     numbers to look up, one per line\n");
+  printf("                      (default: random 10-digit numbers)\n");
+}
+
+static double now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int load_keys(const char *filename) {
+  char buf[1024];
+  unsigned int capacity = 1024;
+  FILE *fp = fopen(filename, "r");
+  if (!fp) {
+    fprintf(stderr, "Error opening %s: %s\n", filename, strerror(errno));
+    return -1;
+  }
+  keys = malloc(sizeof(*keys) * capacity);
+  while (keys && fgets(buf, sizeof(buf), fp)) {
+    size_t len = strspn(buf, "0123456789");
+    if (len == 0) {
+      continue;
+    }
+    if (len > MAX_KEY_LEN) {
+      len = MAX_KEY_LEN;
+    }
+    if (num_keys == capacity) {
+      capacity *= 2;
+      keys = realloc(keys, sizeof(*keys) * capacity);
+      if (!keys) {
+        break;
+      }
+    }
+    memcpy(keys[num_keys], buf, len);
+    keys[num_keys][len] = '\0';
+    num_keys++;
+  }
+  fclose(fp);
+  if (!keys || num_keys == 0) {
+    fprintf(stderr, "no keys in %s\n", filename);
+    return -1;
+  }
+  return 0;
+}
+
+static void random_keys() {
+  unsigned int i, j;
+  num_keys = 65536;
+  keys = malloc(sizeof(*keys) * num_keys);
+  for (i = 0; i < num_keys; i++) {
+    for (j = 0; j < 10; j++) {
+      keys[i][j] = '0' + rand() % 10;
+    }
+    keys[i][10] = '\0';
+  }
+}
+
+// Send the requests and receive num_responses responses, in both
+// directions at once so that neither side fills its socket buffers
+// Return 0 if success, -1 if error
+static int exchange(int fd, const uint8_t *requests, size_t len, uint8_t *responses,
+    size_t num_responses) {
+  size_t sent = 0;
+  size_t received = 0;
+  while (received < num_responses) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = sent < len ? POLLIN | POLLOUT : POLLIN;
+    if (poll(&pfd, 1, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (pfd.revents & POLLIN) {
+      ssize_t n = read(fd, responses + received, num_responses - received);
+      if (n <= 0) {
+        return -1;
+      }
+      received += n;
+    } else if (pfd.revents & (POLLERR | POLLHUP)) {
+      return -1;
+    }
+    if (sent < len && (pfd.revents & POLLOUT)) {
+      ssize_t n = send(fd, requests + sent, len - sent, MSG_DONTWAIT);
+      if (n == -1 && errno != EAGAIN) {
+        return -1;
+      }
+      if (n > 0) {
+        sent += n;
+      }
+    }
+  }
+  return 0;
+}
+
+static void *run_worker(void *arg) {
+  worker *w = arg;
+  struct sockaddr_un addr;
+  uint8_t *requests = malloc(batch_size * (MAX_KEY_LEN + 1));
+  uint8_t *responses = malloc(batch_size);
+  unsigned long batch;
+  unsigned int key_index = w->id * 7919;
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+  if (!requests || !responses || fd == -1 ||
+      connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+    fprintf(stderr, "Error connecting to %s: %s\n", socket_path, strerror(errno));
+    w->failed = 1;
+    return NULL;
+  }
+
+  for (batch = 0; batch < w->num_batches; batch++) {
+    size_t len = 0;
+    unsigned int i;
+    for (i = 0; i < batch_size; i++) {
+      char *key = keys[key_index++ % num_keys];
+      size_t key_len = strlen(key);
+      requests[len++] = key_len;
+      memcpy(requests + len, key, key_len);
+      len += key_len;
+    }
+    double start = now_us();
+    if (exchange(fd, requests, len, responses, batch_size) != 0) {
+      w->failed = 1;
+      break;
+    }
+    w->latencies[batch] = now_us() - start;
+    for (i = 0; i < batch_size; i++) {
+      if (responses[i] != '\0') {
+        w->num_hits++;
+      }
+    }
+  }
+
+  close(fd);
+  free(requests);
+  free(responses);
+  return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv) {
+  unsigned int num_threads = 1;
+  char *keys_filename = NULL;
+  worker *workers;
+  unsigned int i;
+
+  static struct option long_options[] = {
+    { "socket", required_argument, NULL, 's' },
+    { "requests", required_argument, NULL, 'n' },
+    { "batch", required_argument, NULL, 'b' },
+    { "threads", required_argument, NULL, 't' },
+    { "keys", required_argument, NULL, 'k' },
+    { 0, 0, 0, 0 },
+  };
+  int option_index = 0;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "s:n:b:t:k:", long_options, &option_index)) != -1) {
+    switch (opt) {
+      case 's':
+        socket_path = optarg;
+        break;
+      case 'n':
+        num_requests = strtoul(optarg, NULL, 10);
+        break;
+      case 'b':
+        batch_size = strtoul(optarg, NULL, 10);
+        break;
+      case 't':
+        num_threads = strtoul(optarg, NULL, 10);
+        break;
+      case 'k':
+        keys_filename = optarg;
+        break;
+      default:
+        print_usage();
+        return EXIT_FAILURE;
+    }
+  }
+  if (batch_size == 0 || num_threads == 0 || num_requests < batch_size) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+
+  if (keys_filename) {
+    if (load_keys(keys_filename) != 0) {
+      return EXIT_FAILURE;
+    }
+  } else {
+    random_keys();
+  }
+
+  workers = calloc(num_threads, sizeof(worker));
+  for (i = 0; i < num_threads; i++) {
+    workers[i].id = i;
+    workers[i].num_batches = num_requests / batch_size;
+    workers[i].latencies = malloc(sizeof(double) * workers[i].num_batches);
+  }
+  double start = now_us();
+  for (i = 0; i < num_threads; i++) {
+    pthread_create(&workers[i].thread, NULL, run_worker, &workers[i]);
+  }
+  for (i = 0; i < num_threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  double elapsed = now_us() - start;
+
+  unsigned long num_batches = 0;
+  unsigned long num_hits = 0;
+  double *latencies = malloc(sizeof(double) * workers[0].num_batches * num_threads);
+  for (i = 0; i < num_threads; i++) {
+    if (workers[i].failed) {
+      fprintf(stderr, "thread %u failed\n", i);
+      return EXIT_FAILURE;
+    }
+    memcpy(latencies + num_batches, workers[i].latencies,
+        sizeof(double) * workers[i].num_batches);
+    num_batches += workers[i].num_batches;
+    num_hits += workers[i].num_hits;
+  }
+  qsort(latencies, num_batches, sizeof(double), compare_double);
+
+  printf("requests:    %lu (%lu hits)\n", num_batches * batch_size, num_hits);
+  printf("throughput:  %.0f requests/s\n", num_batches * batch_size / (elapsed / 1e6));
+  printf("batch of %u: p50 %.1f us, p99 %.1f us, max %.1f us\n", batch_size,
+      latencies[num_batches / 2], latencies[num_batches * 99 / 100],
+      latencies[num_batches - 1]);
+  return EXIT_SUCCESS;
+}
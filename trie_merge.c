@@ -0,0 +1,230 @@
+// Union, intersection and difference of two packed tries
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trie_merge.h"
+
+#define MAX_DESCENDANTS  0xfff
+#define MAX_PATH_LEN  64
+#define NO_NODE  -1
+
+// Result byte of the node at pos
+#define NODE_RESULT(data, pos)  ((data)[(pos) + BYTES_PER_NODE - 1])
+
+// New trie being written
+typedef struct merger {
+  const trie_t *a;
+  const trie_t *b;
+  int op;
+  int conflict;
+  uint8_t *out;
+  unsigned int len;
+  unsigned int capacity;
+  char path[MAX_PATH_LEN + 1]; // a number reaching the current node, for errors
+} merger;
+
+// Find the child that each digit leads to from the node at pos, which is
+// the first child matching it as in trie_cursor_forward()
+static void find_children(const trie_t *trie, int pos, int children[10]) {
+  const uint8_t *data = trie->data;
+  unsigned int end;
+  unsigned int child;
+  int digit;
+  for (digit = 0; digit < 10; digit++) {
+    children[digit] = NO_NODE;
+  }
+  if (pos == NO_NODE) {
+    return;
+  }
+  end = pos + (NODE_DESCENDANTS(data, pos) + 1) * BYTES_PER_NODE;
+  if (end > trie->len) {
+    end = trie->len;
+  }
+  for (child = pos + NODE_SIZE(data, pos); child + BYTES_PER_NODE <= end;
+      child += (NODE_DESCENDANTS(data, child) + 1) * BYTES_PER_NODE) {
+    unsigned int mask = NODE_CHAR(data, child) == NODE_CHAR_SET ?
+      NODE_SET_MASK(data, child) : 1u << NODE_CHAR(data, child);
+    for (digit = 0; digit < 10; digit++) {
+      if (((mask >> digit) & 1) && children[digit] == NO_NODE) {
+        children[digit] = child;
+      }
+    }
+  }
+}
+
+// Append the digits in the order of the children of the node at pos
+static void add_digit_order(const int children[10], uint8_t *order,
+    unsigned int *num_digits, unsigned int *seen) {
+  int last = NO_NODE;
+  int digit;
+  int child;
+  // children are in preorder, so each one is after the last one taken
+  for (;;) {
+    int next = NO_NODE;
+    for (digit = 0; digit < 10; digit++) {
+      child = children[digit];
+      if (child > last && (next == NO_NODE || child < next)) {
+        next = child;
+      }
+    }
+    if (next == NO_NODE) {
+      return;
+    }
+    for (digit = 0; digit < 10; digit++) {
+      if (children[digit] == next && !((*seen >> digit) & 1)) {
+        order[(*num_digits)++] = digit;
+        *seen |= 1u << digit;
+      }
+    }
+    last = next;
+  }
+}
+
+// Get the result of the number in the new trie
+// Return 0 if success, -1 if the results conflict
+static int merge_result(merger *m, int pa, int pb, uint8_t *result) {
+  uint8_t ra = pa == NO_NODE ? '\0' : NODE_RESULT(m->a->data, pa);
+  uint8_t rb = pb == NO_NODE ? '\0' : NODE_RESULT(m->b->data, pb);
+  if (m->op == TRIE_MERGE_INTERSECT) {
+    *result = ra == rb ? ra : '\0';
+  } else if (m->op == TRIE_MERGE_DIFFERENCE) {
+    *result = ra != rb ? ra : '\0';
+  } else if (ra != '\0' && rb != '\0' && ra != rb) {
+    if (m->conflict == TRIE_MERGE_ERROR) {
+      fprintf(stderr, "error: %s has the result %c in one trie and %c in the other\n",
+          m->path[0] ? m->path : "the root", ra, rb);
+      return -1;
+    }
+    *result = m->conflict == TRIE_MERGE_LEFT ? ra : rb;
+  } else {
+    *result = ra != '\0' ? ra : rb;
+  }
+  return 0;
+}
+
+// Make room for the slots of one node
+// Return 0 if success, -1 if error
+static int reserve(merger *m) {
+  if (m->len + 2 * BYTES_PER_NODE <= m->capacity) {
+    return 0;
+  }
+  unsigned int capacity = m->capacity * 2;
+  uint8_t *out = realloc(m->out, capacity);
+  if (!out) {
+    fprintf(stderr, "malloc error for the merged trie\n");
+    return -1;
+  }
+  m->out = out;
+  m->capacity = capacity;
+  return 0;
+}
+
+// Write the node for the digits in mask, reached by the node pa in a and pb
+// in b (either may be NO_NODE), with its subtree
+// Return 1 if written, 0 if it has no result in its subtree, -1 if error
+static int merge_node(merger *m, int pa, int pb, unsigned int mask, unsigned int depth) {
+  unsigned int pos = m->len;
+  int is_set = depth > 0 && (mask & (mask - 1)) != 0;
+  int children_a[10];
+  int children_b[10];
+  uint8_t order[10];
+  unsigned int num_digits = 0;
+  unsigned int seen = 0;
+  unsigned int done = 0;
+  unsigned int i;
+  uint8_t node_char = 0;
+  uint8_t result;
+  if (merge_result(m, pa, pb, &result) != 0 || reserve(m) != 0) {
+    return -1;
+  }
+  m->len += is_set ? 2 * BYTES_PER_NODE : BYTES_PER_NODE;
+
+  find_children(m->a, pa, children_a);
+  find_children(m->b, pb, children_b);
+  add_digit_order(children_a, order, &num_digits, &seen);
+  add_digit_order(children_b, order, &num_digits, &seen);
+  for (i = 0; i < num_digits; i++) {
+    uint8_t digit = order[i];
+    int ca = children_a[digit];
+    int cb = children_b[digit];
+    unsigned int group = 0;
+    uint8_t other;
+    if ((done >> digit) & 1) {
+      continue;
+    }
+    for (other = 0; other < 10; other++) {
+      if (!((done >> other) & 1) && children_a[other] == ca && children_b[other] == cb) {
+        group |= 1u << other;
+      }
+    }
+    done |= group;
+    if ((m->op == TRIE_MERGE_INTERSECT && (ca == NO_NODE || cb == NO_NODE)) ||
+        (m->op == TRIE_MERGE_DIFFERENCE && ca == NO_NODE)) {
+      continue;
+    }
+    if (depth < MAX_PATH_LEN) {
+      m->path[depth] = '0' + digit;
+      m->path[depth + 1] = '\0';
+    }
+    if (merge_node(m, ca, cb, group, depth + 1) < 0) {
+      return -1;
+    }
+  }
+  if (depth < MAX_PATH_LEN) {
+    m->path[depth] = '\0';
+  }
+
+  unsigned int num_descendants = (m->len - pos) / BYTES_PER_NODE - 1;
+  if (depth > 0 && result == '\0' && m->len - pos == (is_set ? 2u : 1u) * BYTES_PER_NODE) {
+    m->len = pos;
+    return 0;
+  }
+  if (is_set) {
+    node_char = NODE_CHAR_SET;
+    m->out[pos + BYTES_PER_NODE] = mask >> 8;
+    m->out[pos + BYTES_PER_NODE + 1] = mask & 0xff;
+    m->out[pos + BYTES_PER_NODE + 2] = 0;
+  } else if (depth > 0) {
+    while (!((mask >> node_char) & 1)) {
+      node_char++;
+    }
+  }
+  // the descendants may be too many, which is checked with the root
+  m->out[pos] = (node_char << 4) | ((num_descendants >> 8) & 0xf);
+  m->out[pos + 1] = num_descendants & 0xff;
+  m->out[pos + 2] = result;
+  return 1;
+}
+
+int trie_merge(const trie_t *a, const trie_t *b, int op, int conflict, uint8_t **out) {
+  merger m;
+  if (a->len < BYTES_PER_NODE || b->len < BYTES_PER_NODE) {
+    fprintf(stderr, "error: a trie to merge is empty\n");
+    return -1;
+  }
+  memset(&m, 0, sizeof(m));
+  m.a = a;
+  m.b = b;
+  m.op = op;
+  m.conflict = conflict;
+  m.capacity = a->len + b->len + 2 * BYTES_PER_NODE;
+  m.out = malloc(m.capacity);
+  if (!m.out) {
+    fprintf(stderr, "malloc error for the merged trie\n");
+    return -1;
+  }
+  if (merge_node(&m, 0, 0, 0, 0) < 0) {
+    free(m.out);
+    return -1;
+  }
+  if (m.len / BYTES_PER_NODE - 1 > MAX_DESCENDANTS) {
+    fprintf(stderr, "error: merged trie is too large (number of descendants: %u > %d)\n",
+        m.len / BYTES_PER_NODE - 1, MAX_DESCENDANTS);
+    free(m.out);
+    return -1;
+  }
+  *out = m.out;
+  return m.len;
+}
@@ -0,0 +1,31 @@
+// Union, intersection and difference of two packed tries, as sets of
+// numbers with their results (build_trie --union, --intersect, --difference)
+//
+// Both tries are walked together from the root. At each pair of nodes, the
+// digits are grouped by the child they lead to in each trie, and each group
+// becomes one child of the new trie, a set of digits if it has more than
+// one. The new packed trie is written in the same pass, and subtrees left
+// without a result are dropped. A set of digits that overlaps several
+// children of the other trie is walked once for each of them, so the work
+// is linear in the size of the new trie.
+
+#ifndef TRIE_MERGE_H
+#define TRIE_MERGE_H
+
+#include "minimal_trie.h"
+
+// Operations
+#define TRIE_MERGE_UNION  0       // numbers in either trie
+#define TRIE_MERGE_INTERSECT  1   // numbers with the same result in both
+#define TRIE_MERGE_DIFFERENCE  2  // numbers of a whose result is not the same in b
+
+// Result of a number with different results in both tries, for a union
+#define TRIE_MERGE_LEFT  0        // the result in a
+#define TRIE_MERGE_RIGHT  1       // the result in b
+#define TRIE_MERGE_ERROR  2       // fail
+
+// Build the packed trie of a op b
+// Return the length of *out, or -1 if error
+int trie_merge(const trie_t *a, const trie_t *b, int op, int conflict, uint8_t **out);
+
+#endif // TRIE_MERGE_H
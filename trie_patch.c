@@ -0,0 +1,248 @@
+// Patches that turn one packed trie into another
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trie_patch.h"
+
+// CRC-32 (IEEE 802.3) without a table
+static uint32_t update_crc32(uint32_t crc, const uint8_t *data, unsigned int len) {
+  unsigned int i;
+  uint8_t bit;
+  crc = ~crc;
+  for (i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+static uint32_t load_u32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void store_u32(uint8_t *p, uint32_t value) {
+  p[0] = value >> 24;
+  p[1] = (value >> 16) & 0xff;
+  p[2] = (value >> 8) & 0xff;
+  p[3] = value & 0xff;
+}
+
+// Patch being written. Consecutive ops of the same kind are merged.
+typedef struct patch_writer {
+  uint8_t *data;
+  unsigned int len;
+  unsigned int capacity;
+  unsigned int op_pos;  // offset of the last op, 0 if none
+  int is_error;
+} patch_writer;
+
+static void reserve(patch_writer *w, unsigned int len) {
+  if (w->len + len > w->capacity) {
+    while (w->len + len > w->capacity) {
+      w->capacity *= 2;
+    }
+    uint8_t *data = realloc(w->data, w->capacity);
+    if (!data) {
+      fprintf(stderr, "realloc error for patch\n");
+      w->is_error = 1;
+      return;
+    }
+    w->data = data;
+  }
+}
+
+// Add an op for num_slots slots, followed by the slots at bytes for an insert
+static void write_op(patch_writer *w, int op, unsigned int num_slots, const uint8_t *bytes) {
+  unsigned int op_slots = 0;
+  if (num_slots == 0 || w->is_error) {
+    return;
+  }
+  // the last op is always at the end of the patch, with its inserted slots
+  if (w->op_pos != 0 && w->data[w->op_pos] >> 6 == op) {
+    op_slots = ((w->data[w->op_pos] & 0x3f) << 8) | w->data[w->op_pos + 1];
+  }
+  if (op_slots == 0 || op_slots + num_slots > TRIE_PATCH_MAX_SLOTS) {
+    reserve(w, 2);
+    if (w->is_error) {
+      return;
+    }
+    w->op_pos = w->len;
+    w->len += 2;
+    op_slots = 0;
+  }
+  op_slots += num_slots;
+  w->data[w->op_pos] = (op << 6) | (op_slots >> 8);
+  w->data[w->op_pos + 1] = op_slots & 0xff;
+  if (op == TRIE_PATCH_INSERT) {
+    reserve(w, num_slots * BYTES_PER_NODE);
+    if (w->is_error) {
+      return;
+    }
+    memcpy(w->data + w->len, bytes, num_slots * BYTES_PER_NODE);
+    w->len += num_slots * BYTES_PER_NODE;
+  }
+}
+
+#define SUBTREE_SLOTS(data, pos)  (NODE_DESCENDANTS(data, pos) + 1)
+
+// Children are matched by their digit, or by their digits for a set
+static int is_same_key(const uint8_t *a, unsigned int a_pos, const uint8_t *b, unsigned int b_pos) {
+  if (NODE_CHAR(a, a_pos) != NODE_CHAR(b, b_pos)) {
+    return 0;
+  }
+  return NODE_CHAR(a, a_pos) != NODE_CHAR_SET ||
+    NODE_SET_MASK(a, a_pos) == NODE_SET_MASK(b, b_pos);
+}
+
+// Write the ops that turn the old subtree at old_pos into the new one at
+// new_pos, reading the old subtree from start to end
+static void diff_node(patch_writer *w, const uint8_t *old_data, unsigned int old_pos,
+    const uint8_t *new_data, unsigned int new_pos) {
+  unsigned int old_end = old_pos + SUBTREE_SLOTS(old_data, old_pos) * BYTES_PER_NODE;
+  unsigned int new_end = new_pos + SUBTREE_SLOTS(new_data, new_pos) * BYTES_PER_NODE;
+  unsigned int old_size = NODE_SIZE(old_data, old_pos);
+  unsigned int new_size = NODE_SIZE(new_data, new_pos);
+  unsigned int old_child, new_child;
+  if (old_end - old_pos == new_end - new_pos &&
+      memcmp(old_data + old_pos, new_data + new_pos, old_end - old_pos) == 0) {
+    write_op(w, TRIE_PATCH_COPY, (old_end - old_pos) / BYTES_PER_NODE, NULL);
+    return;
+  }
+  // the node itself, with its set slot
+  if (old_size == new_size && memcmp(old_data + old_pos, new_data + new_pos, old_size) == 0) {
+    write_op(w, TRIE_PATCH_COPY, old_size / BYTES_PER_NODE, NULL);
+  } else {
+    write_op(w, TRIE_PATCH_SKIP, old_size / BYTES_PER_NODE, NULL);
+    write_op(w, TRIE_PATCH_INSERT, new_size / BYTES_PER_NODE, new_data + new_pos);
+  }
+  old_child = old_pos + old_size;
+  for (new_child = new_pos + new_size; new_child < new_end;
+      new_child += SUBTREE_SLOTS(new_data, new_child) * BYTES_PER_NODE) {
+    // find the same child among the old children not read yet
+    unsigned int pos = old_child;
+    while (pos < old_end && !is_same_key(old_data, pos, new_data, new_child)) {
+      pos += SUBTREE_SLOTS(old_data, pos) * BYTES_PER_NODE;
+    }
+    if (pos == old_end) {
+      write_op(w, TRIE_PATCH_INSERT, SUBTREE_SLOTS(new_data, new_child), new_data + new_child);
+      continue;
+    }
+    write_op(w, TRIE_PATCH_SKIP, (pos - old_child) / BYTES_PER_NODE, NULL);
+    diff_node(w, old_data, pos, new_data, new_child);
+    old_child = pos + SUBTREE_SLOTS(old_data, pos) * BYTES_PER_NODE;
+  }
+  write_op(w, TRIE_PATCH_SKIP, (old_end - old_child) / BYTES_PER_NODE, NULL);
+}
+
+// Return 1 if data is a whole packed trie
+static int is_packed_trie(const uint8_t *data, unsigned int len) {
+  return len > 0 && len % BYTES_PER_NODE == 0 &&
+    SUBTREE_SLOTS(data, 0) * BYTES_PER_NODE == len;
+}
+
+int trie_patch_diff(const uint8_t *old_data, unsigned int old_len,
+    const uint8_t *new_data, unsigned int new_len, uint8_t **patch) {
+  patch_writer w;
+  if (!is_packed_trie(old_data, old_len) || !is_packed_trie(new_data, new_len)) {
+    fprintf(stderr, "error: --diff needs two tries in the packed format (--emit=binary)\n");
+    return -1;
+  }
+  w.capacity = 256;
+  w.data = malloc(w.capacity);
+  if (!w.data) {
+    fprintf(stderr, "malloc error for patch\n");
+    return -1;
+  }
+  w.data[0] = 'T';
+  w.data[1] = 'P';
+  w.data[2] = TRIE_PATCH_VERSION;
+  w.data[3] = 0;
+  store_u32(w.data + 4, old_len);
+  store_u32(w.data + 8, update_crc32(0, old_data, old_len));
+  store_u32(w.data + 12, new_len);
+  store_u32(w.data + 16, update_crc32(0, new_data, new_len));
+  w.len = TRIE_PATCH_HEADER_SIZE;
+  w.op_pos = 0;
+  w.is_error = 0;
+  diff_node(&w, old_data, 0, new_data, 0);
+  // a change that reaches most subtrees is smaller as the whole new trie
+  if (!w.is_error && w.len > TRIE_PATCH_HEADER_SIZE + 4 + new_len) {
+    w.len = TRIE_PATCH_HEADER_SIZE;
+    w.op_pos = 0;
+    write_op(&w, TRIE_PATCH_SKIP, old_len / BYTES_PER_NODE, NULL);
+    write_op(&w, TRIE_PATCH_INSERT, new_len / BYTES_PER_NODE, new_data);
+  }
+  if (w.is_error) {
+    free(w.data);
+    return -1;
+  }
+  *patch = w.data;
+  return w.len;
+}
+
+unsigned int trie_patch_new_len(const uint8_t *patch, unsigned int patch_len) {
+  if (patch_len < TRIE_PATCH_HEADER_SIZE || patch[0] != 'T' || patch[1] != 'P' ||
+      patch[2] != TRIE_PATCH_VERSION) {
+    return 0;
+  }
+  return load_u32(patch + 12);
+}
+
+int trie_apply_patch(const uint8_t *old_data, unsigned int old_len,
+    const uint8_t *patch, unsigned int patch_len, uint8_t *out, unsigned int out_len) {
+  unsigned int new_len = trie_patch_new_len(patch, patch_len);
+  unsigned int patch_pos = TRIE_PATCH_HEADER_SIZE;
+  unsigned int old_pos = 0;
+  unsigned int out_pos = 0;
+  uint32_t old_crc = 0;
+  uint32_t new_crc = 0;
+  if (new_len == 0 || new_len > out_len) {
+    return TRIE_PATCH_ERROR_FORMAT;
+  }
+  if (load_u32(patch + 4) != old_len) {
+    return TRIE_PATCH_ERROR_OLD;
+  }
+  while (patch_pos < patch_len) {
+    int op;
+    unsigned int len;
+    if (patch_pos + 2 > patch_len) {
+      return TRIE_PATCH_ERROR_FORMAT;
+    }
+    op = patch[patch_pos] >> 6;
+    len = (((patch[patch_pos] & 0x3f) << 8) | patch[patch_pos + 1]) * BYTES_PER_NODE;
+    patch_pos += 2;
+    if (op == TRIE_PATCH_INSERT) {
+      if (patch_pos + len > patch_len || out_pos + len > new_len) {
+        return TRIE_PATCH_ERROR_FORMAT;
+      }
+      memcpy(out + out_pos, patch + patch_pos, len);
+      new_crc = update_crc32(new_crc, out + out_pos, len);
+      patch_pos += len;
+      out_pos += len;
+      continue;
+    }
+    if (op > TRIE_PATCH_INSERT || old_pos + len > old_len ||
+        (op == TRIE_PATCH_COPY && out_pos + len > new_len)) {
+      return TRIE_PATCH_ERROR_FORMAT;
+    }
+    // every byte of the old trie is read once, copied or not
+    old_crc = update_crc32(old_crc, old_data + old_pos, len);
+    if (op == TRIE_PATCH_COPY) {
+      memcpy(out + out_pos, old_data + old_pos, len);
+      new_crc = update_crc32(new_crc, out + out_pos, len);
+      out_pos += len;
+    }
+    old_pos += len;
+  }
+  if (old_pos != old_len || old_crc != load_u32(patch + 8)) {
+    return TRIE_PATCH_ERROR_OLD;
+  }
+  if (out_pos != new_len || new_crc != load_u32(patch + 16)) {
+    return TRIE_PATCH_ERROR_NEW;
+  }
+  return new_len;
+}
@@ -0,0 +1,51 @@
+// Patches that turn one packed trie into another, built with build_trie --diff
+//
+// Layout of a patch (integers are big-endian):
+//   'T', 'P', uint8 version (TRIE_PATCH_VERSION), uint8 0
+//   uint32  length and uint32 CRC-32 of the old trie
+//   uint32  length and uint32 CRC-32 of the new trie
+//   ops, each a uint16 with the op in the top 2 bits and a number of
+//   slots (3-byte nodes or set slots) below:
+//     TRIE_PATCH_COPY    copy the slots from the old trie
+//     TRIE_PATCH_SKIP    skip the slots of the old trie
+//     TRIE_PATCH_INSERT  write the slots that follow the op
+//
+// The ops read the old trie from start to end once. A subtree that did not
+// change is one COPY, and a node whose subtree changed is replaced by its
+// new slot, which holds its new number of descendants.
+
+#ifndef TRIE_PATCH_H
+#define TRIE_PATCH_H
+
+#include "minimal_trie.h"
+
+#define TRIE_PATCH_VERSION  1
+#define TRIE_PATCH_HEADER_SIZE  20
+
+#define TRIE_PATCH_COPY  0
+#define TRIE_PATCH_SKIP  1
+#define TRIE_PATCH_INSERT  2
+#define TRIE_PATCH_MAX_SLOTS  0x3fff
+
+// Errors returned by trie_apply_patch()
+#define TRIE_PATCH_ERROR_FORMAT  -1     // not a patch, or a broken one
+#define TRIE_PATCH_ERROR_OLD  -2        // the old trie is not the one of the patch
+#define TRIE_PATCH_ERROR_NEW  -3        // the output does not match the new checksum
+
+// Build a patch from the old packed trie to the new one
+// Return the length of *patch, or -1 if error
+int trie_patch_diff(const uint8_t *old_data, unsigned int old_len,
+    const uint8_t *new_data, unsigned int new_len, uint8_t **patch);
+
+// Get the length of the trie that the patch builds, or 0 if it is not a patch
+unsigned int trie_patch_new_len(const uint8_t *patch, unsigned int patch_len);
+
+// Write the new trie into out (trie_patch_new_len() bytes) in one pass over
+// the old trie and the patch, checking both checksums, without allocating
+// memory. out must not overlap the old trie.
+// Return the length of the new trie, or TRIE_PATCH_ERROR_* if error, in
+// which case out holds no usable trie
+int trie_apply_patch(const uint8_t *old_data, unsigned int old_len,
+    const uint8_t *patch, unsigned int patch_len, uint8_t *out, unsigned int out_len);
+
+#endif // TRIE_PATCH_H
@@ -0,0 +1,238 @@
+// Look up every line of a file of numbers in a trie
+//
+// The input file is mapped into memory and processed in rounds. In each
+// round every thread takes the next block of whole lines, converts it from
+// ASCII to digit values in one pass, looks up each line, and writes the
+// results into its own buffer. The buffers are then written out in input
+// order, one line per input line: the result, or an empty line if the
+// number has no result.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "minimal_trie.h"
+#include "pattern_file.h"
+
+#define DEFAULT_BLOCK_SIZE  (4 * 1024 * 1024)
+
+typedef struct worker {
+  pthread_t thread;
+  const uint8_t *start;
+  const uint8_t *end;
+  uint8_t *digits;  // digit value of each byte of the block
+  uint8_t *out;
+  size_t out_len;
+  size_t capacity;  // size of digits; out has one more byte
+} worker;
+
+static trie_t trie;
+static size_t block_size = DEFAULT_BLOCK_SIZE;
+
+void print_usage() {
+  printf("Usage: trie_query [options] <input_file>\n");
+  printf("\n");
+  printf("Options:\n");
+  printf("  -p, --patterns=FILE  pattern file to build the trie from\n");
+  printf("  -t, --trie=FILE      binary trie file (build_trie --emit=binary)\n");
+  printf("  -j, --threads=N      number of threads (default: 4)\n");
+  printf("  -b, --block-size=N   bytes of input per thread and round (default: 4194304)\n");
+}
+
+static void *map_file(const char *filename, size_t *len) {
+  struct stat st;
+  void *map;
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    fprintf(stderr, "Error opening %s: %s\n", filename, strerror(errno));
+    return NULL;
+  }
+  if (fstat(fd, &st) == -1) {
+    fprintf(stderr, "Error reading %s: %s\n", filename, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+  *len = st.st_size;
+  if (st.st_size == 0) {
+    close(fd);
+    return "";
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Error mapping %s: %s\n", filename, strerror(errno));
+    return NULL;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  return map;
+}
+
+// Convert ASCII to digit values; bytes other than '0'-'9' become values > 9
+static void to_digits(const uint8_t *in, uint8_t *out, size_t len) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_set1_epi8('0');
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+    _mm_storeu_si128((__m128i *)(out + i), _mm_sub_epi8(v, zero));
+  }
+#endif
+  for (; i < len; i++) {
+    out[i] = in[i] - '0';
+  }
+}
+
+static void *run_worker(void *arg) {
+  worker *w = arg;
+  size_t len = w->end - w->start;
+  size_t i = 0;
+  to_digits(w->start, w->digits, len);
+  w->out_len = 0;
+  while (i < len) {
+    trie_cursor_t cursor;
+    uint8_t found = 1;
+    trie_cursor_start(&cursor, &trie);
+    for (; i < len && w->digits[i] <= 9; i++) {
+      if (found && trie_cursor_forward(&cursor, w->digits[i]) != 1) {
+        found = 0;
+      }
+    }
+    if (i < len && w->start[i] == '\r' && i + 1 < len && w->start[i + 1] == '\n') {
+      i++;
+    }
+    if (i < len && w->start[i] != '\n') {
+      // not a number
+      found = 0;
+      while (i < len && w->start[i] != '\n') {
+        i++;
+      }
+    }
+    i++;
+    if (found) {
+      uint8_t result = trie_cursor_result(&cursor);
+      if (result != '\0') {
+        w->out[w->out_len++] = result;
+      }
+    }
+    w->out[w->out_len++] = '\n';
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  char *patterns_filename = NULL;
+  char *trie_filename = NULL;
+  unsigned int num_threads = 4;
+  const uint8_t *input;
+  size_t input_len;
+  size_t pos = 0;
+  worker *workers;
+  unsigned int i;
+
+  static struct option long_options[] = {
+    { "patterns", required_argument, NULL, 'p' },
+    { "trie", required_argument, NULL, 't' },
+    { "threads", required_argument, NULL, 'j' },
+    { "block-size", required_argument, NULL, 'b' },
+    { 0, 0, 0, 0 },
+  };
+  int option_index = 0;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "p:t:j:b:", long_options, &option_index)) != -1) {
+    switch (opt) {
+      case 'p':
+        patterns_filename = optarg;
+        break;
+      case 't':
+        trie_filename = optarg;
+        break;
+      case 'j':
+        num_threads = strtoul(optarg, NULL, 10);
+        break;
+      case 'b':
+        block_size = strtoul(optarg, NULL, 10);
+        break;
+      default:
+        print_usage();
+        return EXIT_FAILURE;
+    }
+  }
+  if (argc < optind + 1 || !patterns_filename == !trie_filename || num_threads == 0 ||
+      block_size == 0) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+
+  if (patterns_filename) {
+    if (pattern_file_read(patterns_filename, NULL, NULL) != 0) {
+      return EXIT_FAILURE;
+    }
+    uint8_t *data;
+    int len = tinreg_pack(&data);
+    if (len < 0) {
+      return EXIT_FAILURE;
+    }
+    trie.data = data;
+    trie.len = len;
+  } else {
+    size_t len;
+    trie.data = map_file(trie_filename, &len);
+    if (!trie.data) {
+      return EXIT_FAILURE;
+    }
+    trie.len = len;
+  }
+
+  input = map_file(argv[optind], &input_len);
+  if (!input) {
+    return EXIT_FAILURE;
+  }
+
+  workers = calloc(num_threads, sizeof(worker));
+
+  while (pos < input_len) {
+    unsigned int num_running = 0;
+    for (i = 0; i < num_threads && pos < input_len; i++) {
+      size_t end = pos + block_size < input_len ? pos + block_size : input_len;
+      const uint8_t *newline = memchr(input + end - 1, '\n', input_len - end + 1);
+      if (newline) {
+        end = newline - input + 1;
+      } else {
+        end = input_len;
+      }
+      if (end - pos > workers[i].capacity) {
+        // a block of lines may exceed block_size by one line, and each byte
+        // of input may give two bytes of output, as an empty line gives the
+        // result of the root and a newline
+        workers[i].capacity = end - pos;
+        workers[i].digits = realloc(workers[i].digits, workers[i].capacity);
+        workers[i].out = realloc(workers[i].out, 2 * workers[i].capacity + 1);
+        if (!workers[i].digits || !workers[i].out) {
+          fprintf(stderr, "realloc failed for worker buffers\n");
+          return EXIT_FAILURE;
+        }
+      }
+      workers[i].start = input + pos;
+      workers[i].end = input + end;
+      pthread_create(&workers[i].thread, NULL, run_worker, &workers[i]);
+      num_running++;
+      pos = end;
+    }
+    for (i = 0; i < num_running; i++) {
+      pthread_join(workers[i].thread, NULL);
+      fwrite(workers[i].out, 1, workers[i].out_len, stdout);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,322 @@
+// Serve lookups in a packed trie over a Unix domain socket
+//
+// A client sends requests back to back, each one being a length byte
+// followed by that many ASCII digits. The server answers every request, in
+// order, with one byte: the result, or '\0' if the digits have no result.
+// Requests can be pipelined and batched freely.
+//
+// The trie file (build_trie --emit=binary) is mapped into memory, and mapped
+// again on SIGHUP. Replace the file with rename(2) rather than overwriting it.
+// With --cache, the results of repeated numbers are kept in a trie_cache.h
+// cache, and its hit rate is printed on exit.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "minimal_trie.h"
+#include "trie_cache.h"
+
+#define MAX_EVENTS  64
+#define BUF_SIZE  65536
+
+typedef struct connection {
+  int fd;
+  uint8_t in[BUF_SIZE];
+  unsigned int in_len;
+  // each request yields one byte, so the responses to a full input buffer fit
+  uint8_t out[BUF_SIZE];
+  unsigned int out_len;
+  unsigned int out_sent;
+} connection;
+
+static trie_t trie;
+static int use_cache = 0;
+static void *trie_map;
+static size_t trie_map_len;
+static connection listener;
+static connection signals;
+
+void print_usage() {
+  printf("Usage: trie_server [options] <trie_file>\n");
+  printf("\n");
+  printf("Options:\n");
+  printf("  -s, --socket=PATH  socket path (default: /tmp/trie.sock)\n");
+  printf("  -c, --cache=SETS   cache results in SETS sets of %d numbers (default: off)\n",
+      TRIE_CACHE_WAYS);
+}
+
+// Map the trie file, replacing the current trie if it succeeds
+static int load_trie(const char *filename) {
+  struct stat st;
+  void *map;
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    fprintf(stderr, "Error opening %s: %s\n", filename, strerror(errno));
+    return -1;
+  }
+  if (fstat(fd, &st) == -1) {
+    fprintf(stderr, "Error reading %s: %s\n", filename, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  if (st.st_size == 0) {
+    fprintf(stderr, "Error reading %s: empty file\n", filename);
+    close(fd);
+    return -1;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Error mapping %s: %s\n", filename, strerror(errno));
+    return -1;
+  }
+  if (trie_map) {
+    munmap(trie_map, trie_map_len);
+  }
+  trie_map = map;
+  trie_map_len = st.st_size;
+  trie.data = map;
+  trie.len = st.st_size;
+  // the new map may be at the address of an old one
+  trie_data_changed();
+  return 0;
+}
+
+static uint8_t lookup(uint8_t *chars, unsigned int len) {
+  uint8_t digits[255];
+  unsigned int i;
+  for (i = 0; i < len; i++) {
+    digits[i] = chars[i] - '0';
+    if (digits[i] > 9) {
+      return '\0';
+    }
+  }
+  return use_cache ? trie_cache_lookup(&trie, digits, len) : trie_lookup(&trie, digits, len);
+}
+
+static void print_cache_stats() {
+  trie_cache_stats_t stats;
+  trie_cache_get_stats(&stats);
+  fprintf(stderr, "cache: %llu lookups, %llu hits (%.1f%%), %llu flushes\n",
+      (unsigned long long)stats.lookups, (unsigned long long)stats.hits,
+      stats.lookups ? stats.hits * 100.0 / stats.lookups : 0.0,
+      (unsigned long long)stats.flushes);
+}
+
+static void set_events(int epoll_fd, connection *conn, uint32_t events) {
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.ptr = conn;
+  epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+static void close_connection(int epoll_fd, connection *conn) {
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+  close(conn->fd);
+  free(conn);
+}
+
+// Send the pending responses
+// Return 1 if all of them have been sent, 0 if not, -1 if error
+static int flush_connection(connection *conn) {
+  while (conn->out_sent < conn->out_len) {
+    ssize_t n = write(conn->fd, conn->out + conn->out_sent, conn->out_len - conn->out_sent);
+    if (n == -1) {
+      return errno == EAGAIN ? 0 : -1;
+    }
+    conn->out_sent += n;
+  }
+  conn->out_len = conn->out_sent = 0;
+  return 1;
+}
+
+// Read the requests and answer the complete ones
+// Return 1 if all responses have been sent, 0 if not, -1 if the connection is closed
+static int serve_connection(connection *conn) {
+  while (1) {
+    ssize_t n = read(conn->fd, conn->in + conn->in_len, BUF_SIZE - conn->in_len);
+    unsigned int pos = 0;
+    if (n == 0) {
+      return -1;
+    }
+    if (n == -1) {
+      return errno == EAGAIN ? 1 : -1;
+    }
+    conn->in_len += n;
+    while (pos < conn->in_len && pos + 1 + conn->in[pos] <= conn->in_len) {
+      conn->out[conn->out_len++] = lookup(conn->in + pos + 1, conn->in[pos]);
+      pos += 1 + conn->in[pos];
+    }
+    memmove(conn->in, conn->in + pos, conn->in_len - pos);
+    conn->in_len -= pos;
+    int status = flush_connection(conn);
+    if (status != 1) {
+      // wait until the client reads the responses before reading more
+      return status;
+    }
+  }
+}
+
+static void accept_connections(int epoll_fd) {
+  while (1) {
+    struct epoll_event ev;
+    int fd = accept(listener.fd, NULL, NULL);
+    if (fd == -1) {
+      return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    connection *conn = malloc(sizeof(connection));
+    if (!conn) {
+      fprintf(stderr, "malloc failed for connection\n");
+      close(fd);
+      return;
+    }
+    conn->fd = fd;
+    conn->in_len = conn->out_len = conn->out_sent = 0;
+    ev.events = EPOLLIN;
+    ev.data.ptr = conn;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+  }
+}
+
+static int open_listener(const char *path) {
+  struct sockaddr_un addr;
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (fd == -1) {
+    fprintf(stderr, "socket: %s\n", strerror(errno));
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, 128) == -1) {
+    fprintf(stderr, "Error listening on %s: %s\n", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int main(int argc, char **argv) {
+  char *socket_path = "/tmp/trie.sock";
+  unsigned long cache_sets;
+  struct epoll_event ev;
+  struct epoll_event events[MAX_EVENTS];
+  sigset_t mask;
+  int epoll_fd;
+  int running = 1;
+
+  static struct option long_options[] = {
+    { "socket", required_argument, NULL, 's' },
+    { "cache", required_argument, NULL, 'c' },
+    { 0, 0, 0, 0 },
+  };
+  int option_index = 0;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "s:c:", long_options, &option_index)) != -1) {
+    switch (opt) {
+      case 's':
+        socket_path = optarg;
+        break;
+      case 'c':
+        cache_sets = strtoul(optarg, NULL, 10);
+        if (cache_sets < 1 || cache_sets > TRIE_CACHE_MAX_SETS) {
+          fprintf(stderr, "--cache must be 1 to %d\n", TRIE_CACHE_MAX_SETS);
+          return EXIT_FAILURE;
+        }
+        trie_cache_set_size(cache_sets);
+        use_cache = 1;
+        break;
+      default:
+        print_usage();
+        return EXIT_FAILURE;
+    }
+  }
+  if (argc < optind + 1) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+  char *trie_filename = argv[optind];
+
+  if (load_trie(trie_filename) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGHUP);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+  signals.fd = signalfd(-1, &mask, SFD_NONBLOCK);
+
+  listener.fd = open_listener(socket_path);
+  if (listener.fd == -1 || signals.fd == -1) {
+    return EXIT_FAILURE;
+  }
+
+  epoll_fd = epoll_create1(0);
+  ev.events = EPOLLIN;
+  ev.data.ptr = &listener;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener.fd, &ev);
+  ev.data.ptr = &signals;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signals.fd, &ev);
+
+  while (running) {
+    int num_events = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+    int i;
+    for (i = 0; i < num_events; i++) {
+      connection *conn = events[i].data.ptr;
+      if (conn == &listener) {
+        accept_connections(epoll_fd);
+      } else if (conn == &signals) {
+        struct signalfd_siginfo info;
+        while (read(signals.fd, &info, sizeof(info)) == sizeof(info)) {
+          if (info.ssi_signo == SIGHUP) {
+            if (load_trie(trie_filename) == 0) {
+              fprintf(stderr, "reloaded %s\n", trie_filename);
+            }
+          } else {
+            running = 0;
+          }
+        }
+      } else {
+        int status;
+        if (events[i].events & EPOLLOUT) {
+          status = flush_connection(conn);
+          if (status == 1) {
+            // answer the requests left in the input buffer, then read more
+            status = serve_connection(conn);
+          }
+        } else {
+          status = serve_connection(conn);
+        }
+        if (status == -1) {
+          close_connection(epoll_fd, conn);
+        } else {
+          set_events(epoll_fd, conn, status == 1 ? EPOLLIN : EPOLLOUT);
+        }
+      }
+    }
+  }
+
+  close(listener.fd);
+  unlink(socket_path);
+  if (use_cache) {
+    print_cache_stats();
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+// Lookup counters of minimal_trie.c built with -DUSE_TELEMETRY=1
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "trie_telemetry.h"
+
+__thread trie_telemetry_t *trie_telemetry_local;
+unsigned int trie_telemetry_period = TRIE_TELEMETRY_PERIOD;
+
+// Blocks of all threads, pushed without a lock and never removed
+static trie_telemetry_t *registry;
+
+void trie_telemetry_set_period(unsigned int period) {
+  trie_telemetry_period = period > 0 ? period : 1;
+}
+
+trie_telemetry_t *trie_telemetry_register() {
+  trie_telemetry_t *t = aligned_alloc(TRIE_TELEMETRY_ALIGN, sizeof(trie_telemetry_t));
+  if (!t) {
+    return NULL;
+  }
+  memset(t, 0, sizeof(trie_telemetry_t));
+  t->countdown = 1;  // sample the first lookup
+  t->next = __atomic_load_n(&registry, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&registry, &t->next, t, 1,
+        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+  }
+  trie_telemetry_local = t;
+  return t;
+}
+
+#define LOAD(field)  __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+// The owner thread may be counting while the counters are read
+static void add_counters(trie_telemetry_t *dest, const trie_telemetry_t *src) {
+  unsigned int i;
+  dest->lookups += LOAD(src->lookups);
+  dest->sampled += LOAD(src->sampled);
+  for (i = 0; i < TRIE_TELEMETRY_MAX_DEPTH; i++) {
+    dest->steps[i] += LOAD(src->steps[i]);
+    dest->skipped[i] += LOAD(src->skipped[i]);
+    dest->hits[i] += LOAD(src->hits[i]);
+    dest->misses[i] += LOAD(src->misses[i]);
+  }
+  for (i = 0; i < 256; i++) {
+    dest->results[i] += LOAD(src->results[i]);
+  }
+  for (i = 0; i < TRIE_TELEMETRY_MAX_NODES; i++) {
+    dest->nodes[i] += LOAD(src->nodes[i]);
+  }
+}
+
+void trie_telemetry_snapshot(trie_telemetry_t *snapshot) {
+  trie_telemetry_t *t;
+  memset(snapshot, 0, sizeof(trie_telemetry_t));
+  for (t = __atomic_load_n(&registry, __ATOMIC_ACQUIRE); t; t = t->next) {
+    add_counters(snapshot, t);
+  }
+}
+
+void trie_telemetry_merge(trie_telemetry_t *dest, const trie_telemetry_t *src) {
+  add_counters(dest, src);
+}
+
+void trie_telemetry_reset() {
+  trie_telemetry_t *t;
+  for (t = __atomic_load_n(&registry, __ATOMIC_ACQUIRE); t; t = t->next) {
+    uint64_t *p;
+    uint32_t *node;
+    for (p = &t->lookups; p < (uint64_t *)t->nodes; p++) {
+      __atomic_store_n(p, 0, __ATOMIC_RELAXED);
+    }
+    for (node = t->nodes; node < t->nodes + TRIE_TELEMETRY_MAX_NODES; node++) {
+      __atomic_store_n(node, 0, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+int trie_telemetry_export(const trie_telemetry_t *snapshot, const trie_t *trie, FILE *out) {
+  const uint8_t *data = trie->data;
+  char path[TRIE_TELEMETRY_MAX_DEPTH + 1];
+  unsigned int ends[TRIE_TELEMETRY_MAX_DEPTH];
+  unsigned int depth = 0;
+  unsigned int end = (NODE_DESCENDANTS(data, 0) + 1) * BYTES_PER_NODE;
+  unsigned int pos;
+  unsigned int i;
+
+  fprintf(out, "trie-telemetry 1\n");
+  fprintf(out, "lookups %" PRIu64 "\n", snapshot->lookups);
+  fprintf(out, "sampled %" PRIu64 "\n", snapshot->sampled);
+  for (i = 0; i < TRIE_TELEMETRY_MAX_DEPTH; i++) {
+    if (snapshot->steps[i] || snapshot->hits[i] || snapshot->misses[i]) {
+      fprintf(out, "depth %u steps %" PRIu64 " skipped %" PRIu64 " hits %" PRIu64
+          " misses %" PRIu64 "\n", i, snapshot->steps[i], snapshot->skipped[i],
+          snapshot->hits[i], snapshot->misses[i]);
+    }
+  }
+  for (i = 0; i < 256; i++) {
+    if (snapshot->results[i]) {
+      fprintf(out, "result %u %" PRIu64 "\n", i, snapshot->results[i]);
+    }
+  }
+
+  // walk the trie in preorder to write the path of each entered node
+  if (end > trie->len) {
+    end = trie->len;
+  }
+  for (pos = NODE_SIZE(data, 0); pos < end; pos += NODE_SIZE(data, pos)) {
+    uint8_t digit = NODE_CHAR(data, pos);
+    while (depth > 0 && ends[depth - 1] <= pos) {
+      depth--;
+    }
+    if (digit == NODE_CHAR_SET) {
+      unsigned int mask = NODE_SET_MASK(data, pos);
+      for (digit = 0; !((mask >> digit) & 1); digit++) {
+      }
+    }
+    if (depth == TRIE_TELEMETRY_MAX_DEPTH) {
+      pos += NODE_DESCENDANTS(data, pos) * BYTES_PER_NODE;
+      continue;
+    }
+    path[depth] = '0' + digit;
+    ends[depth] = pos + (NODE_DESCENDANTS(data, pos) + 1) * BYTES_PER_NODE;
+    depth++;
+    if (pos / BYTES_PER_NODE < TRIE_TELEMETRY_MAX_NODES && snapshot->nodes[pos / BYTES_PER_NODE]) {
+      fprintf(out, "node %.*s %u\n", (int)depth, path, snapshot->nodes[pos / BYTES_PER_NODE]);
+    }
+  }
+  return ferror(out) ? -1 : 0;
+}
@@ -0,0 +1,69 @@
+// Lookup counters of minimal_trie.c built with -DUSE_TELEMETRY=1
+//
+// Each thread counts into its own block of counters, aligned to a cache
+// line and allocated on its first lookup, so counting takes no lock and no
+// atomic read-modify-write. A snapshot sums the blocks of all threads,
+// including threads that have exited.
+//
+// Every lookup is counted in lookups, but the steps and results are counted
+// for one lookup in every trie_telemetry_period, which keeps the cost to a
+// few percent. Only lookups begun by trie_start(), trie_cursor_start() or
+// trie_cursor_jump() are counted, so trie_iter and trie_fuzzy are not.
+
+#ifndef TRIE_TELEMETRY_H
+#define TRIE_TELEMETRY_H
+
+#include <stdio.h>
+
+#include "minimal_trie.h"
+
+// Depths above this are counted in the last entry
+#define TRIE_TELEMETRY_MAX_DEPTH  32
+// Nodes are counted by offset / BYTES_PER_NODE, which is below this
+#define TRIE_TELEMETRY_MAX_NODES  4096
+#define TRIE_TELEMETRY_ALIGN  64
+// Default of trie_telemetry_period
+#define TRIE_TELEMETRY_PERIOD  64
+
+typedef struct trie_telemetry_t {
+  uint64_t lookups;  // trie_start(), trie_cursor_start() and trie_cursor_jump() calls
+  uint64_t sampled;  // lookups whose steps and results were counted below
+  uint64_t steps[TRIE_TELEMETRY_MAX_DEPTH];    // trie_forward() calls from each depth
+  uint64_t skipped[TRIE_TELEMETRY_MAX_DEPTH];  // siblings they skipped
+  uint64_t hits[TRIE_TELEMETRY_MAX_DEPTH];     // results found at each depth
+  uint64_t misses[TRIE_TELEMETRY_MAX_DEPTH];   // failed steps and empty results
+  uint64_t results[256];                       // hits of each result char
+  uint32_t nodes[TRIE_TELEMETRY_MAX_NODES];    // times each node was entered
+  uint32_t countdown;                          // lookups until the next sample
+  struct trie_telemetry_t *next;               // next thread in the registry
+} __attribute__((aligned(TRIE_TELEMETRY_ALIGN))) trie_telemetry_t;
+
+// Counters of the calling thread, NULL before its first lookup
+extern __thread trie_telemetry_t *trie_telemetry_local;
+
+// Count the steps of one lookup in every period (1 counts all of them)
+extern unsigned int trie_telemetry_period;
+
+// Set trie_telemetry_period, which each thread uses from its next sample
+void trie_telemetry_set_period(unsigned int period);
+
+// Allocate and register the counters of the calling thread
+// Return NULL if the allocation fails, and the thread does not count
+trie_telemetry_t *trie_telemetry_register();
+
+// Store the sum of the counters of all threads in snapshot
+void trie_telemetry_snapshot(trie_telemetry_t *snapshot);
+
+// Add the counters of src to dest, e.g. for snapshots of several processes
+void trie_telemetry_merge(trie_telemetry_t *dest, const trie_telemetry_t *src);
+
+// Set the counters of all threads to zero
+// Lookups running at the same time may keep some of their counts
+void trie_telemetry_reset();
+
+// Write a snapshot of lookups in the trie as text read by build_trie --profile
+// Nodes are written as their paths, with the lowest digit of each set of digits
+// Return 0 if success, -1 if error
+int trie_telemetry_export(const trie_telemetry_t *snapshot, const trie_t *trie, FILE *out);
+
+#endif // TRIE_TELEMETRY_H